@@ -0,0 +1,260 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Timing harness for the dependence measures and their kernels.
+//
+// Usage: bench_wdm [key=value ...]
+//
+// The input is either generated (keys of `bench::Workload_spec`) or read
+// from a column file (`file=<path>`). Further options:
+//   methods=<m1,m2,...>   measures to time (default: all),
+//   kernels=<k1,k2,...>   kernels to time (default: all; `none` for none),
+//   reps=<k>              number of repetitions (default: 5),
+//   perf=1                also collect hardware counters (Linux only).
+// The first two columns of the data are used. The reported time is the
+// median over the repetitions; counters are averaged over them and
+// reported per observation.
+//
+// With `mode=scaling`, the dependence matrix is computed instead, sweeping
+// the number of threads, n, and d (see `scaling.hpp`):
+//   threads=<t1,t2,...>   thread counts (default: 1, 2, 4, ... up to the
+//                         number of cores),
+//   sizes=<n1,n2,...>     numbers of observations (default: 1000,10000),
+//   dims=<d1,d2,...>      numbers of variables (default: 10,50),
+//   scaling=weak          weak instead of strong scaling.
+//   trace=<file>          write a Chrome trace of the sweep (requires
+//                         configuring with -DENABLE_TRACE=ON).
+
+#include "generator.hpp"
+#include "perf_counters.hpp"
+#include "scaling.hpp"
+#include <wdm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+std::vector<std::string> split(const std::string& s, char sep)
+{
+    std::vector<std::string> parts;
+    std::string part;
+    std::istringstream in(s);
+    while (std::getline(in, part, sep))
+        parts.push_back(part);
+    return parts;
+}
+
+std::vector<size_t> parse_sizes(const std::string& s)
+{
+    std::vector<size_t> sizes;
+    for (const auto& part : split(s, ','))
+        sizes.push_back(std::strtoul(part.c_str(), nullptr, 10));
+    return sizes;
+}
+
+const std::vector<std::string> all_kernels = {
+    "sort_all", "merge_sort_count_per_element", "rank0", "bivariate_rank"
+};
+
+// a benchmark case; `setup` prepares the inputs (untimed) before each call
+// of `run`.
+struct Case {
+    std::string name;
+    std::function<void()> setup;
+    std::function<void()> run;
+};
+
+Case make_kernel_case(const std::string& kernel,
+                      const std::vector<double>& x,
+                      const std::vector<double>& y,
+                      const std::vector<double>& w)
+{
+    // kernels expect complete data
+    auto xx = std::make_shared<std::vector<double>>(x);
+    auto yy = std::make_shared<std::vector<double>>(y);
+    auto ww = std::make_shared<std::vector<double>>(w);
+    wdm::utils::remove_incomplete(*xx, *yy, *ww);
+    auto x0 = std::make_shared<std::vector<double>>(*xx);
+    auto y0 = std::make_shared<std::vector<double>>(*yy);
+    auto w0 = std::make_shared<std::vector<double>>(*ww);
+    auto counts = std::make_shared<std::vector<double>>();
+
+    Case c{kernel, [=] {
+        *xx = *x0;
+        *yy = *y0;
+        *ww = *w0;
+    }, nullptr};
+    if (kernel == "sort_all") {
+        c.run = [=] { wdm::utils::sort_all(*xx, *yy, *ww); };
+    } else if (kernel == "merge_sort_count_per_element") {
+        c.setup = [=] {
+            *xx = *x0;
+            *ww = *w0;
+            counts->assign(xx->size(), 0.0);
+        };
+        c.run = [=] {
+            wdm::utils::merge_sort_count_per_element(*xx, *ww, *counts);
+        };
+    } else if (kernel == "rank0") {
+        c.run = [=] { wdm::impl::rank0(*xx, *ww, "average"); };
+    } else if (kernel == "bivariate_rank") {
+        c.run = [=] { wdm::impl::bivariate_rank(*xx, *yy, *ww); };
+    } else {
+        throw std::runtime_error("unknown kernel: " + kernel);
+    }
+    return c;
+}
+
+struct Result {
+    double time;                 // median time in seconds
+    std::vector<double> counters; // mean counts per repetition
+};
+
+Result measure(const Case& c, size_t reps, bench::Perf_counters* perf)
+{
+    Result r;
+    std::vector<double> times(reps);
+    for (size_t k = 0; k < reps; k++) {
+        c.setup();
+        if (perf)
+            perf->start();
+        auto start = std::chrono::steady_clock::now();
+        c.run();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        times[k] = elapsed.count();
+        if (perf) {
+            std::vector<double> values = perf->stop();
+            r.counters.resize(values.size(), 0.0);
+            for (size_t j = 0; j < values.size(); j++)
+                r.counters[j] += values[j] / reps;
+        }
+    }
+    std::sort(times.begin(), times.end());
+    r.time = times[reps / 2];
+    return r;
+}
+
+void print_counter(double value)
+{
+    if (std::isnan(value))
+        std::printf(" %10s", "n/a");
+    else
+        std::printf(" %10.3f", value);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    try {
+        std::map<std::string, std::string> options;
+        bench::Workload_spec spec = bench::parse_args(argc, argv, options);
+        std::string methods =
+            "pearson,spearman,kendall,blomqvist,hoeffding,chatterjee,dcor,htau";
+        std::vector<std::string> kernels = all_kernels;
+        size_t reps = 5;
+        bool with_perf = false;
+        if (options.count("methods"))
+            methods = options["methods"];
+        if (options.count("kernels"))
+            kernels = split(options["kernels"], ',');
+        if (options.count("reps"))
+            reps = std::max(std::strtoul(options["reps"].c_str(), nullptr, 10),
+                            1ul);
+        if (options.count("perf"))
+            with_perf = (options["perf"] != "0");
+
+        if (options.count("mode") && (options["mode"] == "scaling")) {
+            bench::Scaling_options opts;
+            opts.methods = split(methods, ',');
+            opts.reps = reps;
+            for (size_t t = 1; t <= std::thread::hardware_concurrency(); t *= 2)
+                opts.threads.push_back(t);
+            if (opts.threads.empty())
+                opts.threads.push_back(1);
+            opts.sizes = {1000, 10000};
+            opts.dims = {10, 50};
+            if (options.count("threads"))
+                opts.threads = parse_sizes(options["threads"]);
+            if (options.count("sizes"))
+                opts.sizes = parse_sizes(options["sizes"]);
+            if (options.count("dims"))
+                opts.dims = parse_sizes(options["dims"]);
+            if (options.count("scaling"))
+                opts.weak = (options["scaling"] == "weak");
+            if (options.count("trace"))
+                opts.trace = options["trace"];
+            bench::run_scaling(spec, opts);
+            return EXIT_SUCCESS;
+        }
+
+        bench::Workload data;
+        if (options.count("file")) {
+            data = bench::read(options["file"]);
+            std::cout << "data: " << options["file"] << std::endl;
+        } else {
+            data = bench::generate(spec);
+            std::cout << "data: " << bench::describe(spec) << std::endl;
+        }
+        if (data.columns.size() < 2)
+            throw std::runtime_error("need at least two columns.");
+        const auto& x = data.columns[0];
+        const auto& y = data.columns[1];
+        const auto& w = data.weights;
+
+        std::vector<Case> cases;
+        for (const auto& method : split(methods, ',')) {
+            cases.push_back(Case{method, [] {}, [&x, &y, &w, method] {
+                wdm::wdm(x, y, method, w);
+            }});
+        }
+        for (const auto& kernel : kernels) {
+            if (kernel != "none")
+                cases.push_back(make_kernel_case(kernel, x, y, w));
+        }
+
+        std::unique_ptr<bench::Perf_counters> perf;
+        if (with_perf) {
+            perf.reset(new bench::Perf_counters);
+            if (!perf->available()) {
+                std::cout << "note: hardware counters are not available "
+                          << "(check /proc/sys/kernel/perf_event_paranoid)."
+                          << std::endl;
+            }
+        }
+
+        std::printf("%-30s %10s %10s", "case", "time [ms]", "ns/obs");
+        if (perf) {
+            std::printf(" %10s %10s %10s %10s %10s",
+                        "cyc/obs", "IPC", "L1d/obs", "LLC/obs", "brmis/obs");
+        }
+        std::printf("\n");
+        for (const auto& c : cases) {
+            Result r = measure(c, reps, perf.get());
+            std::printf("%-30s %10.3f %10.2f",
+                        c.name.c_str(), 1e3 * r.time, 1e9 * r.time / x.size());
+            if (perf) {
+                const auto& v = r.counters;
+                print_counter(v[0] / x.size());
+                print_counter(v[1] / v[0]);
+                print_counter(v[2] / x.size());
+                print_counter(v[3] / x.size());
+                print_counter(v[4] / x.size());
+            }
+            std::printf("\n");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,396 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Synthetic workloads for benchmarks. All benchmark and scaling studies use
+// this generator so that their inputs are reproducible from a seed and have
+// controllable structure (dependence, ties, missing values, weights).
+//
+// The random number generator and all distributions are implemented here
+// (instead of using <random> distributions, whose output is
+// implementation-defined), so the same seed gives the same data on every
+// platform.
+
+#pragma once
+
+#include <wdm/column_file.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+//! xoshiro256** seeded through splitmix64.
+class Rng {
+public:
+    explicit Rng(uint64_t seed)
+    {
+        for (auto& s : s_) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            s = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next()
+    {
+        uint64_t result = rotl(s_[1] * 5, 7) * 9;
+        uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+    //! uniform on the open interval (0, 1).
+    double uniform()
+    {
+        return ((next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    //! uniform on {0, ..., n - 1}.
+    size_t index(size_t n)
+    {
+        return static_cast<size_t>(uniform() * n);
+    }
+
+    double normal()
+    {
+        const double pi = 3.14159265358979323846;
+        return std::sqrt(-2 * std::log(uniform())) *
+               std::cos(2 * pi * uniform());
+    }
+
+    double exponential() { return -std::log(uniform()); }
+
+    //! gamma distribution with unit scale (Marsaglia and Tsang, 2000).
+    double gamma(double shape)
+    {
+        if (shape < 1)
+            return gamma(shape + 1) * std::pow(uniform(), 1 / shape);
+        double d = shape - 1.0 / 3, c = 1 / std::sqrt(9 * d);
+        while (true) {
+            double z = normal(), v = 1 + c * z;
+            if (v <= 0)
+                continue;
+            v = v * v * v;
+            if (std::log(uniform()) < 0.5 * z * z + d - d * v + d * std::log(v))
+                return d * v;
+        }
+    }
+
+    //! positive stable distribution with Laplace transform exp(-t^alpha),
+    //! 0 < alpha < 1 (Kanter, 1975).
+    double positive_stable(double alpha)
+    {
+        const double pi = 3.14159265358979323846;
+        double u = pi * uniform();
+        double a = std::pow(std::sin(alpha * u), alpha / (1 - alpha)) *
+                   std::sin((1 - alpha) * u) /
+                   std::pow(std::sin(u), 1 / (1 - alpha));
+        return std::pow(a / exponential(), (1 - alpha) / alpha);
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t s_[4];
+};
+
+//! describes a synthetic workload.
+struct Workload_spec {
+    size_t n = 10000;            //!< number of observations.
+    size_t d = 2;                //!< number of variables.
+    //! dependence model: `"independence"`, `"gaussian"`, `"clayton"`, or
+    //! `"gumbel"` (exchangeable, i.e., the same dependence for all pairs).
+    std::string copula = "gaussian";
+    //! Kendall's tau of the copula; if negative, odd columns are reflected
+    //! so that pairs of an even and an odd column are negatively dependent.
+    double tau = 0.5;
+    //! marginal distribution: `"uniform"`, `"exponential"`, or `"cauchy"`.
+    std::string margins = "uniform";
+    //! fraction of (leading) columns discretized into `levels` values.
+    double discrete = 0.0;
+    size_t levels = 10;          //!< number of levels of discrete columns.
+    //! probability that an observation copies the value of another one in
+    //! the same column.
+    double tie_rate = 0.0;
+    double missing_rate = 0.0;   //!< expected fraction of missing values.
+    //! where values are missing: `"mcar"` (independently for each value),
+    //! `"rows"` (entire rows), or `"blocks"` (runs of `block_length`
+    //! consecutive values in a column).
+    std::string missing_pattern = "mcar";
+    size_t block_length = 32;
+    //! weights: `"none"`, `"uniform"`, `"exponential"`, or `"pareto"`
+    //! (heavy-tailed with index 1.5).
+    std::string weights = "none";
+    double zero_weight_rate = 0.0; //!< fraction of weights set to zero.
+    uint64_t seed = 1;
+};
+
+//! a generated data set.
+struct Workload {
+    std::vector<std::vector<double>> columns;
+    std::vector<double> weights;
+};
+
+//! sets a field of the specification from its name; returns false if there is
+//! no such field.
+inline bool set_field(Workload_spec& spec,
+                      const std::string& key,
+                      const std::string& value)
+{
+    std::istringstream in(value);
+    if (key == "n")
+        in >> spec.n;
+    else if (key == "d")
+        in >> spec.d;
+    else if (key == "copula")
+        spec.copula = value;
+    else if (key == "tau")
+        in >> spec.tau;
+    else if (key == "margins")
+        spec.margins = value;
+    else if (key == "discrete")
+        in >> spec.discrete;
+    else if (key == "levels")
+        in >> spec.levels;
+    else if (key == "tie_rate")
+        in >> spec.tie_rate;
+    else if (key == "missing_rate")
+        in >> spec.missing_rate;
+    else if (key == "missing_pattern")
+        spec.missing_pattern = value;
+    else if (key == "block_length")
+        in >> spec.block_length;
+    else if (key == "weights")
+        spec.weights = value;
+    else if (key == "zero_weight_rate")
+        in >> spec.zero_weight_rate;
+    else if (key == "seed")
+        in >> spec.seed;
+    else
+        return false;
+    if (in.fail())
+        throw std::runtime_error("invalid value for '" + key + "': " + value);
+    return true;
+}
+
+//! parses `key=value` command line arguments; fields of the specification are
+//! set directly, all other arguments are returned in `options`.
+inline Workload_spec parse_args(int argc,
+                                char** argv,
+                                std::map<std::string, std::string>& options)
+{
+    Workload_spec spec;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos)
+            throw std::runtime_error("expected key=value, got: " + arg);
+        std::string key = arg.substr(0, eq), value = arg.substr(eq + 1);
+        if (!set_field(spec, key, value))
+            options[key] = value;
+    }
+    return spec;
+}
+
+//! a one-line description of the specification (in `set_field()` syntax).
+inline std::string describe(const Workload_spec& spec)
+{
+    std::ostringstream out;
+    out << "n=" << spec.n << " d=" << spec.d << " copula=" << spec.copula
+        << " tau=" << spec.tau << " margins=" << spec.margins
+        << " discrete=" << spec.discrete << " levels=" << spec.levels
+        << " tie_rate=" << spec.tie_rate
+        << " missing_rate=" << spec.missing_rate
+        << " missing_pattern=" << spec.missing_pattern
+        << " block_length=" << spec.block_length
+        << " weights=" << spec.weights
+        << " zero_weight_rate=" << spec.zero_weight_rate
+        << " seed=" << spec.seed;
+    return out.str();
+}
+
+namespace detail {
+
+// draws one observation from the copula (with uniform margins).
+inline void draw_copula(Rng& rng,
+                        const Workload_spec& spec,
+                        std::vector<double>& u)
+{
+    const double pi = 3.14159265358979323846;
+    double tau = std::abs(spec.tau);
+    if ((spec.copula == "independence") || (tau == 0)) {
+        for (auto& uj : u)
+            uj = rng.uniform();
+    } else if (spec.copula == "gaussian") {
+        // equicorrelated normals through a common factor.
+        double rho = std::sin(pi * tau / 2);
+        double z_0 = rng.normal();
+        for (auto& uj : u) {
+            double z = std::sqrt(rho) * z_0 + std::sqrt(1 - rho) * rng.normal();
+            uj = 0.5 * std::erfc(-z / std::sqrt(2.0));
+        }
+    } else if (spec.copula == "clayton") {
+        // Marshall-Olkin algorithm with gamma frailty.
+        double theta = 2 * tau / (1 - tau);
+        double v = rng.gamma(1 / theta);
+        for (auto& uj : u)
+            uj = std::pow(1 + rng.exponential() / v, -1 / theta);
+    } else if (spec.copula == "gumbel") {
+        // Marshall-Olkin algorithm with positive stable frailty.
+        double alpha = 1 - tau;
+        double v = rng.positive_stable(alpha);
+        for (auto& uj : u)
+            uj = std::exp(-std::pow(rng.exponential() / v, alpha));
+    } else {
+        throw std::runtime_error("unknown copula: " + spec.copula);
+    }
+
+    if (spec.tau < 0) {
+        for (size_t j = 1; j < u.size(); j += 2)
+            u[j] = 1 - u[j];
+    }
+}
+
+inline double transform_margin(double u, const std::string& margins)
+{
+    const double pi = 3.14159265358979323846;
+    // guard against u = 0 or 1 after rounding in the copula.
+    u = std::min(std::max(u, 1e-300), 1 - 1e-16);
+    if (margins == "uniform")
+        return u;
+    if (margins == "exponential")
+        return -std::log1p(-u);
+    if (margins == "cauchy")
+        return std::tan(pi * (u - 0.5));
+    throw std::runtime_error("unknown margins: " + margins);
+}
+
+inline double draw_weight(Rng& rng, const std::string& weights)
+{
+    if (weights == "uniform")
+        return rng.uniform();
+    if (weights == "exponential")
+        return rng.exponential();
+    if (weights == "pareto")
+        return std::pow(rng.uniform(), -1 / 1.5);
+    throw std::runtime_error("unknown weights: " + weights);
+}
+
+}
+
+//! generates a workload; the result only depends on the specification.
+inline Workload generate(const Workload_spec& spec)
+{
+    Rng rng(spec.seed);
+    size_t n = spec.n, d = spec.d;
+    Workload data;
+    data.columns.assign(d, std::vector<double>(n));
+
+    // dependent uniforms
+    std::vector<double> u(d);
+    for (size_t i = 0; i < n; i++) {
+        detail::draw_copula(rng, spec, u);
+        for (size_t j = 0; j < d; j++)
+            data.columns[j][i] = u[j];
+    }
+
+    // discretization and ties (on the uniform scale, so that discrete
+    // columns take values 0, ..., levels - 1)
+    size_t n_discrete = static_cast<size_t>(std::round(spec.discrete * d));
+    for (size_t j = 0; j < d; j++) {
+        auto& col = data.columns[j];
+        if (spec.tie_rate > 0) {
+            for (size_t i = 1; i < n; i++) {
+                if (rng.uniform() < spec.tie_rate)
+                    col[i] = col[rng.index(i)];
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (j < n_discrete)
+                col[i] = std::floor(col[i] * spec.levels);
+            else
+                col[i] = detail::transform_margin(col[i], spec.margins);
+        }
+    }
+
+    // missing values
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    if (spec.missing_rate > 0) {
+        if (spec.missing_pattern == "mcar") {
+            for (auto& col : data.columns) {
+                for (auto& v : col) {
+                    if (rng.uniform() < spec.missing_rate)
+                        v = nan;
+                }
+            }
+        } else if (spec.missing_pattern == "rows") {
+            for (size_t i = 0; i < n; i++) {
+                if (rng.uniform() < spec.missing_rate) {
+                    for (auto& col : data.columns)
+                        col[i] = nan;
+                }
+            }
+        } else if (spec.missing_pattern == "blocks") {
+            size_t len = std::max<size_t>(spec.block_length, 1);
+            double p_start = spec.missing_rate / len;
+            for (auto& col : data.columns) {
+                for (size_t i = 0; i < n; i++) {
+                    if (rng.uniform() < p_start) {
+                        for (size_t k = i; k < std::min(i + len, n); k++)
+                            col[k] = nan;
+                        i += len - 1;
+                    }
+                }
+            }
+        } else {
+            throw std::runtime_error("unknown missing pattern: " +
+                                     spec.missing_pattern);
+        }
+    }
+
+    // weights
+    if (spec.weights != "none") {
+        data.weights.resize(n);
+        for (auto& w : data.weights) {
+            w = detail::draw_weight(rng, spec.weights);
+            if (rng.uniform() < spec.zero_weight_rate)
+                w = 0.0;
+        }
+    }
+
+    return data;
+}
+
+//! writes a workload to a file in the binary column format
+//! (see `wdm::io::write_columns()`).
+inline void write(const Workload& data, const std::string& path)
+{
+    wdm::io::write_columns(path, data.columns, data.weights);
+}
+
+//! reads a workload from a file in the binary column format.
+inline Workload read(const std::string& path)
+{
+    Workload data;
+    data.columns = wdm::io::read_columns(path);
+    data.weights = wdm::io::read_weights(path);
+    return data;
+}
+
+}
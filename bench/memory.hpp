@@ -0,0 +1,54 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Resident set size of the process (Linux only; NaN elsewhere).
+
+#pragma once
+
+#include <fstream>
+#include <limits>
+#include <string>
+
+namespace bench {
+
+inline double read_status_mib(const std::string& field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key) {
+        if (key == field) {
+            double kib;
+            status >> kib;
+            return kib / 1024;
+        }
+        status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+//! current resident set size (VmRSS) in MiB.
+inline double rss_mib()
+{
+    return read_status_mib("VmRSS:");
+}
+
+//! peak resident set size (VmHWM) in MiB.
+inline double peak_rss_mib()
+{
+    return read_status_mib("VmHWM:");
+}
+
+//! resets the peak resident set size to the current one; returns false if
+//! the kernel does not support it.
+inline bool reset_peak_rss()
+{
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.flush();
+    return static_cast<bool>(clear_refs);
+}
+
+}
@@ -0,0 +1,150 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Hardware performance counters for the benchmarks, based on Linux'
+// perf_event_open(). On other platforms, or if the kernel refuses access
+// (see /proc/sys/kernel/perf_event_paranoid), all counters are unavailable
+// and read as NaN.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+//! a set of hardware counters that are started and stopped together.
+//!
+//! Counters are opened individually (not as a group), so that a counter the
+//! CPU does not support only disables itself. Only user-space events of the
+//! calling thread are counted; values are scaled up if the kernel had to
+//! multiplex counters.
+class Perf_counters {
+public:
+    Perf_counters()
+    {
+        add("cycles", 0, 0);
+        add("instructions", 0, 1);
+        add("L1d misses", 1, 0);
+        add("LLC misses", 0, 2);
+        add("branch misses", 0, 3);
+    }
+
+    ~Perf_counters()
+    {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd >= 0)
+                ::close(fd);
+        }
+#endif
+    }
+
+    Perf_counters(const Perf_counters&) = delete;
+    Perf_counters& operator=(const Perf_counters&) = delete;
+
+    //! names of the counters.
+    const std::vector<std::string>& names() const { return names_; }
+
+    //! whether at least one counter could be opened.
+    bool available() const
+    {
+        for (int fd : fds_) {
+            if (fd >= 0)
+                return true;
+        }
+        return false;
+    }
+
+    //! resets and starts all counters.
+    void start()
+    {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    //! stops all counters and returns their values (NaN if unavailable).
+    std::vector<double> stop()
+    {
+        std::vector<double> values(fds_.size(),
+                                   std::numeric_limits<double>::quiet_NaN());
+#ifdef __linux__
+        for (size_t k = 0; k < fds_.size(); k++) {
+            if (fds_[k] >= 0)
+                ioctl(fds_[k], PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (size_t k = 0; k < fds_.size(); k++) {
+            uint64_t data[3]; // value, time enabled, time running
+            if ((fds_[k] < 0) ||
+                (::read(fds_[k], data, sizeof(data)) != sizeof(data)))
+                continue;
+            if (data[2] > 0) {
+                values[k] = static_cast<double>(data[0]) *
+                            static_cast<double>(data[1]) /
+                            static_cast<double>(data[2]);
+            }
+        }
+#endif
+        return values;
+    }
+
+private:
+    // kind 0: generic hardware event `id`; kind 1: L1d cache read misses.
+    void add(const std::string& name, int kind, int id)
+    {
+        names_.push_back(name);
+        int fd = -1;
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format =
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        if (kind == 0) {
+            const uint64_t events[] = {PERF_COUNT_HW_CPU_CYCLES,
+                                       PERF_COUNT_HW_INSTRUCTIONS,
+                                       PERF_COUNT_HW_CACHE_MISSES,
+                                       PERF_COUNT_HW_BRANCH_MISSES};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = events[id];
+        } else {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)kind;
+        (void)id;
+#endif
+        fds_.push_back(fd);
+    }
+
+    std::vector<std::string> names_;
+    std::vector<int> fds_;
+};
+
+}
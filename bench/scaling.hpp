@@ -0,0 +1,112 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Thread-scaling study of the matrix computation (`bench_wdm mode=scaling`).
+//
+// For each method, n, and d, the dependence matrix is computed with an
+// increasing number of threads. In strong scaling, the problem stays fixed;
+// in weak scaling, d grows with sqrt(threads) so that the number of pairs
+// per thread stays (roughly) constant. Reported are the median time,
+// throughput in pairs per second, parallel efficiency (throughput relative
+// to `threads` times the single-thread throughput), and the peak resident
+// set size during the computation together with its increase over the
+// resident size before it. If a trace file is given, the sweep is traced
+// (see `wdm/trace.hpp`; requires `WDM_TRACE`).
+
+#pragma once
+
+#include "generator.hpp"
+#include "memory.hpp"
+#include <wdm/eigen.hpp>
+#include <wdm/trace.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace bench {
+
+struct Scaling_options {
+    std::vector<std::string> methods;
+    std::vector<size_t> threads;
+    std::vector<size_t> sizes;
+    std::vector<size_t> dims;
+    bool weak = false;
+    size_t reps = 3;
+    std::string trace;
+};
+
+inline Eigen::MatrixXd to_matrix(const Workload& data)
+{
+    size_t n = data.columns.empty() ? 0 : data.columns[0].size();
+    Eigen::MatrixXd x(n, data.columns.size());
+    for (size_t j = 0; j < data.columns.size(); j++)
+        x.col(j) = Eigen::Map<const Eigen::VectorXd>(data.columns[j].data(), n);
+    return x;
+}
+
+inline void run_scaling(Workload_spec spec, const Scaling_options& opts)
+{
+    std::printf("%s scaling; data (n and d as listed): %s\n",
+                opts.weak ? "weak" : "strong", describe(spec).c_str());
+    std::printf("%-10s %8s %6s %7s %10s %12s %6s %10s %10s\n",
+                "method", "n", "d", "threads", "time [ms]", "pairs/s",
+                "eff", "peak MiB", "+MiB");
+    if (!opts.trace.empty())
+        wdm::trace_start();
+
+    for (const auto& method : opts.methods) {
+        for (size_t n : opts.sizes) {
+            for (size_t d : opts.dims) {
+                double base_throughput = 0;
+                for (size_t t : opts.threads) {
+                    spec.n = n;
+                    spec.d = d;
+                    if (opts.weak)
+                        spec.d = static_cast<size_t>(
+                            std::round(d * std::sqrt(static_cast<double>(t))));
+                    Workload data = generate(spec);
+                    Eigen::MatrixXd x = to_matrix(data);
+                    Eigen::VectorXd w = Eigen::Map<const Eigen::VectorXd>(
+                        data.weights.data(), data.weights.size());
+                    data = Workload();
+
+                    std::vector<double> times(opts.reps);
+                    reset_peak_rss();
+                    double rss_before = rss_mib();
+                    for (auto& time : times) {
+                        auto start = std::chrono::steady_clock::now();
+                        wdm::wdm(x, method, w, true, t);
+                        std::chrono::duration<double> elapsed =
+                            std::chrono::steady_clock::now() - start;
+                        time = elapsed.count();
+                    }
+                    double peak = peak_rss_mib();
+                    std::sort(times.begin(), times.end());
+                    double time = times[opts.reps / 2];
+
+                    double pairs = spec.d * (spec.d - 1) / 2.0;
+                    double throughput = pairs / time;
+                    if (t == opts.threads.front())
+                        base_throughput = throughput / t;
+                    std::printf("%-10s %8zu %6zu %7zu %10.2f %12.4g %6.2f "
+                                "%10.1f %10.1f\n",
+                                method.c_str(), n, static_cast<size_t>(spec.d),
+                                t, 1e3 * time, throughput,
+                                throughput / (t * base_throughput),
+                                peak, peak - rss_before);
+                }
+            }
+        }
+    }
+    if (!opts.trace.empty()) {
+        wdm::trace_stop();
+        wdm::write_trace(opts.trace);
+        std::printf("trace: %s\n", opts.trace.c_str());
+    }
+}
+
+}
@@ -0,0 +1,200 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Measures the machine-dependent parameters of the library (see
+// `wdm::Tuning`) on the host and writes them to a tuning file.
+//
+// Usage: wdm_calibrate [out=<file>] [reps=<repetitions>]
+//
+// The defaults are out=wdm_tuning.cfg and reps=7. The library reads the file
+// named by the environment variable WDM_TUNING_FILE, e.g.
+//   wdm_calibrate out=$HOME/.wdm_tuning && export WDM_TUNING_FILE=$HOME/.wdm_tuning
+
+#include <wdm/acf.hpp>
+#include <wdm/eigen.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+
+// median time of a function in seconds.
+template<class F>
+double time_median(F f, size_t reps)
+{
+    std::vector<double> times(reps);
+    for (size_t k = 0; k < reps; k++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        times[k] = elapsed.count();
+    }
+    std::sort(times.begin(), times.end());
+    return times[reps / 2];
+}
+
+// n standard normal numbers.
+std::vector<double> normal_data(size_t n, std::mt19937& gen)
+{
+    std::normal_distribution<double> dist;
+    std::vector<double> x(n);
+    for (auto& xi : x)
+        xi = dist(gen);
+    return x;
+}
+
+// the cutoff with the fastest (weighted and unweighted) inversion counts.
+size_t calibrate_merge_sort_cutoff(size_t reps, std::mt19937& gen)
+{
+    const size_t n = 1 << 15;
+    std::vector<double> x = normal_data(n, gen), w = normal_data(n, gen);
+    for (auto& wi : w)
+        wi = std::abs(wi);
+
+    size_t best_cutoff = 1;
+    double best_time = std::numeric_limits<double>::infinity();
+    for (size_t cutoff : {1, 4, 8, 12, 16, 24, 32, 48, 64, 96, 128}) {
+        double time = time_median([&] {
+            std::vector<double> xx = x, ww = w, empty;
+            double count = 0.0;
+            wdm::utils::merge_sort(xx, ww, count, cutoff);
+            xx = x;
+            wdm::utils::merge_sort(xx, empty, count, cutoff);
+        }, reps);
+        std::cout << "  merge_sort_cutoff = " << cutoff << ": "
+                  << time * 1e3 << " ms" << std::endl;
+        if (time < best_time) {
+            best_time = time;
+            best_cutoff = cutoff;
+        }
+    }
+    return best_cutoff;
+}
+
+// the number of lags (relative to log2 of the transform size) from which
+// the FFT is faster than computing each lag.
+double calibrate_fft_lag_factor(size_t reps, std::mt19937& gen)
+{
+    const size_t n = 1 << 14;
+    std::vector<double> x = normal_data(n, gen), y = normal_data(n, gen);
+    wdm::Tuning direct = wdm::get_tuning(), fft = wdm::get_tuning();
+    direct.fft_lag_factor = std::numeric_limits<double>::max();
+    fft.fft_lag_factor = std::numeric_limits<double>::min();
+
+    double factor = 0.0;
+    for (size_t max_lag = 1; max_lag < 512; max_lag *= 2) {
+        wdm::set_tuning(direct);
+        double time_direct = time_median([&] {
+            wdm::wdm_ccf(x, y, max_lag, "pearson");
+        }, reps);
+        wdm::set_tuning(fft);
+        double time_fft = time_median([&] {
+            wdm::wdm_ccf(x, y, max_lag, "pearson");
+        }, reps);
+        std::cout << "  " << 2 * max_lag + 1 << " lags: direct "
+                  << time_direct * 1e3 << " ms, fft " << time_fft * 1e3
+                  << " ms" << std::endl;
+        if (time_fft < time_direct) {
+            // interpolate the crossover linearly in the number of lags
+            // (both costs are about linear in it).
+            double lags = 2 * max_lag + 1;
+            double per_lag = time_direct / lags;
+            double crossover = std::min(lags, time_fft / per_lag);
+            factor = crossover / std::log2(wdm::utils::fft_size(n + max_lag));
+            break;
+        }
+    }
+    return factor;
+}
+
+// the grain size with the fastest parallel matrix of cheap dependence
+// measures; 0 if the host has a single core.
+size_t calibrate_grain_size(size_t reps, std::mt19937& gen)
+{
+    if (std::thread::hardware_concurrency() < 2)
+        return 0;
+    const size_t n = 100, d = 120;
+    Eigen::MatrixXd x(n, d);
+    for (size_t j = 0; j < d; j++)
+        x.col(j) = Eigen::Map<Eigen::VectorXd>(normal_data(n, gen).data(), n);
+
+    wdm::Tuning tuning = wdm::get_tuning();
+    size_t best_grain = tuning.grain_size;
+    double best_time = std::numeric_limits<double>::infinity();
+    for (size_t grain : {1, 2, 4, 8, 16, 32, 64, 128, 256}) {
+        tuning.grain_size = grain;
+        wdm::set_tuning(tuning);
+        double time = time_median([&] {
+            wdm::wdm(x, "pearson", Eigen::VectorXd(), true, 0);
+        }, reps);
+        std::cout << "  grain_size = " << grain << ": " << time * 1e3
+                  << " ms" << std::endl;
+        if (time < best_time) {
+            best_time = time;
+            best_grain = grain;
+        }
+    }
+    return best_grain;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    try {
+        std::map<std::string, std::string> options;
+        options["out"] = "wdm_tuning.cfg";
+        options["reps"] = "7";
+        for (int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            size_t eq = arg.find('=');
+            if ((eq == std::string::npos) || (options.count(arg.substr(0, eq)) == 0)) {
+                std::cerr << "usage: wdm_calibrate [out=<file>] [reps=<repetitions>]"
+                          << std::endl;
+                return EXIT_FAILURE;
+            }
+            options[arg.substr(0, eq)] = arg.substr(eq + 1);
+        }
+        size_t reps = std::max(std::stoul(options["reps"]), 1ul);
+
+        std::mt19937 gen(1);
+        wdm::Tuning defaults, tuning;
+
+        std::cout << "merge sort cutoff:" << std::endl;
+        tuning.merge_sort_cutoff = calibrate_merge_sort_cutoff(reps, gen);
+
+        std::cout << "fft lag factor:" << std::endl;
+        double factor = calibrate_fft_lag_factor(reps, gen);
+        if (factor > 0)
+            tuning.fft_lag_factor = factor;
+        else
+            std::cout << "  no crossover found; keeping the default" << std::endl;
+
+        std::cout << "grain size:" << std::endl;
+        size_t grain = calibrate_grain_size(reps, gen);
+        if (grain > 0)
+            tuning.grain_size = grain;
+        else
+            std::cout << "  single core; keeping the default" << std::endl;
+
+        wdm::set_tuning(defaults);
+        wdm::write_tuning(options["out"], tuning);
+        std::cout << options["out"] << ": merge_sort_cutoff = "
+                  << tuning.merge_sort_cutoff << ", fft_lag_factor = "
+                  << tuning.fft_lag_factor << ", grain_size = "
+                  << tuning.grain_size << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
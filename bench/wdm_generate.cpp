@@ -0,0 +1,38 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Writes a synthetic workload to a file in the binary column format.
+//
+// Usage: wdm_generate out=<file> [key=value ...]
+//
+// The keys are the fields of `bench::Workload_spec`, e.g.
+//   wdm_generate out=data.wdm n=1000000 d=20 copula=clayton tau=0.3
+//                tie_rate=0.1 missing_rate=0.05 weights=pareto seed=7
+
+#include "generator.hpp"
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    try {
+        std::map<std::string, std::string> options;
+        bench::Workload_spec spec = bench::parse_args(argc, argv, options);
+        if ((options.size() != 1) || (options.count("out") == 0)) {
+            std::cerr << "usage: wdm_generate out=<file> [key=value ...]"
+                      << std::endl << "defaults: "
+                      << bench::describe(bench::Workload_spec()) << std::endl;
+            return EXIT_FAILURE;
+        }
+        bench::write(bench::generate(spec), options["out"]);
+        std::cout << options["out"] << ": " << bench::describe(spec)
+                  << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -3,12 +3,40 @@ target_include_directories(wdm INTERFACE
         $<BUILD_INTERFACE:${PROJECT_SOURCE_DIR}/include>
         $<INSTALL_INTERFACE:include>
         )
+find_package(Threads REQUIRED)
+target_link_libraries(wdm INTERFACE Threads::Threads)
+if(ENABLE_TRACE)
+    target_compile_definitions(wdm INTERFACE WDM_TRACE)
+endif()
+
+if(BUILD_COMPILED_LIB)
+    set(wdm_sources ${PROJECT_SOURCE_DIR}/src/wdm.cpp
+                    ${PROJECT_SOURCE_DIR}/src/wdm_c.cpp)
+    add_library(wdm_static STATIC ${wdm_sources})
+    add_library(wdm_shared SHARED ${wdm_sources})
+    foreach(lib wdm_static wdm_shared)
+        target_link_libraries(${lib} PUBLIC wdm)
+        target_compile_definitions(${lib} PUBLIC WDM_COMPILED_LIB)
+        target_compile_options(${lib} PRIVATE ${COMPILED_LIB_ARCH_FLAGS})
+        set_target_properties(${lib} PROPERTIES POSITION_INDEPENDENT_CODE ON)
+    endforeach()
+    set_target_properties(wdm_shared PROPERTIES
+            VERSION ${PROJECT_VERSION}
+            SOVERSION ${PROJECT_VERSION_MAJOR}
+            WINDOWS_EXPORT_ALL_SYMBOLS ON)
+endif(BUILD_COMPILED_LIB)
 
 if(BUILD_TESTING)
+    enable_testing()
     set(EXECUTABLE_OUTPUT_PATH ${PROJECT_BINARY_DIR}/bin)
     add_subdirectory(test)
 endif(BUILD_TESTING)
 
+if(BUILD_BENCHMARKS)
+    set(EXECUTABLE_OUTPUT_PATH ${PROJECT_BINARY_DIR}/bin)
+    add_subdirectory(bench)
+endif(BUILD_BENCHMARKS)
+
 # Related to exports for linux/mac and code coverage
 ####
 # Installation
@@ -49,6 +77,15 @@ configure_package_config_file(
 
 # Targets:
 install(TARGETS wdm EXPORT "${targets_export_name}")
+if(BUILD_COMPILED_LIB)
+    install(TARGETS wdm_static wdm_shared
+            EXPORT "${targets_export_name}"
+            ARCHIVE DESTINATION lib
+            LIBRARY DESTINATION lib
+            RUNTIME DESTINATION bin)
+    install(FILES ${PROJECT_SOURCE_DIR}/include/wdm_c.h
+            DESTINATION "${include_install_dir}")
+endif()
 
 
 file(GLOB_RECURSE main_hpp ${PROJECT_SOURCE_DIR}/include/wdm.hpp)
@@ -8,4 +8,21 @@ endif()
 option(WARNINGS_AS_ERRORS        "Compiler warnings as errors"       "OFF")
 option(OPT_ASAN                  "Use adress sanitizer (debug)"      "ON")
 option(BUILD_TESTING             "Build tests."                      "ON")
-option(CODE_COVERAGE             "Code coverage."                    "OFF")
\ No newline at end of file
+option(CODE_COVERAGE             "Code coverage."                    "OFF")
+option(BUILD_COMPILED_LIB        "Build precompiled libraries."      "OFF")
+option(BUILD_BENCHMARKS          "Build benchmarks."                 "OFF")
+option(ENABLE_TRACE              "Trace parallel loops (WDM_TRACE)." "OFF")
+option(COMPILED_LIB_NATIVE       "Tune precompiled libs to this CPU." "OFF")
+
+# portable by default; with COMPILED_LIB_NATIVE, the libraries only run on
+# CPUs like the build host and may round differently (FMA contraction).
+if(MSVC)
+    set(COMPILED_LIB_ARCH_FLAGS "/O2" CACHE STRING
+        "Optimization flags for the precompiled libraries.")
+else()
+    set(COMPILED_LIB_ARCH_FLAGS "-O3" CACHE STRING
+        "Optimization flags for the precompiled libraries.")
+    if(COMPILED_LIB_NATIVE)
+        list(APPEND COMPILED_LIB_ARCH_FLAGS "-march=native")
+    endif()
+endif()
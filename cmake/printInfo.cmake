@@ -14,4 +14,8 @@ message( STATUS "CMAKE_CXX_FLAGS_RELEASE=       ${CMAKE_CXX_FLAGS_RELEASE}")
 message( STATUS )
 message( STATUS "BUILD_TESTING=                 ${BUILD_TESTING}")
 message( STATUS "CODE_COVERAGE=                 ${CODE_COVERAGE}")
+message( STATUS "BUILD_COMPILED_LIB=            ${BUILD_COMPILED_LIB}")
+message( STATUS "COMPILED_LIB_ARCH_FLAGS=       ${COMPILED_LIB_ARCH_FLAGS}")
+message( STATUS "BUILD_BENCHMARKS=              ${BUILD_BENCHMARKS}")
+message( STATUS "ENABLE_TRACE=                  ${ENABLE_TRACE}")
 message( STATUS )
\ No newline at end of file
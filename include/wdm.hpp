@@ -6,13 +6,28 @@
 
 #pragma once
 
+#include "wdm/config.hpp"
+#include "wdm/methods.hpp"
+#include "wdm/status.hpp"
+#include "wdm/types.hpp"
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// the kernels are only needed by the definitions below; consumers of the
+// precompiled libraries only parse the declarations.
+#if WDM_HEADER_ONLY
 #include "wdm/ktau.hpp"
 #include "wdm/hoeffd.hpp"
 #include "wdm/prho.hpp"
 #include "wdm/srho.hpp"
 #include "wdm/bbeta.hpp"
-#include "wdm/methods.hpp"
+#include "wdm/xi.hpp"
+#include "wdm/dcor.hpp"
 #include "wdm/nan_handling.hpp"
+#endif
 
 //! Weighted dependence measures
 namespace wdm {
@@ -31,31 +46,18 @@ namespace wdm {
 //!   - `"kendall"`, `"ktau"`, `"tau"`: Kendall's \f$ \tau \f$
 //!   - `"blomqvist"`, `"bbeta"`, `"beta"`: Blomqvist's \f$ \beta \f$
 //!   - `"hoeffding"`, `"hoeffd"`, `"d"`: Hoeffding's \f$ D \f$
+//!   - `"chatterjee"`, `"xi"`: Chatterjee's \f$ \xi \f$ (measures how much
+//!     `y` is a function of `x`; not symmetric; weights must be equal)
+//!   - `"dcor"`, `"distance"`: distance correlation
+//!   - `"htau"`, `"hyperbolic"`: weighted Kendall's \f$ \tau \f$ with
+//!     additive hyperbolic rank weights (Vigna, 2015)
 //!
 //! @return the dependence measure
-inline double wdm(std::vector<double> x,
-                  std::vector<double> y,
-                  std::string method,
-                  std::vector<double> weights = std::vector<double>(),
-                  bool remove_missing = true)
-{
-    utils::check_sizes(x, y, weights);
-    // na handling
-    if (utils::preproc(x, y, weights, method, remove_missing) == "return_nan")
-        return std::numeric_limits<double>::quiet_NaN();
-
-    if (methods::is_hoeffding(method))
-        return impl::hoeffd(x, y, weights);
-    if (methods::is_kendall(method))
-        return impl::ktau(x, y, weights);
-    if (methods::is_pearson(method))
-        return impl::prho(x, y, weights);
-    if (methods::is_spearman(method))
-        return impl::srho(x, y, weights);
-    if (methods::is_blomqvist(method))
-        return impl::bbeta(x, y, weights);
-    throw std::runtime_error("method not implemented.");
-}
+WDM_INLINE double wdm(std::vector<double> x,
+                      std::vector<double> y,
+                      std::string method,
+                      std::vector<double> weights = std::vector<double>(),
+                      bool remove_missing = true);
 
 
 //! Independence test
@@ -70,7 +72,16 @@ inline double wdm(std::vector<double> x,
 //!   - `"kendall"`, `"ktau"`, `"tau"`: Kendall's \f$ \tau \f$
 //!   - `"blomqvist"`, `"bbeta"`, `"beta"`: Blomqvist's \f$ \beta \f$
 //!   - `"hoeffding"`, `"hoeffd"`, `"d"`: Hoeffding's \f$ D \f$
+//!   - `"chatterjee"`, `"xi"`: Chatterjee's \f$ \xi \f$ (measures how much
+//!     `y` is a function of `x`; not symmetric; weights must be equal)
+//!   - `"dcor"`, `"distance"`: distance correlation
 //!
+//! The estimate is computed on construction; the test statistic and p-value
+//! are only computed when first requested. This happens exactly once, also
+//! if several threads share an object (copies share the results). Errors
+//! while computing the statistic (e.g., from the data needed for
+//! Chatterjee's \f$ \xi \f$ or the distance correlation) are therefore
+//! thrown by `statistic()` and `p_value()`, not by the constructor.
 class Indep_test {
 public:
     Indep_test() = delete;
@@ -83,29 +94,36 @@ public:
     //! @param alternative indicates the alternative hypothesis and must be one
     //!    of `"two-sided"``, `"greater"` or `"less"`; `"greater"` corresponds
     //!    to positive association, `"less"` to negative association. For
-    //!    Hoeffding's \f$ D \f$, only `"two-sided"` is allowed.
-    Indep_test(std::vector<double> x,
-               std::vector<double> y,
-               std::string method,
-               std::vector<double> weights = std::vector<double>(),
-               bool remove_missing = true,
-               std::string alternative = "two-sided") :
-        method_(method),
-        alternative_(alternative)
-    {
-        utils::check_sizes(x, y, weights);
-        if (utils::preproc(x, y, weights, method, remove_missing) == "return_nan") {
-            n_eff_ = utils::effective_sample_size(x.size(), weights);
-            estimate_  = std::numeric_limits<double>::quiet_NaN();
-            statistic_ = std::numeric_limits<double>::quiet_NaN();
-            p_value_   = std::numeric_limits<double>::quiet_NaN();
-        } else {
-            n_eff_ = utils::effective_sample_size(x.size(), weights);
-            estimate_ = wdm(x, y, method, weights, false);
-            statistic_ = compute_test_stat(estimate_, method, n_eff_, x, y, weights);
-            p_value_ = compute_p_value(statistic_, method, alternative, n_eff_);
-        }
-    }
+    //!    Hoeffding's \f$ D \f$ and the distance correlation, only
+    //!    `"two-sided"` is allowed. For
+    //!    Chatterjee's \f$ \xi \f$, `"greater"` gives the usual one-sided
+    //!    test (dependence of any kind increases \f$ \xi \f$).
+    WDM_INLINE Indep_test(std::vector<double> x,
+                          std::vector<double> y,
+                          std::string method,
+                          std::vector<double> weights = std::vector<double>(),
+                          bool remove_missing = true,
+                          std::string alternative = "two-sided");
+
+    //! test from an already computed estimate (e.g., from a matrix of
+    //! dependence measures).
+    //! @param estimate the dependence measure.
+    //! @param method the dependence measure; Chatterjee's \f$ \xi \f$ and the
+    //!    distance correlation are not supported since their tests need the
+    //!    data.
+    //! @param n the number of (complete) observations.
+    //! @param weights weights of the complete observations (or empty).
+    //! @param alternative the alternative hypothesis; see above.
+    //! @param ties_x, ties_y tie statistics of both variables (see
+    //!    `margin_ties()`); only used for Kendall's \f$ \tau \f$. The
+    //!    defaults correspond to data without ties.
+    WDM_INLINE Indep_test(double estimate,
+                          std::string method,
+                          size_t n,
+                          std::vector<double> weights = std::vector<double>(),
+                          std::string alternative = "two-sided",
+                          Margin_ties ties_x = Margin_ties(),
+                          Margin_ties ties_y = Margin_ties());
 
     //! the method used for the test
     std::string method() const {return method_;}
@@ -120,78 +138,376 @@ public:
     double estimate() const {return estimate_;}
 
     //! the test statistic
-    double statistic() const {return statistic_;}
+    double statistic() const
+    {
+        compute_test();
+        return lazy_->statistic;
+    }
 
     //! the p-value
-    double p_value() const {return p_value_;}
+    double p_value() const
+    {
+        compute_test();
+        return lazy_->p_value;
+    }
 
 private:
 
-    inline double compute_test_stat(double estimate,
-                                    std::string method,
-                                    double n_eff,
-                                    const std::vector<double>& x,
-                                    const std::vector<double>& y,
-                                    const std::vector<double>& weights)
-    {
-        // prevent overflow in atanh
-        if (estimate == 1.0)
-            estimate = 1 - 1e-12;
-        if (estimate == -1.0)
-            estimate = 1e-12;
-
-        double stat;
-        if (methods::is_hoeffding(method)) {
-            stat = estimate / 30.0 + 1.0 / (36.0 * n_eff);
-        } else if (methods::is_kendall(method)) {
-            stat = estimate * impl::ktau_stat_adjust(x, y, weights);
-        } else if (methods::is_pearson(method)) {
-            stat = std::atanh(estimate) * std::sqrt(n_eff - 3);
-        } else if (methods::is_spearman(method)) {
-            stat = std::atanh(estimate) * std::sqrt((n_eff - 3) / 1.06);
-        }  else if (methods::is_blomqvist(method)) {
-            stat = std::atanh(estimate) * std::sqrt(n_eff);
-        } else {
-            throw std::runtime_error("method not implemented.");
-        }
+    WDM_INLINE void check_test_args() const;
 
-        return stat;
-    }
+    WDM_INLINE void compute_test() const;
 
-    inline double compute_p_value(double statistic,
-                                  std::string method,
-                                  std::string alternative,
-                                  double n_eff = 0.0)
-    {
-        double p_value;
-        if (methods::is_hoeffding(method)) {
-            if (n_eff == 0.0)
-                throw std::runtime_error("must provide n_eff for method 'hoeffd'.");
-            if (alternative != "two-sided")
-                throw std::runtime_error("only two-sided test available for Hoeffding's D.");
-            p_value = impl::phoeffb(statistic, n_eff);
-        } else {
-            if (alternative == "two-sided") {
-                p_value = 2 * utils::normalCDF(-std::abs(statistic));
-            } else if (alternative == "less") {
-                p_value = utils::normalCDF(statistic);
-            } else if (alternative == "greater") {
-                p_value = 1 - utils::normalCDF(statistic);
-            } else {
-                throw std::runtime_error("alternative not implemented.");
-            }
-        }
+    WDM_INLINE double compute_test_stat() const;
 
-        return p_value;
-    }
+    WDM_INLINE double compute_p_value(double statistic) const;
 
     std::string method_;
     std::string alternative_;
     double n_eff_;
     double estimate_;
-    double statistic_;
-    double p_value_;
+
+    size_t n_;
+    bool has_ties_;
+    Margin_ties ties_x_;
+    Margin_ties ties_y_;
+
+    //! the lazily computed part of the test; shared by copies.
+    struct Lazy_test {
+        std::once_flag once;
+        // the data needed for the statistic; released once it is computed.
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<double> weights;
+        double statistic = std::numeric_limits<double>::quiet_NaN();
+        double p_value = std::numeric_limits<double>::quiet_NaN();
+    };
+
+    // whether the results (`nan`) are known on construction.
+    bool computed_;
+    std::shared_ptr<Lazy_test> lazy_;
 };
 
+//! tie statistics of a variable for tests from precomputed estimates (see
+//! `Indep_test`).
+//! @param x input data (without missing values).
+//! @param weights an optional vector of weights for the data.
+WDM_INLINE Margin_ties margin_ties(std::vector<double> x,
+                                   std::vector<double> weights = std::vector<double>());
+
+//! calculates (weighted) dependence measures without throwing.
+//!
+//! Same as `wdm()`, but all problems are reported as a `Status`. Degenerate
+//! inputs (too few observations, all observations missing, constant `x` or
+//! `y`) are reported as `Status::too_few_observations`, `Status::all_missing`,
+//! and `Status::zero_variance`; `result` is then `nan`. Unequal weights for
+//! Chatterjee's \f$ \xi \f$ are reported as `Status::invalid_weights`.
+//!
+//! @param result the dependence measure (output).
+//! @param x, y input data.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing if `true`, all observations containing a `nan` are
+//!    removed; otherwise `Status::missing_values` is returned if `nan`s are
+//!    present.
+//! @return `Status::ok` on success.
+WDM_INLINE Status try_wdm(double& result,
+                          std::vector<double> x,
+                          std::vector<double> y,
+                          std::string method,
+                          std::vector<double> weights = std::vector<double>(),
+                          bool remove_missing = true) noexcept;
+
+//! independence test without throwing.
+//!
+//! Same as `Indep_test`, but all problems are reported as a `Status`; see
+//! `try_wdm()` for details. Fields of `result` that cannot be computed are
+//! `nan`.
+//!
+//! @param result the test results (output).
+//! @param x, y, method, weights, remove_missing, alternative see
+//!   `Indep_test`.
+//! @return `Status::ok` on success.
+WDM_INLINE Status try_indep_test(Test_result& result,
+                                 std::vector<double> x,
+                                 std::vector<double> y,
+                                 std::string method,
+                                 std::vector<double> weights = std::vector<double>(),
+                                 bool remove_missing = true,
+                                 std::string alternative = "two-sided") noexcept;
+
+#if WDM_HEADER_ONLY
+
+WDM_INLINE double wdm(std::vector<double> x,
+                      std::vector<double> y,
+                      std::string method,
+                      std::vector<double> weights,
+                      bool remove_missing)
+{
+    utils::check_sizes(x, y, weights);
+    // na handling
+    Status status = utils::preproc(x, y, weights, method, remove_missing);
+    if (status != Status::ok) {
+        if (remove_missing && is_degenerate(status))
+            return std::numeric_limits<double>::quiet_NaN();
+        utils::throw_preproc_error(status, method);
+    }
+
+    if (methods::is_hoeffding(method))
+        return impl::hoeffd(x, y, weights);
+    if (methods::is_kendall(method))
+        return impl::ktau(x, y, weights);
+    if (methods::is_pearson(method))
+        return impl::prho(x, y, weights);
+    if (methods::is_spearman(method))
+        return impl::srho(x, y, weights);
+    if (methods::is_blomqvist(method))
+        return impl::bbeta(x, y, weights);
+    if (methods::is_chatterjee(method))
+        return impl::xi(x, y, weights);
+    if (methods::is_dcor(method))
+        return impl::dcor(x, y, weights);
+    if (methods::is_htau(method))
+        return impl::htau(x, y, weights);
+    throw std::runtime_error("method not implemented.");
+}
+
+WDM_INLINE Indep_test::Indep_test(std::vector<double> x,
+                                  std::vector<double> y,
+                                  std::string method,
+                                  std::vector<double> weights,
+                                  bool remove_missing,
+                                  std::string alternative) :
+    method_(method),
+    alternative_(alternative),
+    has_ties_(false),
+    computed_(false),
+    lazy_(std::make_shared<Lazy_test>())
+{
+    utils::check_sizes(x, y, weights);
+    Status status = utils::preproc(x, y, weights, method, remove_missing);
+    if ((status != Status::ok) && !(remove_missing && is_degenerate(status)))
+        utils::throw_preproc_error(status, method);
+    n_ = x.size();
+    n_eff_ = utils::effective_sample_size(n_, weights);
+    if (status != Status::ok) {
+        estimate_ = std::numeric_limits<double>::quiet_NaN();
+        computed_ = true;
+    } else {
+        estimate_ = wdm(x, y, method, weights, false);
+        check_test_args();
+        // only some statistics need more than the estimate.
+        if (methods::is_kendall(method) || methods::is_chatterjee(method) ||
+            methods::is_dcor(method)) {
+            lazy_->x = std::move(x);
+            lazy_->y = std::move(y);
+            lazy_->weights = std::move(weights);
+        }
+    }
+}
+
+WDM_INLINE Indep_test::Indep_test(double estimate,
+                                  std::string method,
+                                  size_t n,
+                                  std::vector<double> weights,
+                                  std::string alternative,
+                                  Margin_ties ties_x,
+                                  Margin_ties ties_y) :
+    method_(method),
+    alternative_(alternative),
+    estimate_(estimate),
+    n_(n),
+    has_ties_(true),
+    ties_x_(ties_x),
+    ties_y_(ties_y),
+    computed_(false),
+    lazy_(std::make_shared<Lazy_test>())
+{
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    if (methods::is_chatterjee(method) || methods::is_dcor(method)) {
+        throw std::runtime_error("the test for method '" + method +
+                                 "' needs the data.");
+    }
+    if ((weights.size() > 0) && (weights.size() != n))
+        throw std::runtime_error("weights must have size n.");
+    if (utils::any_nan(weights))
+        throw std::runtime_error("weights must not contain nan.");
+    n_eff_ = utils::effective_sample_size(n, weights);
+    if (n < methods::get_min_nobs(method)) {
+        estimate_ = std::numeric_limits<double>::quiet_NaN();
+        computed_ = true;
+    } else {
+        check_test_args();
+        if (methods::is_kendall(method))
+            lazy_->weights = std::move(weights);
+    }
+}
+
+WDM_INLINE void Indep_test::check_test_args() const
+{
+    if (!methods::has_indep_test(method_)) {
+        throw std::runtime_error("no independence test available for method '" +
+                                 method_ + "'.");
+    }
+    if (methods::is_hoeffding(method_)) {
+        if (n_eff_ == 0.0)
+            throw std::runtime_error("must provide n_eff for method 'hoeffd'.");
+        if (alternative_ != "two-sided")
+            throw std::runtime_error("only two-sided test available for Hoeffding's D.");
+    } else {
+        if (methods::is_two_sided_only(method_) && (alternative_ != "two-sided"))
+            throw std::runtime_error("only two-sided test available for " +
+                                     method_ + ".");
+        if ((alternative_ != "two-sided") && (alternative_ != "less") &&
+            (alternative_ != "greater"))
+            throw std::runtime_error("alternative not implemented.");
+    }
+}
+
+WDM_INLINE void Indep_test::compute_test() const
+{
+    if (computed_)
+        return;
+    // if the computation throws, the next call tries again.
+    std::call_once(lazy_->once, [this] {
+        lazy_->statistic = compute_test_stat();
+        lazy_->p_value = compute_p_value(lazy_->statistic);
+        std::vector<double>().swap(lazy_->x);
+        std::vector<double>().swap(lazy_->y);
+        std::vector<double>().swap(lazy_->weights);
+    });
+}
+
+WDM_INLINE double Indep_test::compute_test_stat() const
+{
+    // prevent overflow in atanh (also if rounding pushes |estimate| above 1)
+    double estimate = estimate_;
+    double est_trunc = std::max(-1 + 1e-12, std::min(1 - 1e-12, estimate));
+
+    double stat;
+    if (methods::is_hoeffding(method_)) {
+        stat = estimate / 30.0 + 1.0 / (36.0 * n_eff_);
+    } else if (methods::is_kendall(method_)) {
+        if (has_ties_)
+            stat = estimate * impl::ktau_stat_adjust(ties_x_, ties_y_, lazy_->weights, n_);
+        else
+            stat = estimate * impl::ktau_stat_adjust(lazy_->x, lazy_->y, lazy_->weights);
+    } else if (methods::is_pearson(method_)) {
+        stat = std::atanh(est_trunc) * std::sqrt(n_eff_ - 3);
+    } else if (methods::is_spearman(method_)) {
+        stat = std::atanh(est_trunc) * std::sqrt((n_eff_ - 3) / 1.06);
+    }  else if (methods::is_blomqvist(method_)) {
+        stat = std::atanh(est_trunc) * std::sqrt(n_eff_);
+    } else if (methods::is_chatterjee(method_)) {
+        stat = estimate * impl::xi_stat_adjust(lazy_->x, lazy_->y, lazy_->weights);
+    } else if (methods::is_dcor(method_)) {
+        stat = estimate * impl::dcor_stat_adjust(lazy_->x, lazy_->y, lazy_->weights);
+    } else {
+        throw std::runtime_error("method not implemented.");
+    }
+
+    return stat;
+}
+
+WDM_INLINE double Indep_test::compute_p_value(double statistic) const
+{
+    double p_value;
+    if (methods::is_hoeffding(method_)) {
+        p_value = impl::phoeffb(statistic, n_eff_);
+    } else if (alternative_ == "two-sided") {
+        p_value = 2 * utils::normalCDF(-std::abs(statistic));
+    } else if (alternative_ == "less") {
+        p_value = utils::normalCDF(statistic);
+    } else {
+        p_value = 1 - utils::normalCDF(statistic);
+    }
+
+    return p_value;
+}
+
+WDM_INLINE Margin_ties margin_ties(std::vector<double> x,
+                                   std::vector<double> weights)
+{
+    utils::check_sizes(x, x, weights);
+    if (utils::any_nan(x) || utils::any_nan(weights))
+        throw std::runtime_error("x and weights must not contain nan.");
+    return impl::margin_ties(x, weights);
+}
+
+WDM_INLINE Status try_wdm(double& result,
+                          std::vector<double> x,
+                          std::vector<double> y,
+                          std::string method,
+                          std::vector<double> weights,
+                          bool remove_missing) noexcept
+{
+    result = std::numeric_limits<double>::quiet_NaN();
+    try {
+        if (!methods::is_implemented(method))
+            return Status::invalid_method;
+        if ((y.size() != x.size()) ||
+            ((weights.size() > 0) && (weights.size() != x.size())))
+            return Status::size_mismatch;
+        Status status = utils::preproc(x, y, weights, method, remove_missing);
+        if (status != Status::ok)
+            return status;
+        if (utils::any_constant(x, y, weights))
+            return Status::zero_variance;
+        result = wdm(x, y, method, weights, false);
+    } catch (const std::bad_alloc&) {
+        result = std::numeric_limits<double>::quiet_NaN();
+        return Status::out_of_memory;
+    } catch (...) {
+        result = std::numeric_limits<double>::quiet_NaN();
+        return Status::internal_error;
+    }
+
+    return Status::ok;
+}
+
+WDM_INLINE Status try_indep_test(Test_result& result,
+                                 std::vector<double> x,
+                                 std::vector<double> y,
+                                 std::string method,
+                                 std::vector<double> weights,
+                                 bool remove_missing,
+                                 std::string alternative) noexcept
+{
+    result = Test_result();
+    try {
+        if (!methods::is_implemented(method) || !methods::has_indep_test(method))
+            return Status::invalid_method;
+        if ((alternative != "two-sided") && (alternative != "greater") &&
+            (alternative != "less"))
+            return Status::invalid_alternative;
+        if (methods::is_two_sided_only(method) && (alternative != "two-sided"))
+            return Status::invalid_alternative;
+        if ((y.size() != x.size()) ||
+            ((weights.size() > 0) && (weights.size() != x.size())))
+            return Status::size_mismatch;
+        Status status = utils::preproc(x, y, weights, method, remove_missing);
+        if (status == Status::missing_values)
+            return status;
+        result.n_eff = utils::effective_sample_size(x.size(), weights);
+        if (status != Status::ok)
+            return status;
+        if (utils::any_constant(x, y, weights))
+            return Status::zero_variance;
+        Indep_test test(x, y, method, weights, false, alternative);
+        result.estimate = test.estimate();
+        result.statistic = test.statistic();
+        result.p_value = test.p_value();
+    } catch (const std::bad_alloc&) {
+        result = Test_result();
+        return Status::out_of_memory;
+    } catch (...) {
+        result = Test_result();
+        return Status::internal_error;
+    }
+
+    return Status::ok;
+}
+
+#endif // WDM_HEADER_ONLY
 
 }
@@ -0,0 +1,537 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "../wdm.hpp"
+#include "fft.hpp"
+#include "ktau.hpp"
+#include "parallel.hpp"
+#include "prho.hpp"
+#include "utils.hpp"
+
+namespace wdm {
+
+namespace impl {
+
+//! a series whose values are replaced by codes 0, ..., levels - 1 that
+//! preserve their order (ties share a code).
+struct Coded_series {
+    std::vector<size_t> codes;
+    size_t levels;
+};
+
+inline Coded_series code_series(const std::vector<double>& x)
+{
+    Coded_series s{std::vector<size_t>(x.size()), 0};
+    std::vector<size_t> perm = utils::get_order(x);
+    for (size_t k = 0; k < perm.size(); k++) {
+        if ((k > 0) && (x[perm[k]] != x[perm[k - 1]]))
+            s.levels++;
+        s.codes[perm[k]] = s.levels;
+    }
+    if (x.size() > 0)
+        s.levels++;
+    return s;
+}
+
+//! stable counting sort of the indices `perm` by their codes
+//! `s.codes[first + perm[i]]`.
+inline std::vector<size_t> counting_sort(const std::vector<size_t>& perm,
+                                         const Coded_series& s,
+                                         size_t first)
+{
+    std::vector<size_t> start(s.levels + 1, 0);
+    for (size_t i : perm)
+        start[s.codes[first + i] + 1]++;
+    for (size_t c = 0; c < s.levels; c++)
+        start[c + 1] += start[c];
+    std::vector<size_t> sorted(perm.size());
+    for (size_t i : perm)
+        sorted[start[s.codes[first + i]]++] = i;
+    return sorted;
+}
+
+//! average ranks (starting at 0) of the segment `[first, first + len)`.
+inline std::vector<double> segment_ranks(const Coded_series& s,
+                                         size_t first,
+                                         size_t len)
+{
+    std::vector<double> level_rank(s.levels, 0.0);
+    for (size_t i = 0; i < len; i++)
+        level_rank[s.codes[first + i]]++;
+    double below = 0.0;
+    for (size_t c = 0; c < s.levels; c++) {
+        double count = level_rank[c];
+        level_rank[c] = below + (count - 1) / 2;
+        below += count;
+    }
+    std::vector<double> ranks(len);
+    for (size_t i = 0; i < len; i++)
+        ranks[i] = level_rank[s.codes[first + i]];
+    return ranks;
+}
+
+//! the pairs `(x[x_first + t], y[y_first + t])`, `t = 0, ..., len - 1`.
+struct Lag {
+    size_t x_first;
+    size_t y_first;
+    size_t len;
+};
+
+//! the pairs `(x[t], y[t + k])` for lag `k = i - max_lag` of two series of
+//! length `n`.
+inline Lag ccf_lag(size_t i, size_t max_lag, size_t n)
+{
+    if (i >= max_lag)
+        return Lag{0, i - max_lag, n - (i - max_lag)};
+    return Lag{max_lag - i, 0, n - (max_lag - i)};
+}
+
+//! the elements `x[first], ..., x[first + len - 1]`.
+inline std::vector<double> segment(const std::vector<double>& x,
+                                   size_t first,
+                                   size_t len)
+{
+    return std::vector<double>(x.begin() + first, x.begin() + first + len);
+}
+
+//! weights of the pairs of a lag (the products of the observations'
+//! weights).
+inline std::vector<double> pair_weights(const std::vector<double>& weights,
+                                        const Lag& lag)
+{
+    if (weights.size() == 0)
+        return std::vector<double>();
+    std::vector<double> w(lag.len);
+    for (size_t t = 0; t < lag.len; t++)
+        w[t] = weights[lag.x_first + t] * weights[lag.y_first + t];
+    return w;
+}
+
+//! lagged pairs of two series.
+//!
+//! For Kendall's \f$ \tau \f$ and Spearman's \f$ \rho \f$, both series are
+//! coded once. A segment is then sorted or ranked by counting in O(n) time,
+//! so that only the merge sort of Kendall's \f$ \tau \f$ remains per lag.
+//! Other methods (and weighted series or series with missing values) are
+//! handled by `wdm()`. A pair has the product of its observations' weights.
+class Lagged_pairs {
+public:
+    Lagged_pairs(const std::vector<double>& x,
+                 const std::vector<double>& y,
+                 const std::string& method,
+                 const std::vector<double>& weights) :
+        x_(x),
+        y_(y),
+        weights_(weights),
+        method_(method)
+    {
+        utils::check_sizes(x, y, weights);
+        if (!methods::is_implemented(method))
+            throw std::runtime_error("method not implemented.");
+        coded_ = (methods::is_kendall(method) || methods::is_spearman(method)) &&
+            (weights.size() == 0);
+        for (size_t i = 0; coded_ && (i < x.size()); i++)
+            coded_ = !std::isnan(x[i]) && !std::isnan(y[i]);
+        if (coded_) {
+            cx_ = code_series(x);
+            cy_ = (&x == &y) ? cx_ : code_series(y);
+        }
+    }
+
+    double estimate(const Lag& lag, bool remove_missing) const
+    {
+        size_t x_first = lag.x_first, y_first = lag.y_first, len = lag.len;
+        if (!coded_ || (len < methods::get_min_nobs(method_))) {
+            return wdm(segment(x_, x_first, len),
+                       segment(y_, y_first, len),
+                       method_,
+                       pair_weights(weights_, lag),
+                       remove_missing);
+        }
+        if (methods::is_spearman(method_)) {
+            return prho(segment_ranks(cx_, x_first, len),
+                        segment_ranks(cy_, y_first, len));
+        }
+
+        // sort in x order, ties broken according to y (by two stable
+        // counting sorts).
+        std::vector<size_t> perm(len);
+        for (size_t i = 0; i < len; i++)
+            perm[i] = i;
+        perm = counting_sort(counting_sort(perm, cy_, y_first), cx_, x_first);
+        std::vector<double> xx(len), yy(len);
+        for (size_t i = 0; i < len; i++) {
+            xx[i] = static_cast<double>(cx_.codes[x_first + perm[i]]);
+            yy[i] = static_cast<double>(cy_.codes[y_first + perm[i]]);
+        }
+        return ktau_sorted(xx, std::move(yy));
+    }
+
+    Test_result test(const Lag& lag,
+                     bool remove_missing,
+                     const std::string& alternative) const
+    {
+        Indep_test test(segment(x_, lag.x_first, lag.len),
+                        segment(y_, lag.y_first, lag.len),
+                        method_,
+                        pair_weights(weights_, lag),
+                        remove_missing,
+                        alternative);
+        Test_result result;
+        result.n_eff = test.n_eff();
+        result.estimate = test.estimate();
+        result.statistic = test.statistic();
+        result.p_value = test.p_value();
+        return result;
+    }
+
+private:
+    const std::vector<double>& x_;
+    const std::vector<double>& y_;
+    const std::vector<double>& weights_;
+    std::string method_;
+    bool coded_;
+    Coded_series cx_, cy_;
+};
+
+//! `run[t]` is the number of consecutive elements starting at `t` that are
+//! equal to `x[t]`.
+inline std::vector<size_t> run_lengths(const std::vector<double>& x)
+{
+    size_t n = x.size();
+    std::vector<size_t> run(n);
+    for (size_t t = n; t-- > 0;)
+        run[t] = ((t + 1 < n) && (x[t + 1] == x[t])) ? run[t + 1] + 1 : 1;
+    return run;
+}
+
+//! prefix sums with compensation for rounding errors (Neumaier), so that
+//! sums over segments are accurate to almost full precision.
+class Prefix_sums {
+public:
+    explicit Prefix_sums(const std::vector<double>& x) :
+        sum_(x.size() + 1, 0.0),
+        comp_(x.size() + 1, 0.0)
+    {
+        double s = 0.0, c = 0.0;
+        for (size_t i = 0; i < x.size(); i++) {
+            double t = s + x[i];
+            if (std::abs(s) >= std::abs(x[i]))
+                c += (s - t) + x[i];
+            else
+                c += (x[i] - t) + s;
+            s = t;
+            sum_[i + 1] = s;
+            comp_[i + 1] = c;
+        }
+    }
+
+    //! the sum of `x[first], ..., x[first + len - 1]`.
+    double operator()(size_t first, size_t len) const
+    {
+        return (sum_[first + len] - sum_[first]) +
+            (comp_[first + len] - comp_[first]);
+    }
+
+private:
+    std::vector<double> sum_;
+    std::vector<double> comp_;
+};
+
+//! centers `x` and scales it to [-1, 1]; Pearson's correlation is invariant
+//! to both, and it keeps the cross products of the transforms in range.
+inline std::vector<double> fft_standardize(std::vector<double> x)
+{
+    double mu = utils::sum(x) / static_cast<double>(x.size()), scale = 0.0;
+    for (auto& xi : x) {
+        xi -= mu;
+        scale = std::max(scale, std::abs(xi));
+    }
+    if (scale > 0.0) {
+        for (auto& xi : x)
+            xi /= scale;
+    }
+    return x;
+}
+
+//! whether `prho_ccf()` is applicable: all values must be finite, all
+//! weights positive, and all lags must have at least two pairs.
+inline bool prho_ccf_applicable(const std::vector<double>& x,
+                                const std::vector<double>& y,
+                                const std::vector<double>& weights,
+                                size_t max_lag)
+{
+    if (x.size() - max_lag < 2)
+        return false;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (!std::isfinite(x[i]) || !std::isfinite(y[i]))
+            return false;
+    }
+    for (double w : weights) {
+        if (!(w > 0.0) || !std::isfinite(w))
+            return false;
+    }
+    return true;
+}
+
+//! whether to compute Pearson correlations with `prho_ccf()` instead of lag
+//! by lag; `num_lags` is the number of lags requested.
+inline bool use_prho_ccf(const std::vector<double>& x,
+                         const std::vector<double>& y,
+                         const std::vector<double>& weights,
+                         const std::string& method,
+                         size_t max_lag,
+                         size_t num_lags)
+{
+    if (!methods::is_pearson(method))
+        return false;
+    // the transforms cost about as much as fft_lag_factor * log2(size)
+    // direct lags (see `Tuning`).
+    double log_size = std::log2(utils::fft_size(x.size() + max_lag));
+    if (num_lags < get_tuning().fft_lag_factor * log_size)
+        return false;
+    return prho_ccf_applicable(x, y, weights, max_lag);
+}
+
+//! Pearson correlations between `x[t]` and `y[t + k]` for all lags
+//! `k = -max_lag, ..., max_lag` in O(n log n) time.
+//! @param x, y input data (finite).
+//! @param max_lag the largest lag.
+//! @param weights an optional vector of positive weights; a pair has the
+//!   product of its observations' weights.
+//! @return a vector of length `2 * max_lag + 1`; see `wdm_ccf()`.
+//! @details The lagged cross products are computed by the fast Fourier
+//!   transform. Without weights, the means and variances of each lag follow
+//!   from compensated prefix sums; with weights, they are lagged products
+//!   with the weights as well. Lags where `x` or `y` is constant are `nan`
+//!   (as in `prho()`). The rounding error of the transform is bounded
+//!   relative to the total (squared) weight of the series; lags whose
+//!   variances are too small for this bound to be negligible (e.g., short
+//!   segments next to outliers) are computed directly.
+inline std::vector<double> prho_ccf(const std::vector<double>& x,
+                                    const std::vector<double>& y,
+                                    size_t max_lag,
+                                    const std::vector<double>& weights)
+{
+    size_t n = x.size(), num_lags = 2 * max_lag + 1;
+    std::vector<double> xs = fft_standardize(x), ys = fft_standardize(y);
+    size_t size = utils::fft_size(n + max_lag);
+
+    // sums of (weights of) x * y, x, y, x^2, y^2 and weights for each lag.
+    std::vector<double> s_xy, s_x, s_y, s_xx, s_yy, s_w;
+    utils::Spectrum f_x, f_y;
+    if (weights.size() == 0) {
+        utils::fft_real_pair(xs, ys, size, f_x, f_y);
+        std::vector<double> unused;
+        utils::fft_cross_products(f_x, f_y, f_x, f_y, max_lag, s_xy, unused);
+
+        std::vector<double> xx(n), yy(n);
+        for (size_t t = 0; t < n; t++) {
+            xx[t] = xs[t] * xs[t];
+            yy[t] = ys[t] * ys[t];
+        }
+        Prefix_sums p_x(xs), p_y(ys), p_xx(xx), p_yy(yy);
+        s_x.resize(num_lags);
+        s_y.resize(num_lags);
+        s_xx.resize(num_lags);
+        s_yy.resize(num_lags);
+        s_w.resize(num_lags);
+        for (size_t i = 0; i < num_lags; i++) {
+            Lag lag = ccf_lag(i, max_lag, n);
+            s_x[i] = p_x(lag.x_first, lag.len);
+            s_y[i] = p_y(lag.y_first, lag.len);
+            s_xx[i] = p_xx(lag.x_first, lag.len);
+            s_yy[i] = p_yy(lag.y_first, lag.len);
+            s_w[i] = static_cast<double>(lag.len);
+        }
+    } else {
+        std::vector<double> wx(n), wy(n), wxx(n), wyy(n);
+        for (size_t t = 0; t < n; t++) {
+            wx[t] = weights[t] * xs[t];
+            wy[t] = weights[t] * ys[t];
+            wxx[t] = wx[t] * xs[t];
+            wyy[t] = wy[t] * ys[t];
+        }
+        utils::Spectrum f_xx, f_yy, f_w, unused;
+        utils::fft_real_pair(wx, wy, size, f_x, f_y);
+        utils::fft_real_pair(wxx, wyy, size, f_xx, f_yy);
+        utils::fft_real_pair(weights, std::vector<double>(), size, f_w, unused);
+        utils::fft_cross_products(f_x, f_y, f_x, f_w, max_lag, s_xy, s_x);
+        utils::fft_cross_products(f_w, f_y, f_xx, f_w, max_lag, s_y, s_xx);
+        utils::fft_cross_products(f_w, f_yy, f_w, f_w, max_lag, s_yy, s_w);
+    }
+
+    // all standardized values are in [-1, 1], so the rounding errors of
+    // the covariance and variances are at most a small multiple of
+    // eps * log2(size) * sum(w^2).
+    double w2_sum = (weights.size() == 0) ? n : utils::sum(utils::pow(weights, 2));
+    double noise = 4 * std::numeric_limits<double>::epsilon() *
+        (std::log2(static_cast<double>(size)) + 1) * w2_sum;
+
+    std::vector<size_t> run_x = run_lengths(x), run_y = run_lengths(y);
+    std::vector<double> ccf(num_lags);
+    for (size_t i = 0; i < num_lags; i++) {
+        Lag lag = ccf_lag(i, max_lag, n);
+        if ((run_x[lag.x_first] >= lag.len) || (run_y[lag.y_first] >= lag.len)) {
+            ccf[i] = std::numeric_limits<double>::quiet_NaN();
+            continue;
+        }
+        double cov = s_xy[i] - s_x[i] * s_y[i] / s_w[i];
+        double v_x = s_xx[i] - s_x[i] * s_x[i] / s_w[i];
+        double v_y = s_yy[i] - s_y[i] * s_y[i] / s_w[i];
+        if (noise <= 1e-10 * std::min(v_x, v_y)) {
+            ccf[i] = cov / (std::sqrt(v_x) * std::sqrt(v_y));
+            continue;
+        }
+        ccf[i] = prho(segment(x, lag.x_first, lag.len),
+                      segment(y, lag.y_first, lag.len),
+                      pair_weights(weights, lag));
+    }
+    return ccf;
+}
+
+inline void check_lag_args(const std::vector<double>& x,
+                           const std::vector<double>& y,
+                           const std::vector<double>& weights,
+                           size_t max_lag)
+{
+    utils::check_sizes(x, y, weights);
+    if (max_lag >= x.size())
+        throw std::runtime_error("max_lag must be smaller than the length of x.");
+}
+
+}
+
+//! calculates the autocorrelation function of a time series based on a
+//! dependence measure.
+//! @param x a time series.
+//! @param max_lag the largest lag; must be smaller than the length of `x`.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the observations; a
+//!    pair of observations has the product of their weights.
+//! @param remove_missing if `true`, pairs containing a `nan` are removed;
+//!    otherwise throws an error if `nan`s are present.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @return a vector of length `max_lag + 1`, whose element `k` is the
+//!   dependence measure between `x[t]` and `x[t + k]`.
+//! @details Lags are computed in parallel. For Kendall's \f$ \tau \f$ and
+//!   Spearman's \f$ \rho \f$, `x` is sorted only once for all lags.
+//!   For many lags, Pearson correlations are computed all at once with the
+//!   fast Fourier transform (unless there are missing values or
+//!   non-positive weights).
+inline std::vector<double> wdm_acf(const std::vector<double>& x,
+                                   size_t max_lag,
+                                   std::string method,
+                                   std::vector<double> weights = std::vector<double>(),
+                                   bool remove_missing = true,
+                                   size_t num_threads = 1)
+{
+    impl::check_lag_args(x, x, weights, max_lag);
+    if (impl::use_prho_ccf(x, x, weights, method, max_lag, max_lag + 1)) {
+        std::vector<double> ccf = impl::prho_ccf(x, x, max_lag, weights);
+        return std::vector<double>(ccf.begin() + max_lag, ccf.end());
+    }
+    impl::Lagged_pairs pairs(x, x, method, weights);
+    std::vector<double> acf(max_lag + 1);
+    utils::parallel_for(0, max_lag + 1, [&] (size_t k) {
+        acf[k] = pairs.estimate(impl::Lag{0, k, x.size() - k}, remove_missing);
+    }, num_threads);
+    return acf;
+}
+
+//! calculates the cross-correlation function of two time series based on a
+//! dependence measure.
+//! @param x, y time series of the same length.
+//! @param max_lag the largest lag; must be smaller than the length of `x`.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the observations; a
+//!    pair of observations has the product of their weights.
+//! @param remove_missing if `true`, pairs containing a `nan` are removed;
+//!    otherwise throws an error if `nan`s are present.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @return a vector of length `2 * max_lag + 1`, whose element
+//!   `max_lag + k` is the dependence measure between `x[t]` and `y[t + k]`
+//!   (`k = -max_lag, ..., max_lag`).
+//! @details Lags are computed in parallel. For Kendall's \f$ \tau \f$ and
+//!   Spearman's \f$ \rho \f$, `x` and `y` are sorted only once for all lags.
+//!   For many lags, Pearson correlations are computed all at once with the
+//!   fast Fourier transform (unless there are missing values or
+//!   non-positive weights).
+inline std::vector<double> wdm_ccf(const std::vector<double>& x,
+                                   const std::vector<double>& y,
+                                   size_t max_lag,
+                                   std::string method,
+                                   std::vector<double> weights = std::vector<double>(),
+                                   bool remove_missing = true,
+                                   size_t num_threads = 1)
+{
+    impl::check_lag_args(x, y, weights, max_lag);
+    if (impl::use_prho_ccf(x, y, weights, method, max_lag, 2 * max_lag + 1))
+        return impl::prho_ccf(x, y, max_lag, weights);
+    impl::Lagged_pairs pairs(x, y, method, weights);
+    size_t n = x.size();
+    std::vector<double> ccf(2 * max_lag + 1);
+    utils::parallel_for(0, 2 * max_lag + 1, [&] (size_t i) {
+        ccf[i] = pairs.estimate(impl::ccf_lag(i, max_lag, n), remove_missing);
+    }, num_threads);
+    return ccf;
+}
+
+//! independence tests for all lags of the autocorrelation function.
+//! @param x, max_lag, method, weights, remove_missing, num_threads see
+//!   `wdm_acf()`.
+//! @param alternative the alternative hypothesis; see `Indep_test`.
+//! @return a vector of length `max_lag + 1`, whose element `k` is the test
+//!   between `x[t]` and `x[t + k]`.
+inline std::vector<Test_result> indep_test_acf(const std::vector<double>& x,
+                                               size_t max_lag,
+                                               std::string method,
+                                               std::vector<double> weights = std::vector<double>(),
+                                               bool remove_missing = true,
+                                               std::string alternative = "two-sided",
+                                               size_t num_threads = 1)
+{
+    impl::check_lag_args(x, x, weights, max_lag);
+    impl::Lagged_pairs pairs(x, x, method, weights);
+    std::vector<Test_result> tests(max_lag + 1);
+    utils::parallel_for(0, max_lag + 1, [&] (size_t k) {
+        tests[k] = pairs.test(impl::Lag{0, k, x.size() - k},
+                              remove_missing,
+                              alternative);
+    }, num_threads);
+    return tests;
+}
+
+//! independence tests for all lags of the cross-correlation function.
+//! @param x, y, max_lag, method, weights, remove_missing, num_threads see
+//!   `wdm_ccf()`.
+//! @param alternative the alternative hypothesis; see `Indep_test`.
+//! @return a vector of length `2 * max_lag + 1`, whose element
+//!   `max_lag + k` is the test between `x[t]` and `y[t + k]`.
+inline std::vector<Test_result> indep_test_ccf(const std::vector<double>& x,
+                                               const std::vector<double>& y,
+                                               size_t max_lag,
+                                               std::string method,
+                                               std::vector<double> weights = std::vector<double>(),
+                                               bool remove_missing = true,
+                                               std::string alternative = "two-sided",
+                                               size_t num_threads = 1)
+{
+    impl::check_lag_args(x, y, weights, max_lag);
+    impl::Lagged_pairs pairs(x, y, method, weights);
+    size_t n = x.size();
+    std::vector<Test_result> tests(2 * max_lag + 1);
+    utils::parallel_for(0, 2 * max_lag + 1, [&] (size_t i) {
+        tests[i] = pairs.test(impl::ccf_lag(i, max_lag, n),
+                              remove_missing,
+                              alternative);
+    }, num_threads);
+    return tests;
+}
+
+}
@@ -0,0 +1,162 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "../wdm.hpp"
+#include "executor.hpp"
+#include <future>
+
+namespace wdm {
+
+namespace impl {
+
+//! the arguments of an asynchronous call; shared by the task and moved in
+//! only once.
+struct Async_args {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::string method;
+    std::vector<double> weights;
+    bool remove_missing;
+    std::string alternative;
+};
+
+//! runs `f(args)` on the executor and passes the result (or the error) to
+//! `callback`.
+template<class T, class F>
+inline void run_async(F f,
+                      std::shared_ptr<Async_args> args,
+                      std::function<void(T, std::exception_ptr)> callback)
+{
+    get_executor()->submit([f, args, callback] {
+        T result{};
+        std::exception_ptr error;
+        try {
+            result = f(*args);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        callback(result, error);
+    });
+}
+
+//! runs `f(args)` on the executor.
+//! @return a future holding the result or the error.
+template<class T, class F>
+inline std::future<T> run_async(F f, std::shared_ptr<Async_args> args)
+{
+    auto promise = std::make_shared<std::promise<T>>();
+    std::future<T> future = promise->get_future();
+    run_async<T>(f, args, [promise] (T result, std::exception_ptr error) {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(result);
+    });
+    return future;
+}
+
+inline double async_wdm(const Async_args& args)
+{
+    return wdm(args.x, args.y, args.method, args.weights, args.remove_missing);
+}
+
+inline Test_result async_indep_test(const Async_args& args)
+{
+    Indep_test test(args.x, args.y, args.method, args.weights,
+                    args.remove_missing, args.alternative);
+    Test_result result;
+    result.n_eff = test.n_eff();
+    result.estimate = test.estimate();
+    result.statistic = test.statistic();
+    result.p_value = test.p_value();
+    return result;
+}
+
+}
+
+//! calculates a (weighted) dependence measure asynchronously.
+//! @param x, y, method, weights, remove_missing see `wdm()`.
+//! @return a future holding the dependence measure; errors are rethrown by
+//!   `get()`.
+//! @details The computation runs on the executor (see `get_executor()`);
+//!   the inputs are moved into the task, so no thread is blocked or created
+//!   by the call.
+inline std::future<double> wdm_async(std::vector<double> x,
+                                     std::vector<double> y,
+                                     std::string method,
+                                     std::vector<double> weights = std::vector<double>(),
+                                     bool remove_missing = true)
+{
+    std::shared_ptr<impl::Async_args> args(new impl::Async_args{
+        std::move(x), std::move(y), std::move(method), std::move(weights),
+        remove_missing, ""});
+    return impl::run_async<double>(impl::async_wdm, args);
+}
+
+//! calculates a (weighted) dependence measure asynchronously.
+//! @param x, y, method, weights, remove_missing see `wdm()`.
+//! @param callback called on the executor with the dependence measure and
+//!   `nullptr`, or with `nan` and the error.
+inline void wdm_async(std::vector<double> x,
+                      std::vector<double> y,
+                      std::string method,
+                      std::vector<double> weights,
+                      bool remove_missing,
+                      std::function<void(double, std::exception_ptr)> callback)
+{
+    std::shared_ptr<impl::Async_args> args(new impl::Async_args{
+        std::move(x), std::move(y), std::move(method), std::move(weights),
+        remove_missing, ""});
+    impl::run_async<double>(
+        impl::async_wdm, args,
+        [callback] (double result, std::exception_ptr error) {
+            callback(error ? std::numeric_limits<double>::quiet_NaN() : result,
+                     error);
+        });
+}
+
+//! runs an independence test asynchronously.
+//! @param x, y, method, weights, remove_missing, alternative see
+//!   `Indep_test`.
+//! @return a future holding the test result; errors are rethrown by `get()`.
+//! @details The computation runs on the executor (see `get_executor()`).
+inline std::future<Test_result> indep_test_async(
+    std::vector<double> x,
+    std::vector<double> y,
+    std::string method,
+    std::vector<double> weights = std::vector<double>(),
+    bool remove_missing = true,
+    std::string alternative = "two-sided")
+{
+    std::shared_ptr<impl::Async_args> args(new impl::Async_args{
+        std::move(x), std::move(y), std::move(method), std::move(weights),
+        remove_missing, std::move(alternative)});
+    return impl::run_async<Test_result>(impl::async_indep_test, args);
+}
+
+//! runs an independence test asynchronously.
+//! @param x, y, method, weights, remove_missing, alternative see
+//!   `Indep_test`.
+//! @param callback called on the executor with the test result and
+//!   `nullptr`, or with an empty result and the error.
+inline void indep_test_async(
+    std::vector<double> x,
+    std::vector<double> y,
+    std::string method,
+    std::vector<double> weights,
+    bool remove_missing,
+    std::string alternative,
+    std::function<void(Test_result, std::exception_ptr)> callback)
+{
+    std::shared_ptr<impl::Async_args> args(new impl::Async_args{
+        std::move(x), std::move(y), std::move(method), std::move(weights),
+        remove_missing, std::move(alternative)});
+    impl::run_async<Test_result>(impl::async_indep_test, args, callback);
+}
+
+}
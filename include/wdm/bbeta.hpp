@@ -6,26 +6,24 @@
 
 #pragma once
 
+#include "ranks.hpp"
 #include "utils.hpp"
 
 namespace wdm {
     
 namespace impl {
 
-//! calculates the weighted Blomqvists's beta.
+//! calculates the weighted Blomqvists's beta from known medians.
 //! @param x, y input data.
+//! @param med_x, med_y the (weighted) medians of `x` and `y`.
 //! @param weights an optional vector of weights for the data.
 inline double bbeta(const std::vector<double>& x,
                     const std::vector<double>& y,
+                    double med_x,
+                    double med_y,
                     std::vector<double> weights = std::vector<double>())
 {
-    utils::check_sizes(x, y, weights);
     size_t n = x.size();
-
-    // find the medians
-    double med_x = impl::median(x, weights);
-    double med_y = impl::median(y, weights);
-
     if (weights.size() == 0)
         weights = std::vector<double>(n, 1.0);
 
@@ -41,6 +39,19 @@ inline double bbeta(const std::vector<double>& x,
     return 2 * w_acc / utils::sum(weights) - 1;
 }
 
+//! calculates the weighted Blomqvists's beta.
+//! @param x, y input data.
+//! @param weights an optional vector of weights for the data.
+inline double bbeta(const std::vector<double>& x,
+                    const std::vector<double>& y,
+                    std::vector<double> weights = std::vector<double>())
+{
+    utils::check_sizes(x, y, weights);
+    double med_x = impl::median(x, weights);
+    double med_y = impl::median(y, weights);
+    return bbeta(x, y, med_x, med_y, std::move(weights));
+}
+
 }
 
 }
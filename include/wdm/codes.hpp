@@ -0,0 +1,489 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "../wdm.hpp"
+#include "ktau.hpp"
+#include "nan_handling.hpp"
+#include "parallel.hpp"
+#include "prho.hpp"
+#include "ranks.hpp"
+#include "sparse.hpp"
+#include "utils.hpp"
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+namespace wdm {
+
+namespace impl {
+
+//! whether `T` is a type for integer-coded variables (`uint8_t` or
+//! `uint16_t`); codes are compared by their integer value.
+template<class T>
+struct is_code {
+    static const bool value = std::is_same<T, uint8_t>::value ||
+                              std::is_same<T, uint16_t>::value;
+};
+
+//! the observations of an integer-coded variable grouped by code.
+struct Code_margin {
+    //! indices of the observations sorted by code (ties in original order).
+    std::vector<size_t> order;
+    //! the observations with code `c` are `order[start[c]]` to
+    //! `order[start[c + 1] - 1]`.
+    std::vector<size_t> start;
+    std::vector<double> weights; //!< total weight of each code.
+    std::vector<double> squares; //!< total squared weight of each code.
+};
+
+//! groups the observations of an integer-coded variable by a counting sort
+//! in \f$ O(n + k) \f$ time, where \f$ k \f$ is the largest code plus one.
+//! @param x the codes.
+//! @param weights an optional vector of weights for the data.
+//! @param with_order whether to compute the order of the observations (only
+//!   the totals are computed otherwise).
+template<class T>
+inline Code_margin code_margin(const std::vector<T>& x,
+                               const std::vector<double>& weights,
+                               bool with_order = true)
+{
+    size_t k = 0;
+    for (T c : x)
+        k = std::max(k, static_cast<size_t>(c) + 1);
+
+    Code_margin m;
+    m.start.assign(k + 1, 0);
+    m.weights.assign(k, 0.0);
+    m.squares.assign(k, 0.0);
+    for (size_t i = 0; i < x.size(); i++) {
+        double w = (weights.size() > 0) ? weights[i] : 1.0;
+        m.start[x[i] + 1]++;
+        m.weights[x[i]] += w;
+        m.squares[x[i]] += w * w;
+    }
+    for (size_t c = 0; c < k; c++)
+        m.start[c + 1] += m.start[c];
+
+    if (with_order) {
+        std::vector<size_t> pos(m.start.begin(), m.start.end() - 1);
+        m.order.resize(x.size());
+        for (size_t i = 0; i < x.size(); i++)
+            m.order[pos[x[i]]++] = i;
+    }
+    return m;
+}
+
+//! average ranks (see `rank0()`) of the codes of a variable.
+inline std::vector<double> code_rank(const Code_margin& m)
+{
+    std::vector<double> ranks(m.weights.size());
+    double w_acc = 0.0;
+    for (size_t c = 0; c < ranks.size(); c++) {
+        ranks[c] = w_acc;
+        if (m.weights[c] > 0)
+            ranks[c] += (m.weights[c] * m.weights[c] - m.squares[c]) / 2 / m.weights[c];
+        w_acc += m.weights[c];
+    }
+    return ranks;
+}
+
+//! weighted median (see `median()`) of an integer-coded variable.
+inline double code_median(const Code_margin& m)
+{
+    double w_sum = 0.0, w2_sum = 0.0;
+    for (size_t c = 0; c < m.weights.size(); c++) {
+        if (m.weights[c] > 0) {
+            w_sum += m.weights[c];
+            w2_sum += m.squares[c];
+        }
+    }
+    if (!(w_sum > 0))
+        return std::numeric_limits<double>::quiet_NaN();
+    double rank_avrg = (w_sum * w_sum - w2_sum) / 2 / w_sum;
+
+    // weighted median splits data below and above rank_avrg; codes without
+    // weight do not affect it.
+    double w_acc = 0.0;
+    size_t previous = 0;
+    for (size_t c = 0; c < m.weights.size(); c++) {
+        if (!(m.weights[c] > 0))
+            continue;
+        double rank = w_acc +
+            (m.weights[c] * m.weights[c] - m.squares[c]) / 2 / m.weights[c];
+        if (rank == rank_avrg)
+            return static_cast<double>(c);
+        if (rank > rank_avrg)
+            return (w_acc > 0) ? 0.5 * (previous + c) : static_cast<double>(c);
+        previous = c;
+        w_acc += m.weights[c];
+    }
+    return static_cast<double>(previous);
+}
+
+//! collapses all observations with the same pair of codes into a single
+//! observation carrying their total (and total squared) weight; the points
+//! are ordered by `x`, then `y`.
+//! @param x, y the codes.
+//! @param mx, my their margins (see `code_margin()`; `my` with order).
+//! @param weights an optional vector of weights for the data.
+template<class T1, class T2>
+inline Collapsed_sample collapse(const std::vector<T1>& x,
+                                 const Code_margin& mx,
+                                 const std::vector<T2>& y,
+                                 const Code_margin& my,
+                                 const std::vector<double>& weights)
+{
+    // stable counting sort by x of the observations sorted by y
+    std::vector<size_t> pos(mx.start.begin(), mx.start.end() - 1);
+    std::vector<size_t> sorted(x.size());
+    for (size_t i : my.order)
+        sorted[pos[x[i]]++] = i;
+
+    Collapsed_sample s;
+    for (size_t p = 0; p < sorted.size(); p++) {
+        size_t i = sorted[p];
+        double w = (weights.size() > 0) ? weights[i] : 1.0;
+        if ((p > 0) && (x[i] == x[sorted[p - 1]]) && (y[i] == y[sorted[p - 1]])) {
+            s.weights.back() += w;
+            s.squares.back() += w * w;
+        } else {
+            s.x.push_back(x[i]);
+            s.y.push_back(y[i]);
+            s.weights.push_back(w);
+            s.squares.push_back(w * w);
+        }
+    }
+    return s;
+}
+
+//! weighted mean and variance (times the total weight) of an integer-coded
+//! variable, shifted by its smallest code with non-zero weight (so that
+//! constant variables have exactly zero variance).
+//! @return the shift, mean, and variance.
+inline std::array<double, 3> code_moments(const Code_margin& m)
+{
+    size_t k = m.weights.size(), first = 0;
+    while ((first < k) && (m.weights[first] == 0.0))
+        first++;
+    double w_sum = 0.0, mu = 0.0, v = 0.0;
+    for (size_t c = first; c < k; c++) {
+        w_sum += m.weights[c];
+        mu += m.weights[c] * static_cast<double>(c - first);
+    }
+    mu /= w_sum;
+    for (size_t c = first; c < k; c++)
+        v += m.weights[c] * std::pow(static_cast<double>(c - first) - mu, 2);
+    return {{static_cast<double>(first), mu, v}};
+}
+
+//! weighted Pearson correlation of integer-coded variables; means and
+//! variances are computed from the margins, the covariance in one pass
+//! over the data.
+template<class T1, class T2>
+inline double prho_codes(const std::vector<T1>& x,
+                         const Code_margin& mx,
+                         const std::vector<T2>& y,
+                         const Code_margin& my,
+                         const std::vector<double>& weights)
+{
+    std::array<double, 3> moments_x = code_moments(mx), moments_y = code_moments(my);
+    double shift_x = moments_x[0] + moments_x[1];
+    double shift_y = moments_y[0] + moments_y[1];
+    bool weighted = (weights.size() > 0);
+    double cov = utils::reduce_sum(x.size(), [&] (size_t i) {
+        return (weighted ? weights[i] : 1.0) *
+            (x[i] - shift_x) * (y[i] - shift_y);
+    });
+    return cov / (std::sqrt(moments_x[2]) * std::sqrt(moments_y[2]));
+}
+
+//! whether a method is computed from the codes directly.
+inline bool is_code_method(const std::string& method)
+{
+    return methods::is_pearson(method) || methods::is_spearman(method) ||
+        methods::is_kendall(method) || methods::is_blomqvist(method);
+}
+
+template<class T>
+inline std::vector<double> widen(const std::vector<T>& x)
+{
+    return std::vector<double>(x.begin(), x.end());
+}
+
+//! calculates a dependence measure from integer-coded variables (with
+//! `is_code_method(method)`, at least `get_min_nobs(method)` observations,
+//! and weights without `nan`s).
+template<class T1, class T2>
+inline double wdm_codes(const std::vector<T1>& x,
+                        const Code_margin& mx,
+                        const std::vector<T2>& y,
+                        const Code_margin& my,
+                        const std::string& method,
+                        const std::vector<double>& weights)
+{
+    if (methods::is_pearson(method))
+        return prho_codes(x, mx, y, my, weights);
+    Collapsed_sample s = collapse(x, mx, y, my, weights);
+    if (methods::is_kendall(method))
+        return ktau(s.x, s.y, s.weights);
+    if (methods::is_spearman(method)) {
+        std::vector<double> ranks_x = code_rank(mx), ranks_y = code_rank(my);
+        for (size_t i = 0; i < s.x.size(); i++) {
+            s.x[i] = ranks_x[static_cast<size_t>(s.x[i])];
+            s.y[i] = ranks_y[static_cast<size_t>(s.y[i])];
+        }
+        return prho(s.x, s.y, s.weights);
+    }
+
+    // Blomqvist's beta
+    double med_x = code_median(mx), med_y = code_median(my);
+    double w_acc = 0.0;
+    for (size_t i = 0; i < s.x.size(); i++) {
+        if ((s.x[i] <= med_x) && (s.y[i] <= med_y))
+            w_acc += s.weights[i];
+        else if ((s.x[i] > med_x) && (s.y[i] > med_y))
+            w_acc += s.weights[i];
+    }
+    return 2 * w_acc / utils::sum(s.weights) - 1;
+}
+
+//! computes ranks of an integer-coded variable (such that the smallest
+//! element has rank 0) in \f$ O(n + k) \f$ time, where \f$ k \f$ is the
+//! largest code plus one.
+//! @param x the codes.
+//! @param weights (optional), weights for each observation.
+//! @param ties_method `"min"` (default) assigns all tied values the minimum
+//!   score; `"average"` assigns the average score.
+//! @return a vector containing the ranks of each element in `x`.
+template<class T>
+inline typename std::enable_if<is_code<T>::value, std::vector<double>>::type
+rank0(const std::vector<T>& x,
+      const std::vector<double>& weights = std::vector<double>(),
+      std::string ties_method = "min")
+{
+    if ((ties_method != "min") && (ties_method != "average"))
+        throw std::runtime_error("ties_method must be either 'min' or 'average.");
+    if ((weights.size() > 0) && (weights.size() != x.size()))
+        throw std::runtime_error("weights and data must have same size.");
+
+    Code_margin m = code_margin(x, weights, false);
+    std::vector<double> code_ranks(m.weights.size());
+    if (ties_method == "average") {
+        code_ranks = code_rank(m);
+    } else {
+        double w_acc = 0.0;
+        for (size_t c = 0; c < code_ranks.size(); c++) {
+            code_ranks[c] = w_acc;
+            w_acc += m.weights[c];
+        }
+    }
+
+    std::vector<double> ranks(x.size());
+    for (size_t i = 0; i < x.size(); i++)
+        ranks[i] = code_ranks[x[i]];
+    return ranks;
+}
+
+}
+
+//! tie statistics of an integer-coded variable (see `margin_ties()`),
+//! computed from the number and weights of the observations with each code.
+//! @param x the codes.
+//! @param weights an optional vector of weights for the data.
+template<class T>
+inline typename std::enable_if<impl::is_code<T>::value, Margin_ties>::type
+margin_ties(const std::vector<T>& x,
+            const std::vector<double>& weights = std::vector<double>())
+{
+    bool weighted = (weights.size() > 0);
+    if (weighted && (weights.size() != x.size()))
+        throw std::runtime_error("weights and data must have same size.");
+    impl::Code_margin m = impl::code_margin(x, weights, false);
+    std::vector<double> cubes(m.weights.size(), 0.0);
+    if (weighted) {
+        for (size_t i = 0; i < x.size(); i++)
+            cubes[x[i]] += std::pow(weights[i], 3);
+    }
+
+    Margin_ties ties;
+    for (size_t c = 0; c < m.weights.size(); c++) {
+        double reps = static_cast<double>(m.start[c + 1] - m.start[c]);
+        if (reps < 2)
+            continue;
+        double w1 = m.weights[c], w2 = m.squares[c];
+        if (weighted) {
+            ties.pairs += (w1 * w1 - w2) / 2.0;
+            ties.v += (w1 * w1 - w2) * (2 * w1 + 5);
+            if (reps > 2)
+                ties.triplets += (std::pow(w1, 3) - 3 * w2 * w1 + 2 * cubes[c]) / 6.0;
+        } else {
+            ties.pairs += reps * (reps - 1) / 2.0;
+            ties.v += reps * (reps - 1) * (2 * reps + 5);
+            ties.triplets += reps * (reps - 1) * (reps - 2) / 6.0;
+        }
+    }
+    return ties;
+}
+
+//! calculates (weighted) dependence measures of integer-coded variables.
+//! @param x, y the codes (`uint8_t` or `uint16_t`; both variables may use
+//!   different types).
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing if `true`, all observations with a `nan` weight
+//!    are removed; otherwise throws an error if `nan`s are present.
+//! @return the dependence measure.
+//! @details Codes are ordinal; they are compared by their integer value.
+//!   Observations are grouped by a counting sort over the codes, so ranks,
+//!   medians, and means come from the totals of each code. For Spearman's
+//!   \f$ \rho \f$, Kendall's \f$ \tau \f$, and Blomqvist's \f$ \beta \f$,
+//!   all observations with the same pair of codes are collapsed into one
+//!   carrying their total weight. The costs are \f$ O(n + k) \f$ for these
+//!   and Pearson's \f$ \rho \f$ (plus \f$ O(m \log m) \f$ for Kendall's
+//!   \f$ \tau \f$), where \f$ k \f$ is the largest code and \f$ m \le n \f$
+//!   the number of distinct pairs of codes. Other methods and weights with
+//!   missing values use the computation for `double`s.
+template<class T1, class T2>
+inline typename std::enable_if<impl::is_code<T1>::value && impl::is_code<T2>::value,
+                               double>::type
+wdm(const std::vector<T1>& x,
+    const std::vector<T2>& y,
+    std::string method,
+    std::vector<double> weights = std::vector<double>(),
+    bool remove_missing = true)
+{
+    if (y.size() != x.size())
+        throw std::runtime_error("x and y must have the same size.");
+    if ((weights.size() > 0) && (weights.size() != x.size()))
+        throw std::runtime_error("x, y, and weights must have the same size.");
+    if (!impl::is_code_method(method) || utils::any_nan(weights)) {
+        return wdm(impl::widen(x), impl::widen(y), method, weights,
+                   remove_missing);
+    }
+    if (x.size() < methods::get_min_nobs(method)) {
+        if (remove_missing)
+            return std::numeric_limits<double>::quiet_NaN();
+        utils::throw_preproc_error(Status::too_few_observations, method);
+    }
+
+    return impl::wdm_codes(x, impl::code_margin(x, weights),
+                           y, impl::code_margin(y, weights),
+                           method, weights);
+}
+
+//! independence test for integer-coded variables.
+//! @param x, y the codes (`uint8_t` or `uint16_t`).
+//! @param method the dependence measure; see `Indep_test` for possible
+//!   values.
+//! @param weights an optional vector of weights for the data; observations
+//!   with `nan` weights are removed.
+//! @param alternative the alternative hypothesis; see `Indep_test`.
+//! @details The estimate is computed as in `wdm()` for codes, tie statistics
+//!   from the weights of each code. Tests of Chatterjee's \f$ \xi \f$ and
+//!   the distance correlation, and weights with missing values, use the data
+//!   as `double`s.
+template<class T1, class T2>
+inline typename std::enable_if<impl::is_code<T1>::value && impl::is_code<T2>::value,
+                               Indep_test>::type
+indep_test(const std::vector<T1>& x,
+           const std::vector<T2>& y,
+           std::string method,
+           std::vector<double> weights = std::vector<double>(),
+           std::string alternative = "two-sided")
+{
+    if (y.size() != x.size())
+        throw std::runtime_error("x and y must have the same size.");
+    if ((weights.size() > 0) && (weights.size() != x.size()))
+        throw std::runtime_error("x, y, and weights must have the same size.");
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    if (methods::is_chatterjee(method) || methods::is_dcor(method) ||
+        utils::any_nan(weights)) {
+        return Indep_test(impl::widen(x), impl::widen(y), method, weights,
+                          true, alternative);
+    }
+
+    double estimate = wdm(x, y, method, weights);
+    Margin_ties ties_x, ties_y;
+    if (methods::is_kendall(method)) {
+        ties_x = margin_ties(x, weights);
+        ties_y = margin_ties(y, weights);
+    }
+    return Indep_test(estimate, method, x.size(), weights, alternative,
+                      ties_x, ties_y);
+}
+
+//! calculates a matrix of (weighted) dependence measures for integer-coded
+//! variables.
+//! @param columns the variables (`uint8_t` or `uint16_t` codes); all must
+//!   have the same size.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing if `true`, all observations with a `nan` weight
+//!    are removed; otherwise throws an error if `nan`s are present.
+//! @param num_threads the number of threads; `0` uses all cores.
+//! @return the `d x d` matrix of dependence measures (as a vector of rows);
+//!   entry `[i][j]` is the measure between columns `i` (as `x`) and `j` (as
+//!   `y`). The diagonal is as for the matrix version of `wdm()`.
+//! @details Each column is grouped by its codes only once (see `wdm()` for
+//!   codes); pairs then take \f$ O(n + k) \f$ time.
+template<class T>
+inline typename std::enable_if<impl::is_code<T>::value,
+                               std::vector<std::vector<double>>>::type
+wdm(const std::vector<std::vector<T>>& columns,
+    std::string method,
+    std::vector<double> weights = std::vector<double>(),
+    bool remove_missing = true,
+    size_t num_threads = 1)
+{
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    size_t d = columns.size();
+    size_t n = (d > 0) ? columns[0].size() : 0;
+    for (const auto& col : columns) {
+        if (col.size() != n)
+            throw std::runtime_error("all columns must have the same size.");
+    }
+    if ((weights.size() > 0) && (weights.size() != n))
+        throw std::runtime_error("columns and weights must have the same size.");
+
+    std::vector<std::vector<double>> ms(d, std::vector<double>(d, 1.0));
+    if (!impl::is_code_method(method) || utils::any_nan(weights) ||
+        (n < methods::get_min_nobs(method))) {
+        std::vector<std::vector<double>> x(d);
+        for (size_t j = 0; j < d; j++)
+            x[j] = impl::widen(columns[j]);
+        bool symmetric = methods::is_symmetric(method);
+        utils::parallel_for(0, d, [&] (size_t i) {
+            if (!methods::has_unit_diagonal(method))
+                ms[i][i] = wdm(x[i], x[i], method, weights, remove_missing);
+            for (size_t j = i + 1; j < d; j++) {
+                ms[i][j] = wdm(x[i], x[j], method, weights, remove_missing);
+                ms[j][i] = symmetric ? ms[i][j] :
+                    wdm(x[j], x[i], method, weights, remove_missing);
+            }
+        }, num_threads);
+        return ms;
+    }
+
+    std::vector<impl::Code_margin> margins(d);
+    utils::parallel_for(0, d, [&] (size_t j) {
+        margins[j] = impl::code_margin(columns[j], weights);
+    }, num_threads);
+    utils::parallel_for(0, d, [&] (size_t i) {
+        for (size_t j = i + 1; j < d; j++) {
+            ms[i][j] = impl::wdm_codes(columns[i], margins[i],
+                                       columns[j], margins[j],
+                                       method, weights);
+            ms[j][i] = ms[i][j];
+        }
+    }, num_threads);
+    return ms;
+}
+
+}
@@ -0,0 +1,256 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace wdm {
+
+//! reading and writing data in the binary column format.
+//!
+//! A column file stores a data set with `n` observations of `d` variables
+//! and optional weights. All numbers are little-endian; the layout is
+//!
+//!   - bytes 0-7: the magic string `"WDMCOL01"`,
+//!   - bytes 8-15: `n` (unsigned 64-bit integer),
+//!   - bytes 16-23: `d` (unsigned 64-bit integer),
+//!   - bytes 24-31: flags (unsigned 64-bit integer); bit 0 is set if the
+//!     file contains weights,
+//!   - then the `d` columns, each as `n` consecutive doubles,
+//!   - then, if present, the `n` weights as doubles.
+//!
+//! Since columns are stored contiguously, any block of columns can be read
+//! without touching the rest of the file.
+namespace io {
+
+const char column_file_magic[8] = {'W', 'D', 'M', 'C', 'O', 'L', '0', '1'};
+const size_t column_file_header_size = 32;
+
+//! the header of a column file.
+struct Column_file_header {
+    uint64_t n = 0;           //!< number of observations.
+    uint64_t d = 0;           //!< number of variables (columns).
+    bool has_weights = false; //!< whether the file contains weights.
+};
+
+inline void check_little_endian()
+{
+    const uint16_t one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    if (first != 1)
+        throw std::runtime_error("column files require a little-endian host.");
+}
+
+//! writes a data set to a column file.
+//! @param path the file name.
+//! @param columns the variables; all must have the same size.
+//! @param weights optional weights for the observations.
+inline void write_columns(const std::string& path,
+                          const std::vector<std::vector<double>>& columns,
+                          const std::vector<double>& weights = std::vector<double>())
+{
+    check_little_endian();
+    uint64_t n = columns.size() > 0 ? columns[0].size() : weights.size();
+    for (const auto& col : columns) {
+        if (col.size() != n)
+            throw std::runtime_error("all columns must have the same size.");
+    }
+    if ((weights.size() > 0) && (weights.size() != n))
+        throw std::runtime_error("weights and columns must have the same size.");
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("cannot open '" + path + "' for writing.");
+    uint64_t header[3] = {n, columns.size(), weights.size() > 0 ? 1u : 0u};
+    file.write(column_file_magic, sizeof(column_file_magic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    for (const auto& col : columns) {
+        file.write(reinterpret_cast<const char*>(col.data()),
+                   static_cast<std::streamsize>(n * sizeof(double)));
+    }
+    if (weights.size() > 0) {
+        file.write(reinterpret_cast<const char*>(weights.data()),
+                   static_cast<std::streamsize>(n * sizeof(double)));
+    }
+    if (!file)
+        throw std::runtime_error("failed to write '" + path + "'.");
+}
+
+//! reads the header of a column file.
+//! @param path the file name.
+inline Column_file_header read_header(const std::string& path)
+{
+    check_little_endian();
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("cannot open '" + path + "'.");
+    char magic[8];
+    uint64_t header[3];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file || std::memcmp(magic, column_file_magic, sizeof(magic)) != 0)
+        throw std::runtime_error("'" + path + "' is not a column file.");
+
+    Column_file_header h;
+    h.n = header[0];
+    h.d = header[1];
+    h.has_weights = (header[2] & 1u) != 0;
+    return h;
+}
+
+//! reads a block of consecutive columns from a column file.
+//! @param path the file name.
+//! @param first index of the first column to read.
+//! @param count number of columns to read; by default, all remaining ones.
+inline std::vector<std::vector<double>> read_columns(const std::string& path,
+                                                     size_t first = 0,
+                                                     size_t count = SIZE_MAX)
+{
+    Column_file_header h = read_header(path);
+    if (first > h.d)
+        throw std::runtime_error("column index out of range.");
+    count = std::min<uint64_t>(count, h.d - first);
+
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(
+        column_file_header_size + first * h.n * sizeof(double)));
+    std::vector<std::vector<double>> columns(count, std::vector<double>(h.n));
+    for (auto& col : columns) {
+        file.read(reinterpret_cast<char*>(col.data()),
+                  static_cast<std::streamsize>(h.n * sizeof(double)));
+    }
+    if (!file)
+        throw std::runtime_error("'" + path + "' is truncated.");
+    return columns;
+}
+
+//! reads the weights from a column file (empty if there are none).
+//! @param path the file name.
+inline std::vector<double> read_weights(const std::string& path)
+{
+    Column_file_header h = read_header(path);
+    std::vector<double> weights;
+    if (!h.has_weights)
+        return weights;
+
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(
+        column_file_header_size + h.d * h.n * sizeof(double)));
+    weights.resize(h.n);
+    file.read(reinterpret_cast<char*>(weights.data()),
+              static_cast<std::streamsize>(h.n * sizeof(double)));
+    if (!file)
+        throw std::runtime_error("'" + path + "' is truncated.");
+    return weights;
+}
+
+//! a column file mapped into memory.
+//!
+//! Blocks of columns are copied out of the mapping without seeking or
+//! reopening the file, and the operating system pages the data in (and
+//! reads ahead) as it is touched. Where memory mapping is unavailable
+//! (Windows), blocks are read with `read_columns()`.
+class Mapped_column_file {
+public:
+    //! @param path the file name.
+    explicit Mapped_column_file(const std::string& path) :
+        path_(path),
+        header_(read_header(path))
+    {
+#if !defined(_WIN32)
+        size_t size = column_file_header_size +
+            (header_.d + (header_.has_weights ? 1 : 0)) * header_.n * sizeof(double);
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open '" + path + "'.");
+        struct stat info;
+        if ((::fstat(fd, &info) != 0) || (static_cast<size_t>(info.st_size) < size)) {
+            ::close(fd);
+            throw std::runtime_error("'" + path + "' is truncated.");
+        }
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            throw std::runtime_error("cannot map '" + path + "' into memory.");
+        data_ = static_cast<const char*>(data);
+        size_ = size;
+#endif
+    }
+
+    ~Mapped_column_file()
+    {
+#if !defined(_WIN32)
+        if (data_)
+            ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    Mapped_column_file(const Mapped_column_file&) = delete;
+    Mapped_column_file& operator=(const Mapped_column_file&) = delete;
+
+    //! the header of the file.
+    const Column_file_header& header() const { return header_; }
+
+    //! reads a block of consecutive columns (see `io::read_columns()`).
+    std::vector<std::vector<double>> read_columns(size_t first = 0,
+                                                  size_t count = SIZE_MAX) const
+    {
+        if (!data_)
+            return io::read_columns(path_, first, count);
+        if (first > header_.d)
+            throw std::runtime_error("column index out of range.");
+        count = std::min<uint64_t>(count, header_.d - first);
+        std::vector<std::vector<double>> columns(count, std::vector<double>(header_.n));
+        for (size_t j = 0; j < count; j++)
+            copy(first + j, columns[j]);
+        return columns;
+    }
+
+    //! reads the weights (empty if there are none).
+    std::vector<double> read_weights() const
+    {
+        if (!data_)
+            return io::read_weights(path_);
+        std::vector<double> weights;
+        if (header_.has_weights) {
+            weights.resize(header_.n);
+            copy(header_.d, weights);
+        }
+        return weights;
+    }
+
+private:
+    //! copies the `j`-th block of `n` doubles after the header.
+    void copy(size_t j, std::vector<double>& out) const
+    {
+        std::memcpy(out.data(),
+                    data_ + column_file_header_size + j * header_.n * sizeof(double),
+                    header_.n * sizeof(double));
+    }
+
+    std::string path_;
+    Column_file_header header_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}
+
+}
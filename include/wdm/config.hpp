@@ -0,0 +1,24 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+// By default, wdm is header-only. Targets linking against the precompiled
+// libraries (`wdm_static`, `wdm_shared`) get `WDM_COMPILED_LIB` defined; the
+// public entry points in `wdm.hpp` are then only declared (without including
+// the kernels), and their definitions are taken from the library (compiled
+// by `src/wdm.cpp` with `WDM_COMPILING_LIB` set).
+#if defined(WDM_COMPILED_LIB) && !defined(WDM_COMPILING_LIB)
+#define WDM_HEADER_ONLY 0
+#else
+#define WDM_HEADER_ONLY 1
+#endif
+
+#if defined(WDM_COMPILED_LIB)
+#define WDM_INLINE
+#else
+#define WDM_INLINE inline
+#endif
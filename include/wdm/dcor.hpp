@@ -0,0 +1,208 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "ranks.hpp"
+#include "utils.hpp"
+
+namespace wdm {
+
+namespace impl {
+
+//! building blocks of the (weighted, V-statistic) distance covariance.
+struct Dcor_parts {
+    double dcov2;  //!< squared distance covariance.
+    double dvar_x; //!< squared distance variance of `x`.
+    double dvar_y; //!< squared distance variance of `y`.
+    double a_mean; //!< mean distance between observations of `x`.
+    double b_mean; //!< mean distance between observations of `y`.
+};
+
+//! centers and scales `x` to weighted mean 0 and variance 1 (distance
+//! correlation is invariant to both); returns false if `x` is constant.
+inline bool dcor_standardize(std::vector<double>& x,
+                             const std::vector<double>& p)
+{
+    // shift by the first observation with non-zero weight; constant
+    // variables then have exactly zero variance (instead of one polluted by
+    // rounding errors).
+    size_t n = x.size(), first = 0;
+    while ((first < n) && (p[first] == 0.0))
+        first++;
+    if (first < n) {
+        double x_0 = x[first];
+        for (auto& xi : x)
+            xi -= x_0;
+    }
+
+    double mu = 0.0, s = 0.0;
+    for (size_t i = 0; i < n; i++)
+        mu += p[i] * x[i];
+    for (size_t i = 0; i < x.size(); i++) {
+        x[i] -= mu;
+        s += p[i] * x[i] * x[i];
+    }
+    if (!(s > 0.0))
+        return false;
+    s = std::sqrt(s);
+    for (auto& xi : x)
+        xi /= s;
+    return true;
+}
+
+//! computes a_i = sum_j p_j |x_i - x_j| with one sort and prefix sums.
+inline std::vector<double> dcor_row_means(const std::vector<double>& x,
+                                          const std::vector<double>& p)
+{
+    size_t n = x.size();
+    std::vector<size_t> perm = utils::get_order(x);
+    double p_tot = 0.0, s_tot = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        p_tot += p[i];
+        s_tot += p[i] * x[i];
+    }
+
+    // ties contribute nothing, so their order within the sort is irrelevant.
+    std::vector<double> a(n);
+    double p_below = 0.0, s_below = 0.0;
+    for (size_t k = 0; k < n; k++) {
+        size_t i = perm[k];
+        double p_above = p_tot - p_below - p[i];
+        double s_above = s_tot - s_below - p[i] * x[i];
+        a[i] = (x[i] * p_below - s_below) + (s_above - x[i] * p_above);
+        p_below += p[i];
+        s_below += p[i] * x[i];
+    }
+    return a;
+}
+
+//! squared distance variance from the row means a_i (and their mean).
+inline double dcor_dvar(const std::vector<double>& a,
+                        const std::vector<double>& p,
+                        double a_mean)
+{
+    // sum_ij p_i p_j |x_i - x_j|^2 = 2 for standardized x.
+    double s = 0.0;
+    for (size_t i = 0; i < a.size(); i++)
+        s += p[i] * a[i] * a[i];
+    return 2.0 - 2.0 * s + a_mean * a_mean;
+}
+
+//! computes the building blocks of the weighted distance covariance in
+//! O(n log n) time.
+//! @param x, y input data.
+//! @param weights an optional vector of weights for the data.
+//! @param with_dcov whether to compute `dcov2` (otherwise it is `nan`).
+//! @details With p_i the normalized weights, a_ij = |x_i - x_j|, row means
+//!   a_i = sum_j p_j a_ij, and a = sum_i p_i a_i (b analogously for `y`),
+//!   \f[ dCov^2 = \sum_{ij} p_i p_j a_{ij} b_{ij} - 2 \sum_i p_i a_i b_i
+//!   + a b. \f]
+//!   The row means follow from one sort and prefix sums. For the first
+//!   term, note that it equals 4C - F, where F = sum_ij p_i p_j (x_i -
+//!   x_j)(y_i - y_j) and C is the sum of p_i p_j (x_i - x_j)(y_i - y_j) over
+//!   pairs where i dominates j (x_j <= x_i and y_j <= y_i). For each i, the
+//!   inner sum over dominated j expands into bivariate ranks with weights
+//!   p_j, p_j x_j, p_j y_j, and p_j x_j y_j. Tied pairs contribute zero, so
+//!   how `bivariate_rank()` resolves ties is irrelevant.
+inline Dcor_parts dcor_parts(std::vector<double> x,
+                             std::vector<double> y,
+                             std::vector<double> weights,
+                             bool with_dcov = true)
+{
+    utils::check_sizes(x, y, weights);
+    // rounding errors depend on the order of x and y, and small distance
+    // correlations are roots of such errors; a canonical order keeps the
+    // measure exactly symmetric.
+    if (std::lexicographical_compare(y.begin(), y.end(), x.begin(), x.end())) {
+        Dcor_parts parts = dcor_parts(y, x, weights, with_dcov);
+        std::swap(parts.dvar_x, parts.dvar_y);
+        std::swap(parts.a_mean, parts.b_mean);
+        return parts;
+    }
+
+    size_t n = x.size();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    Dcor_parts parts{nan, nan, nan, nan, nan};
+
+    if (weights.size() == 0)
+        weights = std::vector<double>(n, 1.0);
+    double w_sum = utils::sum(weights);
+    std::vector<double> p(n);
+    for (size_t i = 0; i < n; i++)
+        p[i] = weights[i] / w_sum;
+    if (!dcor_standardize(x, p) || !dcor_standardize(y, p))
+        return parts;
+
+    std::vector<double> a = dcor_row_means(x, p), b = dcor_row_means(y, p);
+    double a_mean = 0.0, b_mean = 0.0, ab = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        a_mean += p[i] * a[i];
+        b_mean += p[i] * b[i];
+        ab += p[i] * a[i] * b[i];
+    }
+    parts.a_mean = a_mean;
+    parts.b_mean = b_mean;
+    parts.dvar_x = dcor_dvar(a, p, a_mean);
+    parts.dvar_y = dcor_dvar(b, p, b_mean);
+    if (!with_dcov)
+        return parts;
+
+    std::vector<double> px(n), py(n), pxy(n);
+    double f = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        px[i] = p[i] * x[i];
+        py[i] = p[i] * y[i];
+        pxy[i] = p[i] * x[i] * y[i];
+        f += pxy[i];
+    }
+    f *= 2.0; // x and y have mean zero
+    std::vector<std::vector<double>> r = bivariate_rank(x, y, {p, px, py, pxy});
+    double c = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        c += p[i] * (x[i] * y[i] * r[0][i] - x[i] * r[2][i] -
+                     y[i] * r[1][i] + r[3][i]);
+    }
+
+    parts.dcov2 = (4.0 * c - f) - 2.0 * ab + a_mean * b_mean;
+    return parts;
+}
+
+//! calculates the weighted distance correlation.
+//! @param x, y input data.
+//! @param weights an optional vector of weights for the data.
+//! @return the (V-statistic) distance correlation in [0, 1]; `nan` if `x` or
+//!   `y` is constant.
+inline double dcor(const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   const std::vector<double>& weights = std::vector<double>())
+{
+    Dcor_parts parts = dcor_parts(x, y, weights);
+    if (std::isnan(parts.dcov2))
+        return parts.dcov2;
+    // rounding can make dCov^2 slightly negative (or larger than its bound).
+    double r2 = std::max(parts.dcov2, 0.0) /
+        (std::sqrt(parts.dvar_x) * std::sqrt(parts.dvar_y));
+    return std::sqrt(std::min(r2, 1.0));
+}
+
+//! factor turning the distance correlation into the test statistic of
+//! Szekely, Rizzo, and Bakirov (2007, Theorem 6): the statistic is the root of
+//! n_eff * dCov^2 / (a b), which is asymptotically bounded by a chi-squared
+//! variable with one degree of freedom under independence.
+inline double dcor_stat_adjust(const std::vector<double>& x,
+                               const std::vector<double>& y,
+                               const std::vector<double>& weights)
+{
+    Dcor_parts parts = dcor_parts(x, y, weights, false);
+    double n_eff = utils::effective_sample_size(x.size(), weights);
+    return std::sqrt(n_eff * std::sqrt(parts.dvar_x) * std::sqrt(parts.dvar_y) /
+                     (parts.a_mean * parts.b_mean));
+}
+
+}
+
+}
@@ -7,7 +7,13 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <memory>
+#include <utility>
 #include "../wdm.hpp"
+#include "parallel.hpp"
+#include "prepare.hpp"
+#include "prho.hpp"
+#include "utils.hpp"
 
 
 namespace wdm {
@@ -23,6 +29,160 @@ namespace utils {
     }
 }
 
+namespace impl {
+
+//! the columns of a matrix that are used in the computations, each prepared
+//! once (see `Prepared_column`).
+class Prepared_columns {
+public:
+    //! @param x input data.
+    //! @param used whether a column is used.
+    //! @param method the dependence measure.
+    //! @param weights an optional vector of weights for the data.
+    //! @param num_threads the number of threads to use; `0` uses all cores.
+    Prepared_columns(const Eigen::MatrixXd& x,
+                     const std::vector<bool>& used,
+                     const std::string& method,
+                     const std::vector<double>& weights,
+                     size_t num_threads) :
+        data_(x.cols()),
+        prepared_(x.cols())
+    {
+        WDM_TRACE_SCOPE("prepare columns", 0, x.cols());
+        utils::parallel_for(0, static_cast<size_t>(x.cols()), [&] (size_t j) {
+            if (!used[j])
+                return;
+            data_[j] = utils::convert_vec(x.col(j));
+            prepared_[j].reset(new Prepared_column(data_[j], method, weights));
+        }, num_threads);
+    }
+
+    const Prepared_column& operator[](size_t j) const { return *prepared_[j]; }
+
+private:
+    std::vector<std::vector<double>> data_;
+    std::vector<std::unique_ptr<Prepared_column>> prepared_;
+};
+
+//! pairwise-complete Pearson correlations of all columns from masked
+//! matrix products.
+//! @param x input data; may contain `nan`s.
+//! @param weights an optional vector of weights; may contain `nan`s.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @details With indicators `m` of observed entries and data `xc` that are
+//!   centered (by the column means over observed entries) and zero where
+//!   missing, all pairwise counts and weighted sums over complete pairs are
+//!   products `m' m`, `(w m)' m`, `(w xc)' m`, `(w xc^2)' m`, and
+//!   `(w xc)' xc`, computed in column blocks in parallel. Pairs whose
+//!   variances lose more than six digits to cancellation (e.g., when a
+//!   variable is constant among the complete pairs) are computed directly,
+//!   so results agree with `prho()` to about 1e-10.
+inline Eigen::MatrixXd prho_pairwise_complete(const Eigen::MatrixXd& x,
+                                              const std::vector<double>& weights,
+                                              size_t num_threads)
+{
+    size_t n = x.rows(), d = x.cols();
+    Eigen::VectorXd w = Eigen::VectorXd::Ones(n);
+    for (size_t i = 0; i < weights.size(); i++)
+        w(i) = std::isnan(weights[i]) ? 0.0 : weights[i];
+
+    // observations with missing weights are removed from all pairs.
+    Eigen::MatrixXd m(n, d), xc(n, d);
+    utils::parallel_for(0, d, [&] (size_t j) {
+        double sum = 0.0, count = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            bool observed = !std::isnan(x(i, j)) &&
+                ((weights.size() == 0) || !std::isnan(weights[i]));
+            m(i, j) = observed ? 1.0 : 0.0;
+            if (observed) {
+                sum += x(i, j);
+                count++;
+            }
+        }
+        double mean = (count > 0) ? sum / count : 0.0;
+        for (size_t i = 0; i < n; i++)
+            xc(i, j) = (m(i, j) > 0) ? x(i, j) - mean : 0.0;
+    }, num_threads);
+    Eigen::MatrixXd mw = (weights.size() > 0) ? w.asDiagonal() * m : Eigen::MatrixXd();
+    Eigen::MatrixXd xw = w.asDiagonal() * xc;
+    Eigen::MatrixXd xxw = xw.cwiseProduct(xc);
+
+    Eigen::MatrixXd count(d, d), s_w(d, d), s_x(d, d), s_xx(d, d), s_xy(d, d);
+    size_t threads = utils::resolve_num_threads(num_threads);
+    size_t block = std::max((d + 4 * threads - 1) / (4 * threads),
+                            static_cast<size_t>(1));
+    utils::parallel_for(0, (d + block - 1) / block, [&] (size_t b) {
+        size_t first = b * block, cols = std::min(block, d - first);
+        auto m_b = m.middleCols(first, cols);
+        count.middleCols(first, cols).noalias() = m.transpose() * m_b;
+        if (weights.size() > 0)
+            s_w.middleCols(first, cols).noalias() = mw.transpose() * m_b;
+        s_x.middleCols(first, cols).noalias() = xw.transpose() * m_b;
+        s_xx.middleCols(first, cols).noalias() = xxw.transpose() * m_b;
+        s_xy.middleCols(first, cols).noalias() =
+            xw.transpose() * xc.middleCols(first, cols);
+    }, num_threads);
+    if (weights.size() == 0)
+        s_w = count;
+
+    // entry (i, j) of s_x and s_xx sums over x_i, entry (j, i) over x_j.
+    Eigen::MatrixXd ms = Eigen::MatrixXd::Identity(d, d);
+    size_t min_nobs = methods::get_min_nobs("pearson");
+    utils::parallel_for(0, d, [&] (size_t i) {
+        for (size_t j = i + 1; j < d; j++) {
+            double rho = std::numeric_limits<double>::quiet_NaN();
+            if (count(i, j) >= min_nobs) {
+                double s = s_w(i, j);
+                double v_x = s_xx(i, j) - s_x(i, j) * s_x(i, j) / s;
+                double v_y = s_xx(j, i) - s_x(j, i) * s_x(j, i) / s;
+                if ((v_x > 1e-6 * s_xx(i, j)) && (v_y > 1e-6 * s_xx(j, i))) {
+                    double cov = s_xy(i, j) - s_x(i, j) * s_x(j, i) / s;
+                    rho = cov / (std::sqrt(v_x) * std::sqrt(v_y));
+                } else {
+                    rho = wdm(utils::convert_vec(x.col(i)),
+                              utils::convert_vec(x.col(j)),
+                              "pearson", weights, true);
+                }
+            }
+            ms(i, j) = ms(j, i) = rho;
+        }
+    }, num_threads);
+
+    return ms;
+}
+
+//! checks a list of column pairs.
+//! @return whether a column is referenced by any of the pairs.
+inline std::vector<bool> check_pairs(
+    const Eigen::MatrixXd& x,
+    const std::vector<std::pair<size_t, size_t>>& pairs)
+{
+    std::vector<bool> used(x.cols(), false);
+    for (const auto& pair : pairs) {
+        if ((pair.first >= used.size()) || (pair.second >= used.size()))
+            throw std::runtime_error("column index in pairs is out of range.");
+        used[pair.first] = true;
+        used[pair.second] = true;
+    }
+    return used;
+}
+
+//! the order in which to process a list of pairs: pairs sharing the first
+//! column are processed consecutively (and mostly by the same thread).
+inline std::vector<size_t> schedule_pairs(
+    const std::vector<std::pair<size_t, size_t>>& pairs)
+{
+    std::vector<size_t> order(pairs.size());
+    for (size_t k = 0; k < pairs.size(); k++)
+        order[k] = k;
+    std::sort(order.begin(), order.end(), [&] (size_t a, size_t b) {
+        return pairs[a] < pairs[b];
+    });
+    return order;
+}
+
+}
+
 //! calculates (weighted) dependence measures.
 //! @param x, y input data.
 //! @param method the dependence measure; see details for possible values. 
@@ -36,6 +196,9 @@ namespace utils {
 //!   - `"kendall"`, `"ktau"`, `"tau"`: Kendall's \f$ \tau \f$  
 //!   - `"blomqvist"`, `"bbeta"`, `"beta"`: Blomqvist's \f$ \beta \f$  
 //!   - `"hoeffding"`, `"hoeffd"`, `"d"`: Hoeffding's \f$ D \f$  
+//!   - `"chatterjee"`, `"xi"`: Chatterjee's \f$ \xi \f$  
+//!   - `"dcor"`, `"distance"`: distance correlation  
+//!   - `"htau"`, `"hyperbolic"`: hyperbolic weighted Kendall's \f$ \tau \f$  
 //! 
 //! @return the dependence measure
 inline double wdm(const Eigen::VectorXd& x,
@@ -57,6 +220,7 @@ inline double wdm(const Eigen::VectorXd& x,
 //! @param weights an optional vector of weights for the data.
 //! @param remove_missing if `true`, all observations containing a `nan` are
 //!    removed; otherwise throws an error if `nan`s are present.
+//! @param num_threads the number of threads to use; `0` uses all cores.
 //! @details
 //! Available methods:
 //!   - `"pearson"`, `"prho"`, `"cor"`: Pearson correlation  
@@ -64,30 +228,152 @@ inline double wdm(const Eigen::VectorXd& x,
 //!   - `"kendall"`, `"ktau"`, `"tau"`: Kendall's \f$ \tau \f$  
 //!   - `"blomqvist"`, `"bbeta"`, `"beta"`: Blomqvist's \f$ \beta \f$  
 //!   - `"hoeffding"`, `"hoeffd"`, `"d"`: Hoeffding's \f$ D \f$  
+//!   - `"chatterjee"`, `"xi"`: Chatterjee's \f$ \xi \f$  
+//!   - `"dcor"`, `"distance"`: distance correlation  
+//!   - `"htau"`, `"hyperbolic"`: hyperbolic weighted Kendall's \f$ \tau \f$  
 //! 
-//! @return a matrix of pairwise dependence measures.
+//! With missing values, Pearson correlations of all pairs (each on its own
+//! complete observations) are computed at once from matrix products (see
+//! `impl::prho_pairwise_complete()`); for Spearman's \f$ \rho \f$ on
+//! pre-ranked data, use `"pearson"`.
+//!
+//! @return a matrix of pairwise dependence measures. For asymmetric
+//!   measures, entry `(i, j)` is the measure between columns `i` (as `x`)
+//!   and `j` (as `y`). The diagonal is one, except for Hoeffding's
+//!   \f$ D \f$ and Chatterjee's \f$ \xi \f$, where it is the measure of
+//!   each column with itself (see `methods::has_unit_diagonal()`).
 inline Eigen::MatrixXd wdm(const Eigen::MatrixXd& x,
                            std::string method,
                            Eigen::VectorXd weights = Eigen::VectorXd(),
-                           bool remove_missing = true)
+                           bool remove_missing = true,
+                           size_t num_threads = 1)
 {
     size_t d = x.cols();
     if (d == 1)
         throw std::runtime_error("x must have at least 2 columns.");
-    
+
+    WDM_TRACE_SCOPE("wdm matrix", 0, d);
+    std::vector<double> w = utils::convert_vec(weights);
+    if ((w.size() > 0) && (w.size() != static_cast<size_t>(x.rows())))
+        throw std::runtime_error("x, y, and weights must have the same size.");
+    if (methods::is_pearson(method) && remove_missing &&
+        (x.hasNaN() || utils::any_nan(w)))
+        return impl::prho_pairwise_complete(x, w, num_threads);
+
+    impl::Prepared_columns cols(x, std::vector<bool>(d, true), method, w,
+                                num_threads);
+
+    // rows have decreasing amounts of work; they are handed out dynamically.
+    bool symmetric = methods::is_symmetric(method);
+    bool unit_diagonal = methods::has_unit_diagonal(method);
     Eigen::MatrixXd ms = Eigen::MatrixXd::Identity(d, d);
-    for (size_t i = 0; i < d; i++) {
+    utils::parallel_for(0, d, [&] (size_t i) {
+        if (!unit_diagonal)
+            ms(i, i) = impl::wdm_prepared(cols[i], cols[i], method, w,
+                                          remove_missing);
         for (size_t j = i + 1; j < d; j++) {
-            ms(i, j) = wdm(utils::convert_vec(x.col(i)),
-                           utils::convert_vec(x.col(j)),
-                           method,
-                           utils::convert_vec(weights),
-                           remove_missing);
-            ms(j, i) = ms(i, j);
+            ms(i, j) = impl::wdm_prepared(cols[i], cols[j], method, w,
+                                          remove_missing);
+            if (symmetric)
+                ms(j, i) = ms(i, j);
+            else
+                ms(j, i) = impl::wdm_prepared(cols[j], cols[i], method, w,
+                                              remove_missing);
         }
-    }
+    }, num_threads);
 
     return ms;
 }
 
+//! calculates (weighted) dependence measures for a list of column pairs.
+//! @param x input data.
+//! @param pairs the pairs of columns; for a pair `(i, j)`, column `i` is
+//!   used as `x` and column `j` as `y`.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing if `true`, all observations containing a `nan` are
+//!    removed (pairwise); otherwise throws an error if `nan`s are present.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @return the dependence measure of each pair (in the order of `pairs`).
+//! @details Only the referenced columns are prepared, each only once (see
+//!   `impl::Prepared_column`). Pairs are evaluated in parallel, grouped by
+//!   their first column.
+inline std::vector<double> wdm_pairs(
+    const Eigen::MatrixXd& x,
+    const std::vector<std::pair<size_t, size_t>>& pairs,
+    std::string method,
+    Eigen::VectorXd weights = Eigen::VectorXd(),
+    bool remove_missing = true,
+    size_t num_threads = 1)
+{
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    std::vector<bool> used = impl::check_pairs(x, pairs);
+    WDM_TRACE_SCOPE("wdm_pairs", 0, pairs.size());
+    std::vector<double> w = utils::convert_vec(weights);
+    impl::Prepared_columns cols(x, used, method, w, num_threads);
+
+    std::vector<size_t> order = impl::schedule_pairs(pairs);
+    std::vector<double> ms(pairs.size());
+    utils::parallel_for(0, pairs.size(), [&] (size_t k) {
+        const auto& pair = pairs[order[k]];
+        ms[order[k]] = impl::wdm_prepared(cols[pair.first],
+                                          cols[pair.second],
+                                          method,
+                                          w,
+                                          remove_missing);
+    }, num_threads, get_tuning().grain_size);
+
+    return ms;
+}
+
+//! independence tests for a list of column pairs.
+//! @param x, pairs, method, weights, remove_missing, num_threads see
+//!    `wdm_pairs()`.
+//! @param alternative the alternative hypothesis; see `Indep_test`.
+//! @return the test of each pair (in the order of `pairs`).
+//! @details For prepared columns (see `wdm_pairs()`), the tests are computed
+//!   from the estimates and the tie statistics of the columns.
+inline std::vector<Test_result> indep_test_pairs(
+    const Eigen::MatrixXd& x,
+    const std::vector<std::pair<size_t, size_t>>& pairs,
+    std::string method,
+    Eigen::VectorXd weights = Eigen::VectorXd(),
+    bool remove_missing = true,
+    std::string alternative = "two-sided",
+    size_t num_threads = 1)
+{
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    std::vector<bool> used = impl::check_pairs(x, pairs);
+    WDM_TRACE_SCOPE("indep_test_pairs", 0, pairs.size());
+    std::vector<double> w = utils::convert_vec(weights);
+    impl::Prepared_columns cols(x, used, method, w, num_threads);
+
+    // prepared columns give the estimate and everything else the test needs.
+    std::vector<size_t> order = impl::schedule_pairs(pairs);
+    std::vector<Test_result> tests(pairs.size());
+    utils::parallel_for(0, pairs.size(), [&] (size_t k) {
+        const auto& a = cols[pairs[order[k]].first];
+        const auto& b = cols[pairs[order[k]].second];
+        std::unique_ptr<Indep_test> test;
+        if (a.prepared() && b.prepared()) {
+            double est = impl::wdm_prepared(a, b, method, w, remove_missing);
+            test.reset(new Indep_test(est, method, x.rows(), w, alternative,
+                                      a.ties(), b.ties()));
+        } else {
+            test.reset(new Indep_test(a.data().to_vector(),
+                                      b.data().to_vector(), method, w,
+                                      remove_missing, alternative));
+        }
+        Test_result& result = tests[order[k]];
+        result.n_eff = test->n_eff();
+        result.estimate = test->estimate();
+        result.statistic = test->statistic();
+        result.p_value = test->p_value();
+    }, num_threads, get_tuning().grain_size);
+
+    return tests;
+}
+
 }
@@ -0,0 +1,226 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+namespace wdm {
+
+//! runs tasks submitted by the asynchronous functions (see `async.hpp`).
+//!
+//! Implement this interface to run the computations on an existing thread
+//! pool or event loop, and install it with `set_executor()`.
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    //! schedules a task; must not block until the task has run.
+    virtual void submit(std::function<void()> task) = 0;
+};
+
+//! an executor with a fixed number of threads that run tasks in the order
+//! they were submitted.
+class Thread_pool : public Executor {
+public:
+    //! @param num_threads the number of threads; `0` uses all cores.
+    explicit Thread_pool(size_t num_threads = 0)
+    {
+        num_threads = utils::resolve_num_threads(num_threads);
+        for (size_t t = 0; t < num_threads; t++)
+            workers_.emplace_back([this] { work(); });
+    }
+
+    //! runs all submitted tasks, then joins the threads.
+    ~Thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+    Thread_pool(const Thread_pool&) = delete;
+    Thread_pool& operator=(const Thread_pool&) = delete;
+
+    void submit(std::function<void()> task) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopped_)
+                throw std::runtime_error("thread pool has been stopped.");
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    //! the number of threads.
+    size_t num_threads() const { return workers_.size(); }
+
+private:
+    void work()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopped_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            // tasks report their own errors; an escaping exception must not
+            // take down the pool.
+            try {
+                task();
+            } catch (...) {}
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+};
+
+namespace utils {
+
+//! calls `f(i)` for all `i` in `[begin, end)` on the threads of a pool and
+//! the calling thread.
+//! @param begin, end the index range.
+//! @param f a function taking an index; calls for different indices must
+//!   not interfere with each other.
+//! @param pool the pool; its threads must not be busy with other tasks,
+//!   otherwise the call waits for them.
+//! @param grain_size number of consecutive indices a thread claims at once.
+//! @details Same as `parallel_for()` with `pool.num_threads() + 1` threads,
+//!   but for loops that run many times: the threads are started once with
+//!   the pool instead of once per loop. Ranges of a single chunk run on the
+//!   calling thread only.
+template<class F>
+inline void parallel_for(size_t begin,
+                         size_t end,
+                         F f,
+                         Thread_pool& pool,
+                         size_t grain_size = 1)
+{
+    if (end <= begin)
+        return;
+    grain_size = std::max(grain_size, static_cast<size_t>(1));
+    size_t num_chunks = (end - begin + grain_size - 1) / grain_size;
+    size_t num_helpers = std::min(pool.num_threads(), num_chunks - 1);
+    WDM_TRACE_SCOPE("parallel_for", begin, end);
+
+    std::atomic<size_t> next(begin);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t running = 0;
+    auto work = [&] {
+        while (!failed) {
+            size_t first = next.fetch_add(grain_size);
+            if (first >= end)
+                return;
+            WDM_TRACE_SCOPE("chunk", first, std::min(first + grain_size, end));
+            try {
+                for (size_t i = first; i < std::min(first + grain_size, end); i++)
+                    f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    for (size_t t = 0; t < num_helpers; t++) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running++;
+        }
+        try {
+            pool.submit([&] {
+                work();
+                // notify while holding the lock: the caller may return (and
+                // destroy `done`) as soon as it is released.
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--running == 0)
+                    done.notify_one();
+            });
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+            break;
+        }
+    }
+    work();
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return running == 0; });
+    if (error)
+        std::rethrow_exception(error);
+}
+
+}
+
+namespace impl {
+
+inline std::mutex& executor_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+inline std::shared_ptr<Executor>& executor_instance()
+{
+    static std::shared_ptr<Executor> executor;
+    return executor;
+}
+
+}
+
+//! the executor used by the asynchronous functions; a `Thread_pool` with
+//! one thread per core is created on first use unless another executor was
+//! set.
+inline std::shared_ptr<Executor> get_executor()
+{
+    std::lock_guard<std::mutex> lock(impl::executor_mutex());
+    auto& executor = impl::executor_instance();
+    if (!executor)
+        executor = std::make_shared<Thread_pool>();
+    return executor;
+}
+
+//! sets the executor used by the asynchronous functions.
+//! @param executor the new executor; `nullptr` restores the default.
+//! @details Tasks already submitted still run on the previous executor. If
+//!   this releases the last reference to a `Thread_pool`, the call blocks
+//!   until the pool has run its tasks.
+inline void set_executor(std::shared_ptr<Executor> executor)
+{
+    std::shared_ptr<Executor> previous;
+    {
+        std::lock_guard<std::mutex> lock(impl::executor_mutex());
+        previous = std::move(impl::executor_instance());
+        impl::executor_instance() = std::move(executor);
+    }
+}
+
+}
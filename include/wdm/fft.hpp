@@ -0,0 +1,133 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace wdm {
+
+namespace utils {
+
+typedef std::vector<std::complex<double>> Spectrum;
+
+//! smallest power of two that is at least `n`.
+inline size_t fft_size(size_t n)
+{
+    size_t size = 1;
+    while (size < n)
+        size *= 2;
+    return size;
+}
+
+//! in-place fast Fourier transform (iterative radix-2).
+//! @param a a sequence whose length is a power of two.
+//! @param inverse whether to compute the (unscaled) inverse transform.
+inline void fft(Spectrum& a, bool inverse = false)
+{
+    size_t n = a.size();
+    if (n < 2)
+        return;
+
+    // bit-reversal permutation
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(a[i], a[j]);
+    }
+
+    // twiddle factors are computed directly (not by repeated
+    // multiplication), which keeps the rounding error at O(log n).
+    const double pi = 3.141592653589793238462643383279502884;
+    double sign = inverse ? 1.0 : -1.0;
+    Spectrum twiddle(n / 2);
+    for (size_t k = 0; k < n / 2; k++) {
+        double angle = sign * 2 * pi * static_cast<double>(k) / n;
+        twiddle[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+
+    for (size_t len = 2; len <= n; len *= 2) {
+        size_t stride = n / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                std::complex<double> u = a[i + k];
+                std::complex<double> v = a[i + k + len / 2] * twiddle[k * stride];
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+//! spectra of two real sequences, zero-padded to length `size`, from a
+//! single complex transform.
+//! @param a, b real sequences of length at most `size`.
+//! @param size a power of two.
+//! @param fa, fb the spectra (output).
+inline void fft_real_pair(const std::vector<double>& a,
+                          const std::vector<double>& b,
+                          size_t size,
+                          Spectrum& fa,
+                          Spectrum& fb)
+{
+    Spectrum z(size);
+    for (size_t i = 0; i < a.size(); i++)
+        z[i].real(a[i]);
+    for (size_t i = 0; i < b.size(); i++)
+        z[i].imag(b[i]);
+    fft(z);
+
+    // separate the spectra using their Hermitian symmetry.
+    fa.resize(size);
+    fb.resize(size);
+    const std::complex<double> i_2(0.0, 2.0);
+    for (size_t k = 0; k < size; k++) {
+        std::complex<double> zk = z[k], zc = std::conj(z[(size - k) % size]);
+        fa[k] = (zk + zc) / 2.0;
+        fb[k] = (zk - zc) / i_2;
+    }
+}
+
+//! lagged cross products of real sequences from their spectra; computes two
+//! sets with a single inverse transform.
+//! @param fa1, fb1, fa2, fb2 spectra of sequences `a1`, `b1`, `a2`, `b2`
+//!   (see `fft_real_pair()`), zero-padded to a length of at least
+//!   `n + max_lag`.
+//! @param max_lag the largest lag.
+//! @param c1, c2 (output) vectors of length `2 * max_lag + 1`, where
+//!   `c1[max_lag + k]` is the sum of `a1[t] * b1[t + k]` over all `t`.
+inline void fft_cross_products(const Spectrum& fa1,
+                               const Spectrum& fb1,
+                               const Spectrum& fa2,
+                               const Spectrum& fb2,
+                               size_t max_lag,
+                               std::vector<double>& c1,
+                               std::vector<double>& c2)
+{
+    size_t size = fa1.size();
+    Spectrum z(size);
+    const std::complex<double> i_1(0.0, 1.0);
+    for (size_t k = 0; k < size; k++)
+        z[k] = std::conj(fa1[k]) * fb1[k] + i_1 * std::conj(fa2[k]) * fb2[k];
+    fft(z, true);
+
+    c1.resize(2 * max_lag + 1);
+    c2.resize(2 * max_lag + 1);
+    for (size_t i = 0; i <= 2 * max_lag; i++) {
+        size_t k = (i >= max_lag) ? i - max_lag : size - (max_lag - i);
+        c1[i] = z[k].real() / size;
+        c2[i] = z[k].imag() / size;
+    }
+}
+
+}
+
+}
@@ -0,0 +1,312 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "../wdm.hpp"
+#include "bbeta.hpp"
+#include "ktau.hpp"
+#include "parallel.hpp"
+#include "prho.hpp"
+#include "ranks.hpp"
+#include "utils.hpp"
+
+namespace wdm {
+
+//! results of `wdm_grouped()`.
+template<class Key>
+struct Grouped_estimates {
+    std::vector<Key> keys;         //!< the distinct group keys (ascending).
+    std::vector<double> estimates; //!< the dependence measure of each group.
+};
+
+//! results of `indep_test_grouped()`.
+template<class Key>
+struct Grouped_tests {
+    std::vector<Key> keys;          //!< the distinct group keys (ascending).
+    std::vector<Test_result> tests; //!< the independence test of each group.
+};
+
+namespace impl {
+
+//! the order of all observations by (group, x, y), and the boundaries of
+//! the groups.
+//!
+//! Missing values are sorted last within each group. Since groups are
+//! contiguous and sorted by x and y, Kendall's \f$ \tau \f$ only needs the
+//! tie counts and merge sort of each segment; Spearman's \f$ \rho \f$,
+//! Blomqvist's \f$ \beta \f$, and Kendall's tie statistics only need to
+//! sort the segment by y.
+template<class Key>
+class Grouped_data {
+public:
+    Grouped_data(const std::vector<double>& x,
+                 const std::vector<double>& y,
+                 const std::vector<Key>& groups,
+                 const std::vector<double>& weights) :
+        x_(x),
+        y_(y),
+        weights_(weights)
+    {
+        utils::check_sizes(x, y, weights);
+        if (groups.size() != x.size())
+            throw std::runtime_error("x, y, and groups must have the same size.");
+        for (const Key& g : groups) {
+            if (g != g)
+                throw std::runtime_error("group keys must not be nan.");
+        }
+
+        size_t n = x.size();
+        perm_.resize(n);
+        for (size_t i = 0; i < n; i++)
+            perm_[i] = i;
+        auto less = [] (double a, double b) {
+            return !std::isnan(a) && (std::isnan(b) || (a < b));
+        };
+        std::sort(perm_.begin(), perm_.end(), [&] (size_t i, size_t j) {
+            if (groups[i] < groups[j])
+                return true;
+            if (groups[j] < groups[i])
+                return false;
+            if (less(x[i], x[j]))
+                return true;
+            if (less(x[j], x[i]))
+                return false;
+            return less(y[i], y[j]);
+        });
+
+        for (size_t i = 0; i < n; i++) {
+            if ((i == 0) || (groups[perm_[i - 1]] < groups[perm_[i]])) {
+                keys_.push_back(groups[perm_[i]]);
+                starts_.push_back(i);
+            }
+        }
+        starts_.push_back(n);
+    }
+
+    const std::vector<Key>& keys() const { return keys_; }
+
+    double estimate(size_t g, const std::string& method, bool remove_missing) const
+    {
+        return estimate(g, segment(g), method, remove_missing);
+    }
+
+    Test_result test(size_t g,
+                     const std::string& method,
+                     bool remove_missing,
+                     const std::string& alternative) const
+    {
+        // the tests of xi and dcor need the data; for all others, the
+        // estimate and (for Kendall's tau) the tie statistics suffice.
+        Segment s = segment(g);
+        if (complete(s, method) && !methods::is_chatterjee(method) &&
+            !methods::is_dcor(method)) {
+            Margin_ties ties_x, ties_y;
+            if (methods::is_kendall(method)) {
+                std::vector<size_t> order = order_y(s);
+                ties_x = margin_ties_sorted(s.x, s.w);
+                ties_y = margin_ties_sorted(gather(s.y, order),
+                                            gather(s.w, order));
+            }
+            return result(Indep_test(estimate(g, s, method, remove_missing),
+                                     method,
+                                     s.x.size(),
+                                     s.w,
+                                     alternative,
+                                     ties_x,
+                                     ties_y));
+        }
+
+        std::vector<size_t> idx = indices(g);
+        return result(Indep_test(gather(x_, idx),
+                                 gather(y_, idx),
+                                 method,
+                                 gather(weights_, idx),
+                                 remove_missing,
+                                 alternative));
+    }
+
+private:
+    //! the data of a group in (x, y) order.
+    struct Segment {
+        std::vector<double> x, y, w;
+    };
+
+    double estimate(size_t g,
+                    const Segment& s,
+                    const std::string& method,
+                    bool remove_missing) const
+    {
+        if (complete(s, method)) {
+            if (methods::is_kendall(method))
+                return ktau_sorted(s.x, s.y, s.w);
+            if (methods::is_pearson(method))
+                return prho(s.x, s.y, s.w);
+            if (methods::is_spearman(method)) {
+                std::vector<size_t> order = order_y(s);
+                std::vector<double> ry(s.y.size()),
+                    ranks = rank0_sorted(gather(s.y, order), gather(s.w, order));
+                for (size_t k = 0; k < order.size(); k++)
+                    ry[order[k]] = ranks[k];
+                return prho(rank0_sorted(s.x, s.w), ry, s.w);
+            }
+            if (methods::is_blomqvist(method)) {
+                std::vector<size_t> order = order_y(s);
+                double med_y = median_sorted(gather(s.y, order),
+                                             gather(s.w, order));
+                return bbeta(s.x, s.y, median_sorted(s.x, s.w), med_y, s.w);
+            }
+        }
+        std::vector<size_t> idx = indices(g);
+        return wdm(gather(x_, idx),
+                   gather(y_, idx),
+                   method,
+                   gather(weights_, idx),
+                   remove_missing);
+    }
+
+    Segment segment(size_t g) const
+    {
+        std::vector<size_t> idx(perm_.begin() + starts_[g],
+                                perm_.begin() + starts_[g + 1]);
+        Segment s;
+        s.x = gather(x_, idx);
+        s.y = gather(y_, idx);
+        s.w = gather(weights_, idx);
+        return s;
+    }
+
+    //! whether a segment can be used without further preprocessing.
+    static bool complete(const Segment& s, const std::string& method)
+    {
+        return !utils::any_nan(s.x) && !utils::any_nan(s.y) &&
+            !utils::any_nan(s.w) && (s.x.size() >= methods::get_min_nobs(method));
+    }
+
+    //! the order of a segment by y (the segment is already sorted by x).
+    static std::vector<size_t> order_y(const Segment& s)
+    {
+        std::vector<size_t> order(s.y.size());
+        for (size_t k = 0; k < order.size(); k++)
+            order[k] = k;
+        std::sort(order.begin(), order.end(), [&] (size_t i, size_t j) {
+            return s.y[i] < s.y[j];
+        });
+        return order;
+    }
+
+    static Test_result result(const Indep_test& test)
+    {
+        Test_result result;
+        result.n_eff = test.n_eff();
+        result.estimate = test.estimate();
+        result.statistic = test.statistic();
+        result.p_value = test.p_value();
+        return result;
+    }
+
+    //! the observations of group `g` in their original order (some measures
+    //! depend on the order of tied observations).
+    std::vector<size_t> indices(size_t g) const
+    {
+        std::vector<size_t> idx(perm_.begin() + starts_[g],
+                                perm_.begin() + starts_[g + 1]);
+        std::sort(idx.begin(), idx.end());
+        return idx;
+    }
+
+    static std::vector<double> gather(const std::vector<double>& v,
+                                      const std::vector<size_t>& idx)
+    {
+        if (v.size() == 0)
+            return std::vector<double>();
+        std::vector<double> res(idx.size());
+        for (size_t i = 0; i < idx.size(); i++)
+            res[i] = v[idx[i]];
+        return res;
+    }
+
+    const std::vector<double>& x_;
+    const std::vector<double>& y_;
+    const std::vector<double>& weights_;
+    std::vector<size_t> perm_;
+    std::vector<Key> keys_;
+    std::vector<size_t> starts_;
+};
+
+}
+
+//! calculates (weighted) dependence measures within groups.
+//! @param x, y input data.
+//! @param groups the group of each observation; keys must be ordered by
+//!    `<` (e.g., numbers or strings) and must not be `nan`.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing if `true`, all observations containing a `nan` are
+//!    removed; otherwise throws an error if `nan`s are present.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @return the group keys in ascending order and the dependence measure of
+//!   each group.
+//! @details All observations are sorted by group, `x`, and `y` once; groups
+//!   are then processed in parallel. Kendall's \f$ \tau \f$ and Pearson's
+//!   \f$ \rho \f$ do not need to sort the groups again, Spearman's
+//!   \f$ \rho \f$ and Blomqvist's \f$ \beta \f$ only sort them by `y`.
+//!   The other measures, and groups with missing values, are computed by
+//!   `wdm()` on the observations of each group.
+template<class Key>
+inline Grouped_estimates<Key> wdm_grouped(
+    const std::vector<double>& x,
+    const std::vector<double>& y,
+    const std::vector<Key>& groups,
+    std::string method,
+    const std::vector<double>& weights = std::vector<double>(),
+    bool remove_missing = true,
+    size_t num_threads = 1)
+{
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    impl::Grouped_data<Key> data(x, y, groups, weights);
+    Grouped_estimates<Key> result;
+    result.keys = data.keys();
+    result.estimates.resize(result.keys.size());
+    utils::parallel_for(0, result.keys.size(), [&] (size_t g) {
+        result.estimates[g] = data.estimate(g, method, remove_missing);
+    }, num_threads, get_tuning().grain_size);
+    return result;
+}
+
+//! independence tests within groups.
+//! @param x, y, groups, method, weights, remove_missing, num_threads see
+//!    `wdm_grouped()`.
+//! @param alternative the alternative hypothesis; see `Indep_test`.
+//! @return the group keys in ascending order and the test of each group.
+//! @details Except for Chatterjee's \f$ \xi \f$ and the distance
+//!   correlation, the tests only need the estimate from `wdm_grouped()` and,
+//!   for Kendall's \f$ \tau \f$, the tie statistics of each sorted group.
+template<class Key>
+inline Grouped_tests<Key> indep_test_grouped(
+    const std::vector<double>& x,
+    const std::vector<double>& y,
+    const std::vector<Key>& groups,
+    std::string method,
+    const std::vector<double>& weights = std::vector<double>(),
+    bool remove_missing = true,
+    std::string alternative = "two-sided",
+    size_t num_threads = 1)
+{
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    impl::Grouped_data<Key> data(x, y, groups, weights);
+    Grouped_tests<Key> result;
+    result.keys = data.keys();
+    result.tests.resize(result.keys.size());
+    utils::parallel_for(0, result.keys.size(), [&] (size_t g) {
+        result.tests[g] = data.test(g, method, remove_missing, alternative);
+    }, num_threads, get_tuning().grain_size);
+    return result;
+}
+
+}
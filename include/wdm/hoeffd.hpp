@@ -40,12 +40,19 @@ inline double hoeffd(std::vector<double> x,
     // 2. Compute (weighted) bivariate ranks (number of points w/ both columns
     // less than the ith row).
     std::vector<double> R_XY, S_XY, T_XY, U_XY;
-    R_XY = bivariate_rank(x, y, weights);
     if (weights.size() > 0) {
-        S_XY = bivariate_rank(x, y, utils::pow(weights, 2));
-        T_XY = bivariate_rank(x, y, utils::pow(weights, 3));
-        U_XY = bivariate_rank(x, y, utils::pow(weights, 4));
+        std::vector<std::vector<double>> ranks = bivariate_rank(x, y, {
+            weights,
+            utils::pow(weights, 2),
+            utils::pow(weights, 3),
+            utils::pow(weights, 4)
+        });
+        R_XY = ranks[0];
+        S_XY = ranks[1];
+        T_XY = ranks[2];
+        U_XY = ranks[3];
     } else {
+        R_XY = bivariate_rank(x, y);
         S_XY = R_XY;
         T_XY = R_XY;
         U_XY = R_XY;
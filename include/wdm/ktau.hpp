@@ -6,7 +6,10 @@
 
 #pragma once
 
+#include "types.hpp"
 #include "utils.hpp"
+#include <limits>
+#include <utility>
 
 namespace wdm {
 
@@ -21,19 +24,14 @@ inline void normalize_weights(std::vector<double>& w)
     }
 }
 
-//! fast calculation of the weighted Kendall's tau.
-//! @param x, y input data.
+//! weighted Kendall's tau for data that is already sorted.
+//! @param x, y input data, sorted in x order with ties broken according to y.
 //! @param weights an optional vector of weights for the data.
-inline double ktau(std::vector<double> x,
-                   std::vector<double> y,
-                   std::vector<double> weights = std::vector<double>())
+inline double ktau_sorted(const std::vector<double>& x,
+                          std::vector<double> y,
+                          std::vector<double> weights = std::vector<double>())
 {
-    utils::check_sizes(x, y, weights);
-
-    // 1.1 Sort x, y, and weights in x order; break ties in according to y.
-    utils::sort_all(x, y, weights);
-
-    // 1.2 Count pairs of tied x and simultaneous ties in x and y.
+    // 1. Count pairs of tied x and simultaneous ties in x and y.
     double ties_x = utils::count_tied_pairs(x, weights);
     double ties_both = utils::count_joint_ties(x, y, weights);
 
@@ -55,42 +53,200 @@ inline double ktau(std::vector<double> x,
     return tau;
 }
 
-//! tie adjustment for Kendall's test statistic
-inline double ktau_stat_adjust(
-    std::vector<double> x,
-    std::vector<double> y,
-    std::vector<double> weights)
+//! fast calculation of the weighted Kendall's tau.
+//! @param x, y input data.
+//! @param weights an optional vector of weights for the data.
+inline double ktau(std::vector<double> x,
+                   std::vector<double> y,
+                   std::vector<double> weights = std::vector<double>())
 {
     utils::check_sizes(x, y, weights);
 
-    // 1.1 Sort x, y, and weights in x order; break ties in according to y.
+    // Sort x, y, and weights in x order; break ties in according to y.
     utils::sort_all(x, y, weights);
+    return ktau_sorted(x, std::move(y), std::move(weights));
+}
+
+//! weighted Kendall's tau for a given importance score of each observation.
+//! @param x, y input data.
+//! @param weights weights of the observations.
+//! @param scores weights times importance of the observations; a pair (a, b)
+//!   has weight w_a * w_b * (h_a + h_b) = s_a * w_b + w_a * s_b.
+inline double htau_scored(const std::vector<double>& x,
+                          const std::vector<double>& y,
+                          const std::vector<double>& weights,
+                          const std::vector<double>& scores)
+{
+    size_t n = x.size();
+
+    // 1.1 Sort x, y, weights, and scores in x order; break ties according
+    // to y.
+    std::vector<size_t> perm(n);
+    for (size_t i = 0; i < n; i++)
+        perm[i] = i;
+    std::sort(perm.begin(), perm.end(), [&] (size_t i, size_t j) {
+        return (x[i] < x[j]) || ((x[i] == x[j]) && (y[i] < y[j]));
+    });
+    std::vector<double> xx(n), yy(n), ww(n), ss(n);
+    for (size_t i = 0; i < n; i++) {
+        xx[i] = x[perm[i]];
+        yy[i] = y[perm[i]];
+        ww[i] = weights[perm[i]];
+        ss[i] = scores[perm[i]];
+    }
+
+    // 1.2 Count pairs of tied x and simultaneous ties in x and y.
+    double ties_x = utils::count_tied_pairs_additive(xx, yy, ww, ss);
+    double ties_both = utils::count_tied_pairs_additive(xx, yy, ww, ss, true);
 
-    // 1.2 Count pairs and triplets of tied x and simultaneous ties in x and y.
-    double pair_x = utils::count_tied_pairs(x, weights);
-    double trip_x = utils::count_tied_triplets(x, weights);
-    double v_x = utils::count_ties_v(x, weights);
+    // 2.1 Sort y again and count exchanges (= discordant pairs).
+    double num_d = 0.0;
+    utils::merge_sort_additive(yy, ww, ss, num_d);
 
-    // 2.1 Sort y and weights in y order; break ties according to x.
-    utils::sort_all(y, x, weights);
+    // 2.2 Count pairs of tied y.
+    double ties_y = utils::count_tied_pairs_additive(yy, yy, ww, ss);
+
+    // 3. Calculate the weighted tau (undefined if x or y is constant; the
+    // scores are not exact in floating point, so the tie counts would not
+    // cancel exactly).
+    if ((n == 0) || (xx[0] == xx[n - 1]) || (yy[0] == yy[n - 1]))
+        return std::numeric_limits<double>::quiet_NaN();
+    double w_sum = utils::sum(ww), num_pairs = 0.0;
+    for (size_t i = 0; i < n; i++)
+        num_pairs += ss[i] * (w_sum - ww[i]);
+    double num_c = num_pairs - (num_d + ties_x + ties_y - ties_both);
+    return (num_c - num_d) /
+        std::sqrt((num_pairs - ties_x) * (num_pairs - ties_y));
+}
 
-    // 2.2 Count pairs and triplets of tied y.
-    double pair_y = utils::count_tied_pairs(y, weights);
-    double trip_y = utils::count_tied_triplets(y, weights);
-    double v_y = utils::count_ties_v(y, weights);
+//! hyperbolic scores h = 1 / (r + 1), where r is the rank of an observation
+//! in decreasing lexicographic order of (x, y) (ties by position).
+inline std::vector<double> htau_scores(const std::vector<double>& x,
+                                       const std::vector<double>& y)
+{
+    size_t n = x.size();
+    std::vector<size_t> perm(n);
+    for (size_t i = 0; i < n; i++)
+        perm[i] = i;
+    std::sort(perm.begin(), perm.end(), [&] (size_t i, size_t j) {
+        if (x[i] != x[j])
+            return x[i] > x[j];
+        if (y[i] != y[j])
+            return y[i] > y[j];
+        return i < j;
+    });
+    std::vector<double> h(n);
+    for (size_t r = 0; r < n; r++)
+        h[perm[r]] = 1.0 / (r + 1.0);
+    return h;
+}
 
-    // 3. Calculate adjustment factor.
+//! fast calculation of the weighted hyperbolic Kendall's tau (Vigna, 2015).
+//! @param x, y input data.
+//! @param weights an optional vector of weights for the data.
+//! @details Each pair of observations (a, b) is weighted by
+//!   w_a * w_b * (h_a + h_b), where h = 1 / (r + 1) and r is the rank of an
+//!   observation by decreasing importance (additive hyperbolic weigher).
+//!   As in `scipy.stats.weightedtau()`, the result is the average of the
+//!   values obtained with the decreasing lexicographic ranks by (x, y) and
+//!   by (y, x); it is therefore symmetric. Runs in O(n log n) time.
+inline double htau(const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   std::vector<double> weights = std::vector<double>())
+{
+    utils::check_sizes(x, y, weights);
     if (weights.size() == 0)
         weights = std::vector<double>(x.size(), 1.0);
+
+    // observations with zero weight do not contribute to any pair, but
+    // still count for the ranks. They are dropped after scoring, so that
+    // degenerate samples are detected exactly (and not subject to
+    // rounding).
+    double tau = 0.0;
+    for (auto h : {htau_scores(x, y), htau_scores(y, x)}) {
+        std::vector<double> xx, yy, ww, ss;
+        for (size_t i = 0; i < h.size(); i++) {
+            if (weights[i] == 0.0)
+                continue;
+            xx.push_back(x[i]);
+            yy.push_back(y[i]);
+            ww.push_back(weights[i]);
+            ss.push_back(h[i] * weights[i]);
+        }
+        tau += htau_scored(xx, yy, ww, ss) / 2;
+    }
+
+    return tau;
+}
+
+//! tie statistics of a variable that is sorted in ascending order.
+//! @param x sorted input data.
+//! @param weights an optional vector of weights for the data (in the same
+//!   order).
+inline Margin_ties margin_ties_sorted(const std::vector<double>& x,
+                                      const std::vector<double>& weights)
+{
+    Margin_ties ties;
+    ties.pairs = utils::count_tied_pairs(x, weights);
+    ties.triplets = utils::count_tied_triplets(x, weights);
+    ties.v = utils::count_ties_v(x, weights);
+    return ties;
+}
+
+//! tie statistics of a variable.
+//! @param x input data.
+//! @param weights an optional vector of weights for the data.
+inline Margin_ties margin_ties(std::vector<double> x,
+                               std::vector<double> weights)
+{
+    // the statistics only depend on the weights within ties, not on their
+    // order.
+    std::vector<size_t> perm = utils::get_order(x);
+    std::vector<double> xx(x.size()), ww(weights.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        xx[i] = x[perm[i]];
+        if (weights.size() > 0)
+            ww[i] = weights[perm[i]];
+    }
+    return margin_ties_sorted(xx, ww);
+}
+
+//! tie adjustment for Kendall's test statistic from the tie statistics of
+//! both variables.
+//! @param ties_x, ties_y tie statistics of x and y.
+//! @param weights weights for the data; if empty, `n` unit weights.
+//! @param n the number of observations.
+inline double ktau_stat_adjust(const Margin_ties& ties_x,
+                               const Margin_ties& ties_y,
+                               std::vector<double> weights,
+                               size_t n)
+{
+    if (weights.size() == 0)
+        weights = std::vector<double>(n, 1.0);
     double s = utils::sum(weights);
     double s2 = utils::perm_sum(weights, 2);
     double s3 = utils::perm_sum(weights, 3);
     double r = s / utils::sum(utils::pow(weights, 2));
     double v_0 = 2 * s2 * (2 * s) * std::pow(r, 3);
-    double v_1 = 2 * pair_x * 2 * pair_y / (2 * 2 * s2) * std::pow(r, 2);
-    double v_2 = 6 * trip_x * 6 * trip_y / (9 * 6 * s3) * std::pow(r, 3);
-    double v = (v_0 - std::pow(r, 3) * (v_x - v_y)) / 18 + (v_1 + v_2);
-    return std::pow(r, 2) * std::sqrt((s2 - pair_x) * (s2 - pair_y) / v);
+    double v_1 = 2 * ties_x.pairs * 2 * ties_y.pairs / (2 * 2 * s2) * std::pow(r, 2);
+    double v_2 = 6 * ties_x.triplets * 6 * ties_y.triplets / (9 * 6 * s3) *
+        std::pow(r, 3);
+    double v = (v_0 - std::pow(r, 3) * (ties_x.v + ties_y.v)) / 18 + (v_1 + v_2);
+    return std::pow(r, 2) *
+        std::sqrt((s2 - ties_x.pairs) * (s2 - ties_y.pairs) / v);
+}
+
+//! tie adjustment for Kendall's test statistic
+inline double ktau_stat_adjust(
+    const std::vector<double>& x,
+    const std::vector<double>& y,
+    const std::vector<double>& weights)
+{
+    utils::check_sizes(x, y, weights);
+    return ktau_stat_adjust(margin_ties(x, weights),
+                            margin_ties(y, weights),
+                            weights,
+                            x.size());
 }
 
 }
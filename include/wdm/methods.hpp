@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <string>
+
 namespace wdm {
 
 namespace methods {
@@ -30,6 +32,51 @@ inline bool is_blomqvist(std::string method)
 {
     return (method == "blomqvist") || (method == "bbeta") || (method == "beta");
 }
+inline bool is_chatterjee(std::string method)
+{
+    return (method == "chatterjee") || (method == "xi");
+}
+inline bool is_dcor(std::string method)
+{
+    return (method == "dcor") || (method == "distance");
+}
+inline bool is_htau(std::string method)
+{
+    return (method == "htau") || (method == "hyperbolic");
+}
+
+inline bool is_implemented(std::string method)
+{
+    return is_hoeffding(method) || is_kendall(method) || is_pearson(method) ||
+        is_spearman(method) || is_blomqvist(method) || is_chatterjee(method) ||
+        is_dcor(method) || is_htau(method);
+}
+
+//! whether an independence test is available for the measure.
+inline bool has_indep_test(std::string method)
+{
+    return !is_htau(method);
+}
+
+//! whether the independence test only has a two-sided version (the
+//! measure does not distinguish positive from negative association).
+inline bool is_two_sided_only(std::string method)
+{
+    return is_hoeffding(method) || is_dcor(method);
+}
+
+//! whether the measure is symmetric in its two arguments.
+inline bool is_symmetric(std::string method)
+{
+    return !is_chatterjee(method);
+}
+
+//! whether the measure of a (non-constant) variable with itself is always
+//! one; otherwise, the diagonal of dependence matrices must be computed.
+inline bool has_unit_diagonal(std::string method)
+{
+    return !is_hoeffding(method) && !is_chatterjee(method);
+}
 
 inline size_t get_min_nobs(std::string method)
 {
@@ -6,8 +6,13 @@
 
 #pragma once
 
+#include "methods.hpp"
+#include "status.hpp"
+#include <cmath>
 #include <limits>
-#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace wdm {
 
@@ -46,30 +51,99 @@ inline bool any_nan(const std::vector<double>& x) {
     return false;
 }
 
-inline std::string preproc(std::vector<double>& x,
-                           std::vector<double>& y,
-                           std::vector<double>& weights,
-                           std::string method,
-                           bool remove_missing)
+inline bool any_nan(const Strided_view& x) {
+    for (size_t i = 0; (i < x.size()); i++) {
+        if (std::isnan(x[i]))
+            return true;
+    }
+
+    return false;
+}
+
+//! whether all non-zero weights are equal (or there are none).
+inline bool equal_weights(const std::vector<double>& weights)
+{
+    double first = 0.0;
+    for (double w : weights) {
+        if (w == 0.0)
+            continue;
+        if (first == 0.0)
+            first = w;
+        else if (w != first)
+            return false;
+    }
+    return true;
+}
+
+//! removes or checks for missing values and checks the number of
+//! observations and the weights.
+//! @param x, y, weights input data; incomplete observations are removed if
+//!   `remove_missing = true`.
+//! @param method the dependence measure.
+//! @param remove_missing whether to remove incomplete observations.
+//! @return `Status::ok` if the measure can be computed;
+//!   `Status::all_missing` or `Status::too_few_observations` if there are not
+//!   enough (complete) observations; `Status::missing_values` if there are
+//!   `nan`s and `remove_missing = false`; `Status::invalid_weights` if the
+//!   method does not support the weights.
+inline Status preproc(std::vector<double>& x,
+                      std::vector<double>& y,
+                      std::vector<double>& weights,
+                      std::string method,
+                      bool remove_missing)
 {
-    size_t min_nobs = (method == "hoeffding") ? 5 : 2;
+    size_t min_nobs = methods::get_min_nobs(method);
     if (remove_missing) {
+        bool any_obs = (x.size() > 0);
         utils::remove_incomplete(x, y, weights);
+        if (any_obs && (x.size() == 0))
+            return Status::all_missing;
         if (x.size() < min_nobs)
-            return "return_nan";
+            return Status::too_few_observations;
     } else {
-        std::stringstream msg;
-        if (utils::any_nan(x) || utils::any_nan(y) || utils::any_nan(weights)) {
-            msg << "there are missing values in the data; " <<
-                   "try remove_missing = TRUE";
-        } else if (x.size() < min_nobs) {
-            msg << "need at least " << min_nobs << "observations.";
-        }
-        if (!msg.str().empty())
-            throw std::runtime_error(msg.str());
+        if (utils::any_nan(x) || utils::any_nan(y) || utils::any_nan(weights))
+            return Status::missing_values;
+        if (x.size() < min_nobs)
+            return Status::too_few_observations;
+    }
+    if (methods::is_chatterjee(method) && !equal_weights(weights))
+        return Status::invalid_weights;
+
+    return Status::ok;
+}
+
+//! throws an error describing a (non-ok) status returned by `preproc()`.
+[[noreturn]] inline void throw_preproc_error(Status status, std::string method)
+{
+    if (status == Status::too_few_observations) {
+        throw std::runtime_error(
+            "need at least " + std::to_string(methods::get_min_nobs(method)) +
+            " observations.");
+    }
+    throw std::runtime_error(status_message(status));
+}
+
+//! whether x or y is constant (ignoring observations with zero weight).
+//! @param x, y, weights input data (without missing values).
+inline bool any_constant(const std::vector<double>& x,
+                         const std::vector<double>& y,
+                         const std::vector<double>& weights) noexcept
+{
+    bool weighted = (weights.size() > 0);
+    size_t first = 0;
+    while (weighted && (first < x.size()) && (weights[first] == 0.0))
+        first++;
+    bool x_const = true, y_const = true;
+    for (size_t i = first + 1; i < x.size(); i++) {
+        if (weighted && (weights[i] == 0.0))
+            continue;
+        x_const = x_const && (x[i] == x[first]);
+        y_const = y_const && (y[i] == y[first]);
+        if (!x_const && !y_const)
+            return false;
     }
 
-    return "continue";
+    return true;
 }
 
 } // end utils
@@ -0,0 +1,133 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "reduce.hpp"
+#include "tuning.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef WDM_TRACE
+#include "trace.hpp"
+#elif !defined(WDM_TRACE_SCOPE)
+#define WDM_TRACE_SCOPE(...)
+#endif
+
+namespace wdm {
+
+namespace utils {
+
+//! resolves a requested number of threads; `0` means one thread per
+//! hardware core.
+inline size_t resolve_num_threads(size_t num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+    return std::max(num_threads, static_cast<size_t>(1));
+}
+
+//! calls `f(i)` for all `i` in `[begin, end)`, possibly in parallel.
+//! @param begin, end the index range.
+//! @param f a function taking an index; calls for different indices must
+//!   not interfere with each other.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @param grain_size number of consecutive indices a thread claims at once.
+//! @details The calling thread takes part in the work. Indices are handed
+//!   out dynamically, so uneven work per index is balanced automatically.
+//!   If calls throw, no further indices are started and the first exception
+//!   is rethrown in the calling thread.
+//!   With `WDM_TRACE`, the call and each chunk of indices are traced (see
+//!   `trace.hpp`).
+template<class F>
+inline void parallel_for(size_t begin,
+                         size_t end,
+                         F f,
+                         size_t num_threads = 1,
+                         size_t grain_size = 1)
+{
+    if (end <= begin)
+        return;
+    grain_size = std::max(grain_size, static_cast<size_t>(1));
+    size_t num_chunks = (end - begin + grain_size - 1) / grain_size;
+    num_threads = std::min(resolve_num_threads(num_threads), num_chunks);
+    WDM_TRACE_SCOPE("parallel_for", begin, end);
+    if (num_threads == 1) {
+        for (size_t i = begin; i < end; i++)
+            f(i);
+        return;
+    }
+
+    std::atomic<size_t> next(begin);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&] {
+        while (!failed) {
+            size_t first = next.fetch_add(grain_size);
+            if (first >= end)
+                return;
+            WDM_TRACE_SCOPE("chunk", first, std::min(first + grain_size, end));
+            try {
+                for (size_t i = first; i < std::min(first + grain_size, end); i++)
+                    f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < num_threads; t++)
+        workers.emplace_back(work);
+    work();
+    for (auto& worker : workers)
+        worker.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+//! deterministic sums of `f(i)` for `i` in `[0, n)`, possibly in parallel.
+//! @param n the number of terms.
+//! @param f a function taking an index and returning `K` terms as a
+//!   `std::array<double, K>`; must be safe to call concurrently.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @details Chunks are summed in parallel, but the result is bitwise
+//!   identical to `reduce_sums()` for any number of threads.
+template<size_t K, class F>
+inline std::array<double, K> parallel_reduce_sums(size_t n,
+                                                  F f,
+                                                  size_t num_threads = 1)
+{
+    std::vector<std::array<double, K>> sums(
+        (n + reduce_chunk_size - 1) / reduce_chunk_size);
+    parallel_for(0, sums.size(), [&] (size_t j) {
+        size_t begin = j * reduce_chunk_size;
+        sums[j] = chunk_sums<K>(begin, std::min(begin + reduce_chunk_size, n), f);
+    }, num_threads, get_tuning().grain_size);
+    return combine_sums(sums);
+}
+
+//! deterministic sum of `f(i)` for `i` in `[0, n)`, possibly in parallel;
+//! see `parallel_reduce_sums()`.
+template<class F>
+inline double parallel_reduce_sum(size_t n, F f, size_t num_threads = 1)
+{
+    return parallel_reduce_sums<1>(n, [&] (size_t i) {
+        return std::array<double, 1>{{f(i)}};
+    }, num_threads)[0];
+}
+
+}
+
+}
@@ -0,0 +1,210 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "eigen.hpp"
+
+namespace wdm {
+
+//! partial dependence measures and their test statistics; see
+//! `indep_test_partial()` and `indep_test_partial_cor()`.
+struct Partial_tests {
+    Eigen::MatrixXd estimates;  //!< partial dependence measures.
+    Eigen::MatrixXd statistics; //!< test statistics.
+    Eigen::MatrixXd p_values;   //!< p-values.
+    double n_eff;               //!< the effective sample size.
+};
+
+namespace impl {
+
+//! inverts a positive definite matrix from its Cholesky decomposition; the
+//! columns of the inverse are computed in parallel blocks.
+inline Eigen::MatrixXd llt_inverse(const Eigen::LLT<Eigen::MatrixXd>& llt,
+                                   size_t num_threads)
+{
+    size_t d = llt.rows();
+    const size_t block = 32;
+    Eigen::MatrixXd inv(d, d);
+    utils::parallel_for(0, (d + block - 1) / block, [&] (size_t b) {
+        size_t first = b * block, cols = std::min(block, d - first);
+        Eigen::MatrixXd e = Eigen::MatrixXd::Identity(d, d).middleCols(first, cols);
+        inv.middleCols(first, cols) = llt.solve(e);
+    }, num_threads);
+    return inv;
+}
+
+}
+
+//! calculates full-order partial dependence measures from a matrix of
+//! dependence measures.
+//! @param dep a symmetric matrix of dependence measures with unit diagonal
+//!   (e.g., computed by `wdm()`).
+//! @param shrinkage regularization parameter in [0, 1]; the partial measures
+//!   are computed from `(1 - shrinkage) * dep + shrinkage * I`. (Adding a
+//!   ridge to the diagonal is equivalent up to scaling, which does not affect
+//!   partial measures.)
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @return the matrix of partial dependence measures, where entry `(i, j)`
+//!   is the dependence between variables `i` and `j` given all others.
+//! @details The partial measures are \f$ -P_{ij} / \sqrt{P_{ii} P_{jj}} \f$,
+//!   where \f$ P \f$ is the inverse (precision matrix) of the regularized
+//!   dependence matrix, computed from its Cholesky decomposition. Throws an
+//!   error if the regularized matrix is not positive definite; increasing
+//!   `shrinkage` helps for ill-conditioned or indefinite matrices (e.g., from
+//!   pairwise removal of missing values).
+inline Eigen::MatrixXd partial_cor(const Eigen::MatrixXd& dep,
+                                   double shrinkage = 0.0,
+                                   size_t num_threads = 1)
+{
+    if (dep.rows() != dep.cols())
+        throw std::runtime_error("dependence matrix must be square.");
+    if (!(shrinkage >= 0.0) || !(shrinkage <= 1.0))
+        throw std::runtime_error("shrinkage must be in [0, 1].");
+    if (!dep.allFinite())
+        throw std::runtime_error("dependence matrix must not contain nan or inf.");
+
+    Eigen::MatrixXd reg = (1 - shrinkage) * dep;
+    reg.diagonal().array() += shrinkage;
+    Eigen::LLT<Eigen::MatrixXd> llt(reg);
+    if (llt.info() != Eigen::Success) {
+        throw std::runtime_error("dependence matrix is not positive definite; "
+                                 "increase shrinkage.");
+    }
+
+    // the solves are not exactly symmetric; use the upper triangle.
+    Eigen::MatrixXd prec = impl::llt_inverse(llt, num_threads);
+    size_t d = dep.rows();
+    Eigen::MatrixXd pcor = Eigen::MatrixXd::Identity(d, d);
+    for (size_t i = 0; i < d; i++) {
+        for (size_t j = i + 1; j < d; j++) {
+            pcor(i, j) = -prec(i, j) / std::sqrt(prec(i, i) * prec(j, j));
+            pcor(j, i) = pcor(i, j);
+        }
+    }
+    return pcor;
+}
+
+//! calculates full-order partial dependence measures.
+//! @param x input data.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing if `true`, all observations containing a `nan` are
+//!    removed (pairwise); otherwise throws an error if `nan`s are present.
+//! @param shrinkage regularization parameter; see `partial_cor()`.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @return the matrix of partial dependence measures; see `partial_cor()`.
+inline Eigen::MatrixXd wdm_partial(const Eigen::MatrixXd& x,
+                                   std::string method,
+                                   Eigen::VectorXd weights = Eigen::VectorXd(),
+                                   bool remove_missing = true,
+                                   double shrinkage = 0.0,
+                                   size_t num_threads = 1)
+{
+    if (!methods::is_symmetric(method))
+        throw std::runtime_error("partial measures require a symmetric method.");
+    Eigen::MatrixXd dep = wdm(x, method, weights, remove_missing, num_threads);
+    // partial_cor() needs a unit diagonal, which Hoeffding's D with ties
+    // does not have.
+    dep.diagonal().setOnes();
+    return partial_cor(dep, shrinkage, num_threads);
+}
+
+//! independence tests for partial dependence measures.
+//! @param pcor a matrix of partial measures (see `partial_cor()`).
+//! @param method the dependence measure used for `pcor`; must be Pearson's
+//!   or Spearman's \f$ \rho \f$.
+//! @param n_eff the effective sample size.
+//! @param alternative the alternative hypothesis; see `Indep_test`.
+//! @return the partial measures with their test statistics and p-values.
+//! @details The statistics are Fisher's z-transforms of the partial
+//!   measures scaled by \f$ \sqrt{n - 3 - k} \f$ (and divided by 1.06 under
+//!   the square root for Spearman's \f$ \rho \f$), where \f$ k = d - 2 \f$ is
+//!   the number of variables conditioned on. Diagonal entries are `nan`.
+inline Partial_tests indep_test_partial_cor(const Eigen::MatrixXd& pcor,
+                                            std::string method,
+                                            double n_eff,
+                                            std::string alternative = "two-sided")
+{
+    if (!methods::is_pearson(method) && !methods::is_spearman(method)) {
+        throw std::runtime_error(
+            "partial tests are only available for Pearson's and Spearman's rho.");
+    }
+    if ((alternative != "two-sided") && (alternative != "less") &&
+        (alternative != "greater"))
+        throw std::runtime_error("alternative not implemented.");
+
+    size_t d = pcor.rows();
+    double df = n_eff - 3 - (static_cast<double>(d) - 2);
+    if (methods::is_spearman(method))
+        df /= 1.06;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    Partial_tests tests;
+    tests.estimates = pcor;
+    tests.statistics = Eigen::MatrixXd::Constant(d, d, nan);
+    tests.p_values = Eigen::MatrixXd::Constant(d, d, nan);
+    tests.n_eff = n_eff;
+    for (size_t i = 0; i < d; i++) {
+        for (size_t j = 0; j < d; j++) {
+            if ((i == j) || !(df > 0))
+                continue;
+            // prevent overflow in atanh
+            double est = std::max(-1 + 1e-12, std::min(1 - 1e-12, pcor(i, j)));
+            double stat = std::atanh(est) * std::sqrt(df);
+            tests.statistics(i, j) = stat;
+            if (alternative == "two-sided") {
+                tests.p_values(i, j) = 2 * utils::normalCDF(-std::abs(stat));
+            } else if (alternative == "less") {
+                tests.p_values(i, j) = utils::normalCDF(stat);
+            } else {
+                tests.p_values(i, j) = 1 - utils::normalCDF(stat);
+            }
+        }
+    }
+    return tests;
+}
+
+//! independence tests for full-order partial dependence measures.
+//! @param x input data.
+//! @param method the dependence measure; must be Pearson's or Spearman's
+//!   \f$ \rho \f$.
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing if `true`, all observations containing a `nan` are
+//!    removed (pairwise); otherwise throws an error if `nan`s are present.
+//! @param alternative the alternative hypothesis; see `Indep_test`.
+//! @param shrinkage regularization parameter; see `partial_cor()`.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @return the partial measures with their test statistics and p-values.
+//!   The effective sample size is computed from the observations without
+//!   missing values.
+inline Partial_tests indep_test_partial(const Eigen::MatrixXd& x,
+                                        std::string method,
+                                        Eigen::VectorXd weights = Eigen::VectorXd(),
+                                        bool remove_missing = true,
+                                        std::string alternative = "two-sided",
+                                        double shrinkage = 0.0,
+                                        size_t num_threads = 1)
+{
+    Eigen::MatrixXd pcor =
+        wdm_partial(x, method, weights, remove_missing, shrinkage, num_threads);
+
+    std::vector<double> w;
+    size_t n = 0;
+    for (Eigen::Index i = 0; i < x.rows(); i++) {
+        if (x.row(i).hasNaN() || ((weights.size() > 0) && std::isnan(weights(i))))
+            continue;
+        n++;
+        if (weights.size() > 0)
+            w.push_back(weights(i));
+    }
+
+    return indep_test_partial_cor(pcor, method,
+                                  utils::effective_sample_size(n, w),
+                                  alternative);
+}
+
+}
@@ -0,0 +1,269 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "../wdm.hpp"
+#include "column_file.hpp"
+#include "parallel.hpp"
+#include "prepare.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+
+namespace wdm {
+
+namespace utils {
+
+//! a first-in first-out queue of limited size connecting the stages of a
+//! pipeline; producers block while it is full (backpressure), consumers
+//! while it is empty.
+template<class T>
+class Bounded_queue {
+public:
+    //! @param capacity the maximal number of items in the queue.
+    explicit Bounded_queue(size_t capacity) :
+        capacity_(std::max(capacity, static_cast<size_t>(1)))
+    {}
+
+    Bounded_queue(const Bounded_queue&) = delete;
+    Bounded_queue& operator=(const Bounded_queue&) = delete;
+
+    //! adds an item; blocks while the queue is full.
+    //! @return `false` if the queue was closed (and the item dropped).
+    bool push(T item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this] {
+                return closed_ || (items_.size() < capacity_);
+            });
+            if (closed_)
+                return false;
+            items_.push_back(std::move(item));
+        }
+        not_empty_.notify_one();
+        return true;
+    }
+
+    //! takes the oldest item; blocks while the queue is empty and open.
+    //! @return `false` if the queue is closed and empty.
+    bool pop(T& item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+            if (items_.empty())
+                return false;
+            item = std::move(items_.front());
+            items_.pop_front();
+        }
+        not_full_.notify_one();
+        return true;
+    }
+
+    //! closes the queue: further pushes fail, pops return the remaining
+    //! items.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    //! the maximal number of items in the queue.
+    size_t capacity() const { return capacity_; }
+
+private:
+    size_t capacity_;
+    std::deque<T> items_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    bool closed_ = false;
+};
+
+}
+
+namespace impl {
+
+//! a block of consecutive columns on its way through the pipeline of
+//! `wdm_file()`.
+struct Column_block {
+    size_t outer;  //!< index of the outer block it is paired with.
+    size_t first;  //!< index of its first column.
+    std::vector<std::vector<double>> columns;
+    std::vector<std::unique_ptr<Prepared_column>> prepared;
+};
+
+//! fills the entries of `ms` for all pairs of columns from two blocks
+//! (or within a block, including the diagonal, if `a` and `b` are the
+//! same).
+inline void compute_block_pair(const Column_block& a,
+                               const Column_block& b,
+                               const std::string& method,
+                               const std::vector<double>& weights,
+                               bool remove_missing,
+                               size_t num_threads,
+                               std::vector<std::vector<double>>& ms)
+{
+    WDM_TRACE_SCOPE("compute block pair", b.first, b.first + b.columns.size());
+    bool symmetric = methods::is_symmetric(method);
+    bool same = (&a == &b);
+    utils::parallel_for(0, a.columns.size(), [&] (size_t k) {
+        size_t i = a.first + k;
+        if (same) {
+            ms[i][i] = methods::has_unit_diagonal(method) ? 1.0 :
+                wdm_prepared(*a.prepared[k], *a.prepared[k], method, weights,
+                             remove_missing);
+        }
+        for (size_t l = same ? k + 1 : 0; l < b.columns.size(); l++) {
+            size_t j = b.first + l;
+            ms[i][j] = wdm_prepared(*a.prepared[k], *b.prepared[l], method,
+                                    weights, remove_missing);
+            if (symmetric)
+                ms[j][i] = ms[i][j];
+            else
+                ms[j][i] = wdm_prepared(*b.prepared[l], *a.prepared[k], method,
+                                        weights, remove_missing);
+        }
+    }, num_threads);
+}
+
+}
+
+//! calculates a matrix of (weighted) dependence measures for the variables
+//! in a column file without loading all of them into memory.
+//! @param path a file in the binary column format (see `io`); its weights
+//!   are used if it has any.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param remove_missing if `true`, all observations containing a `nan` are
+//!    removed (pairwise); otherwise throws an error if `nan`s are present.
+//! @param block_size the number of columns read and prepared at once.
+//! @param num_threads the number of threads for the pairwise computations;
+//!   `0` uses all cores.
+//! @param queue_size the number of blocks that may wait between two stages.
+//! @return the `d x d` matrix of dependence measures (as a vector of rows);
+//!   entry `[i][j]` is the measure between columns `i` (as `x`) and `j` (as
+//!   `y`). The diagonal is as for the matrix version of `wdm()`.
+//! @details The columns are split into blocks, and for every outer block,
+//!   it and all later blocks are streamed through three stages that run
+//!   concurrently:
+//!     1. a thread reads blocks from the memory-mapped file
+//!        (`io::Mapped_column_file`),
+//!     2. a thread prepares their columns (ranks, sorting orders, medians;
+//!        see `impl::Prepared_column`),
+//!     3. the calling thread (with `num_threads` threads) computes the pairs
+//!        between the outer block and the streamed block.
+//!
+//!   The stages are connected by queues holding at most `queue_size`
+//!   blocks, so reading and preparing run ahead of the computations but
+//!   never more than that; at most `2 * queue_size + 4` blocks are in
+//!   memory at once. Errors in any stage stop the pipeline and are rethrown.
+inline std::vector<std::vector<double>> wdm_file(const std::string& path,
+                                                 std::string method,
+                                                 bool remove_missing = true,
+                                                 size_t block_size = 64,
+                                                 size_t num_threads = 1,
+                                                 size_t queue_size = 2)
+{
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    if (block_size == 0)
+        throw std::runtime_error("block_size must be positive.");
+    io::Mapped_column_file file(path);
+    size_t d = file.header().d;
+    if (d < 2)
+        throw std::runtime_error("the file must contain at least 2 columns.");
+    std::vector<double> weights = file.read_weights();
+    size_t num_blocks = (d + block_size - 1) / block_size;
+
+    typedef std::unique_ptr<impl::Column_block> Block;
+    utils::Bounded_queue<Block> read(queue_size), prepared(queue_size);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto fail = [&] {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+        read.close();
+        prepared.close();
+    };
+
+    std::thread reader([&] {
+        try {
+            for (size_t outer = 0; outer < num_blocks; outer++) {
+                for (size_t b = outer; b < num_blocks; b++) {
+                    Block block(new impl::Column_block);
+                    block->outer = outer;
+                    block->first = b * block_size;
+                    {
+                        WDM_TRACE_SCOPE("read block", block->first,
+                                        std::min(block->first + block_size, d));
+                        block->columns = file.read_columns(block->first, block_size);
+                    }
+                    if (!read.push(std::move(block)))
+                        return;
+                }
+            }
+            read.close();
+        } catch (...) {
+            fail();
+        }
+    });
+
+    std::thread preparer([&] {
+        try {
+            Block block;
+            while (read.pop(block)) {
+                {
+                    WDM_TRACE_SCOPE("prepare block", block->first,
+                                    block->first + block->columns.size());
+                    for (const auto& col : block->columns) {
+                        block->prepared.emplace_back(
+                            new impl::Prepared_column(col, method, weights));
+                    }
+                }
+                if (!prepared.push(std::move(block)))
+                    return;
+            }
+            prepared.close();
+        } catch (...) {
+            fail();
+        }
+    });
+
+    std::vector<std::vector<double>> ms(d, std::vector<double>(d, 0.0));
+    try {
+        // every outer block arrives first in its own stream.
+        Block outer, block;
+        while (prepared.pop(block)) {
+            if (block->first == block->outer * block_size) {
+                outer = std::move(block);
+                impl::compute_block_pair(*outer, *outer, method, weights,
+                                         remove_missing, num_threads, ms);
+            } else {
+                impl::compute_block_pair(*outer, *block, method, weights,
+                                         remove_missing, num_threads, ms);
+            }
+        }
+    } catch (...) {
+        fail();
+    }
+    reader.join();
+    preparer.join();
+    if (error)
+        std::rethrow_exception(error);
+
+    return ms;
+}
+
+}
@@ -0,0 +1,208 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "../wdm.hpp"
+#include "ktau.hpp"
+#include "nan_handling.hpp"
+#include "ranks.hpp"
+#include "utils.hpp"
+#include <cmath>
+
+namespace wdm {
+
+namespace impl {
+
+//! a variable prepared for computing dependence measures with many other
+//! variables.
+//!
+//! The work that only depends on a single variable is done once:
+//!   - Pearson's \f$ \rho \f$: centering and the variance,
+//!   - Spearman's \f$ \rho \f$: ranks, then as for Pearson's \f$ \rho \f$,
+//!   - Kendall's \f$ \tau \f$: the sorting order and tie statistics,
+//!   - Blomqvist's \f$ \beta \f$: the median.
+//!
+//! Variables with missing values, too few observations, or methods without
+//! a shared part are not prepared; `wdm_prepared()` then falls back to
+//! `wdm()`.
+class Prepared_column {
+public:
+    //! @param x input data; only a view is kept, so the data must outlive
+    //!   the object (vectors convert implicitly).
+    //! @param method the dependence measure.
+    //! @param weights an optional vector of weights for the data.
+    Prepared_column(utils::Strided_view x,
+                    const std::string& method,
+                    const std::vector<double>& weights) :
+        x_(x),
+        prepared_(false)
+    {
+        if ((weights.size() > 0) && (weights.size() != x.size()))
+            throw std::runtime_error("x and weights must have the same size.");
+        if (utils::any_nan(x) || utils::any_nan(weights) ||
+            (x.size() < methods::get_min_nobs(method)))
+            return;
+
+        if (methods::is_pearson(method)) {
+            center(x.to_vector(), weights);
+        } else if (methods::is_spearman(method)) {
+            center(rank0(x.to_vector(), weights, "average"), weights);
+        } else if (methods::is_kendall(method)) {
+            order_ = utils::get_order(x);
+            std::vector<double> xs(x.size()), ws(weights.size());
+            for (size_t i = 0; i < x.size(); i++) {
+                xs[i] = x[order_[i]];
+                if (weights.size() > 0)
+                    ws[i] = weights[order_[i]];
+            }
+            ties_ = margin_ties_sorted(xs, ws);
+        } else if (methods::is_blomqvist(method)) {
+            median_ = median(x.to_vector(), weights);
+        } else {
+            return;
+        }
+        prepared_ = true;
+    }
+
+    //! whether the shared part has been computed.
+    bool prepared() const { return prepared_; }
+
+    //! the original data.
+    const utils::Strided_view& data() const { return x_; }
+
+    //! centered data (Pearson and Spearman).
+    const std::vector<double>& centered() const { return centered_; }
+
+    //! the (weighted) sum of squares of the centered data.
+    double variance() const { return variance_; }
+
+    //! the permutation that brings the data into ascending order (Kendall).
+    const std::vector<size_t>& order() const { return order_; }
+
+    //! tie statistics for the test (Kendall).
+    const Margin_ties& ties() const { return ties_; }
+
+    //! the (weighted) median (Blomqvist).
+    double median_value() const { return median_; }
+
+private:
+    //! same steps as in `prho()`, so that results agree.
+    void center(std::vector<double> x, const std::vector<double>& weights)
+    {
+        size_t n = x.size();
+        auto w = [&] (size_t i) {
+            return (weights.size() > 0) ? weights[i] : 1.0;
+        };
+
+        size_t first = 0;
+        while ((first < n) && (w(first) == 0.0))
+            first++;
+        if (first < n) {
+            double x_0 = x[first];
+            for (size_t i = 0; i < n; i++)
+                x[i] -= x_0;
+        }
+
+        auto sums = utils::reduce_sums<2>(n, [&] (size_t i) {
+            return std::array<double, 2>{{x[i] * w(i), w(i)}};
+        });
+        double mu = sums[0] / sums[1];
+
+        for (size_t i = 0; i < n; i++)
+            x[i] -= mu;
+        variance_ = utils::reduce_sum(n, [&] (size_t i) {
+            return x[i] * x[i] * w(i);
+        });
+        centered_ = std::move(x);
+    }
+
+    utils::Strided_view x_;
+    bool prepared_;
+    std::vector<double> centered_;
+    double variance_;
+    std::vector<size_t> order_;
+    Margin_ties ties_;
+    double median_;
+};
+
+//! calculates a dependence measure from two prepared variables.
+//! @param x, y prepared variables (see `Prepared_column`); `x` and `y` must
+//!   be prepared for `method` and the same `weights`.
+//! @param method the dependence measure.
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing see `wdm()`.
+inline double wdm_prepared(const Prepared_column& x,
+                           const Prepared_column& y,
+                           const std::string& method,
+                           const std::vector<double>& weights,
+                           bool remove_missing)
+{
+    if (!x.prepared() || !y.prepared()) {
+        return wdm(x.data().to_vector(), y.data().to_vector(), method, weights,
+                   remove_missing);
+    }
+
+    size_t n = x.data().size();
+    auto w = [&] (size_t i) {
+        return (weights.size() > 0) ? weights[i] : 1.0;
+    };
+
+    if (methods::is_pearson(method) || methods::is_spearman(method)) {
+        const std::vector<double>& xc = x.centered();
+        const std::vector<double>& yc = y.centered();
+        double cov = utils::reduce_sum(n, [&] (size_t i) {
+            return xc[i] * yc[i] * w(i);
+        });
+        return cov / (std::sqrt(x.variance()) * std::sqrt(y.variance()));
+    }
+
+    if (methods::is_kendall(method)) {
+        // the order of x only needs ties to be broken according to y.
+        std::vector<size_t> perm = x.order();
+        const utils::Strided_view& xd = x.data();
+        const utils::Strided_view& yd = y.data();
+        for (size_t i = 0, reps; i < n; i += reps) {
+            reps = 1;
+            while ((i + reps < n) && (xd[perm[i]] == xd[perm[i + reps]]))
+                reps++;
+            if (reps > 1) {
+                std::sort(perm.begin() + i, perm.begin() + i + reps,
+                          [&] (size_t a, size_t b) { return yd[a] < yd[b]; });
+            }
+        }
+        std::vector<double> xx(n), yy(n), ww(weights.size());
+        for (size_t i = 0; i < n; i++) {
+            xx[i] = xd[perm[i]];
+            yy[i] = yd[perm[i]];
+            if (weights.size() > 0)
+                ww[i] = weights[perm[i]];
+        }
+        return ktau_sorted(xx, std::move(yy), std::move(ww));
+    }
+
+    if (methods::is_blomqvist(method)) {
+        const utils::Strided_view& xd = x.data();
+        const utils::Strided_view& yd = y.data();
+        double med_x = x.median_value(), med_y = y.median_value();
+        double w_acc = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            if ((xd[i] <= med_x) && (yd[i] <= med_y))
+                w_acc += w(i);
+            else if ((xd[i] > med_x) && (yd[i] > med_y))
+                w_acc += w(i);
+        }
+        double w_sum = (weights.size() > 0) ? utils::sum(weights) : n;
+        return 2 * w_acc / w_sum - 1;
+    }
+
+    return wdm(x.data().to_vector(), y.data().to_vector(), method, weights,
+               remove_missing);
+}
+
+}
+
+}
@@ -13,44 +13,80 @@ namespace wdm {
 
 namespace impl {
     
-//! fast calculation of the weighted Pearson's correlation.
-//! @param x, y input data.
-//! @param weights an optional vector of weights for the data.
-inline double prho(std::vector<double> x,
-                   std::vector<double> y,
-                   std::vector<double> weights = std::vector<double>())
+//! weighted Pearson's correlation of data given by accessors.
+//! @param n the number of observations.
+//! @param x, y, w functions returning the `i`th value of x, y, and the
+//!   weights.
+template<class X, class Y, class W>
+inline double prho(size_t n, const X& x, const Y& y, const W& w)
 {
-    utils::check_sizes(x, y, weights);
-    size_t n = x.size();
-    if (weights.size() == 0)
-        weights = std::vector<double>(x.size(), 1.0);
-
-    // calculate means of x and y
-    double mu_x = 0.0, mu_y = 0.0, w_sum = 0.0;
-    for (size_t i = 0; i < n; i++) {
-        mu_x += x[i] * weights[i];
-        mu_y += y[i] * weights[i];
-        w_sum += weights[i];
+    // shift by the first observation with non-zero weight; constant
+    // variables then have exactly zero variance (instead of one polluted by
+    // rounding errors).
+    size_t first = 0;
+    while ((first < n) && (w(first) == 0.0))
+        first++;
+    double x_0 = 0.0, y_0 = 0.0;
+    if (first < n) {
+        x_0 = x(first);
+        y_0 = y(first);
     }
-    mu_x /= w_sum;
-    mu_y /= w_sum;
 
-    // substract mean from x and y
-    for (size_t i = 0; i < n; i++) {
-        x[i] -= mu_x;
-        y[i] -= mu_y;
-    }
+    // calculate means of x and y (the sums are compensated and do not
+    // depend on the number of threads; see reduce.hpp)
+    auto sums = utils::reduce_sums<3>(n, [&] (size_t i) {
+        return std::array<double, 3>{{(x(i) - x_0) * w(i),
+                                      (y(i) - y_0) * w(i),
+                                      w(i)}};
+    });
+    double mu_x = sums[0] / sums[2], mu_y = sums[1] / sums[2];
 
-    // compute variances and covariance
-    double v_x = 0.0, v_y = 0.0, cov = 0.0;
-    for (size_t i = 0; i < n; i++) {
-        v_x += x[i] * x[i] * weights[i];
-        v_y += y[i] * y[i] * weights[i];
-        cov += x[i] * y[i] * weights[i];
-    }
+    // compute variances and covariance of the centered data
+    auto moments = utils::reduce_sums<3>(n, [&] (size_t i) {
+        double xc = (x(i) - x_0) - mu_x, yc = (y(i) - y_0) - mu_y;
+        return std::array<double, 3>{{xc * xc * w(i),
+                                      yc * yc * w(i),
+                                      xc * yc * w(i)}};
+    });
+    double v_x = moments[0], v_y = moments[1], cov = moments[2];
 
     // compute correlation
-    return cov / std::sqrt(v_x * v_y);
+    // (taking square roots separately avoids overflow and underflow)
+    return cov / (std::sqrt(v_x) * std::sqrt(v_y));
+}
+
+//! fast calculation of the weighted Pearson's correlation.
+//! @param x, y input data.
+//! @param weights an optional vector of weights for the data.
+inline double prho(const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   const std::vector<double>& weights = std::vector<double>())
+{
+    utils::check_sizes(x, y, weights);
+    return prho(x.size(),
+                [&] (size_t i) { return x[i]; },
+                [&] (size_t i) { return y[i]; },
+                [&] (size_t i) {
+                    return (weights.size() > 0) ? weights[i] : 1.0;
+                });
+}
+
+//! weighted Pearson's correlation of strided data (read without copying).
+//! @param x, y input data.
+//! @param weights weights for the data (may be empty).
+inline double prho(const utils::Strided_view& x,
+                   const utils::Strided_view& y,
+                   const utils::Strided_view& weights)
+{
+    if ((y.size() != x.size()) ||
+        ((weights.size() > 0) && (weights.size() != x.size())))
+        throw std::runtime_error("x, y, and weights must have the same size.");
+    return prho(x.size(),
+                [&] (size_t i) { return x[i]; },
+                [&] (size_t i) { return y[i]; },
+                [&] (size_t i) {
+                    return (weights.size() > 0) ? weights[i] : 1.0;
+                });
 }
 
 }
@@ -102,11 +102,9 @@ rank(std::vector<double> x,
             }
         } else if (ties_method == "average") {
             // assign average rank to tied values
-            std::vector<double> ww(reps);
-            for (size_t k = 0; k < reps; ++k)
-                ww[k] = weights[perm[i + k]];
+            double w_shift = (w_batch - weights[perm[i]]) / 2;
             for (size_t k = 0; k < reps; ++k)
-                x[perm[i + k]] += (utils::sum(ww) - weights[perm[i]]) / 2;
+                x[perm[i + k]] += w_shift;
         }
     }
 
@@ -159,78 +157,159 @@ inline std::vector<double> rank0(
         // accumulate weights for current batch
         w_acc += w_batch;
 
-        // assign average rank to tied values
-        if ((ties_method == "average") && (reps > 1)) {
+        // assign average rank to tied values (if they carry any weight)
+        if ((ties_method == "average") && (reps > 1) && (w_batch > 0)) {
             std::vector<double> ww(reps);
             for (size_t k = 0; k < reps; ++k)
                 ww[k] = weights[perm[i + k]];
+            double w_shift = utils::perm_sum(ww, 2) / w_batch;
             for (size_t k = 0; k < reps; ++k)
-                x[perm[i + k]] += utils::perm_sum(ww, 2) / w_batch;
+                x[perm[i + k]] += w_shift;
         }
     }
 
     return x;
 }
 
-//! computes the bivariate rank of a pair of vectors (starting at 0).
+//! computes bivariate ranks of a pair of vectors for several sets of
+//! weights at once (sharing the sorting work).
 //! @param x first input vector.
 //! @param y second input vecotr.
-//! @param weights (optional), weights for each observation.
-inline std::vector<double>
-bivariate_rank(std::vector<double> x,
-               std::vector<double> y,
-               std::vector<double> weights = std::vector<double>())
+//! @param weights sets of weights for each observation (a set can be empty
+//!   for unweighted ranks).
+//! @return for each set of weights, the ranks as in `bivariate_rank()`.
+inline std::vector<std::vector<double>>
+bivariate_rank(const std::vector<double>& x,
+               const std::vector<double>& y,
+               const std::vector<std::vector<double>>& weights)
 {
-    utils::check_sizes(x, y, weights);
-
-    // get inverse of permutation that brings x in ascending order
-    std::vector<size_t> perm_x = utils::get_order(x);
+    size_t n = x.size();
+    for (const auto& w : weights)
+        utils::check_sizes(x, y, w);
+
+    // permutation that brings x in ascending order, breaking ties by y and
+    // then by position (so that every observation has a unique place).
+    std::vector<size_t> perm_x(n);
+    for (size_t i = 0; i < n; i++)
+        perm_x[i] = i;
+    std::sort(perm_x.begin(), perm_x.end(), [&] (size_t i, size_t j) {
+        if (x[i] != x[j])
+            return x[i] < x[j];
+        if (y[i] != y[j])
+            return y[i] < y[j];
+        return i < j;
+    });
+
+    // sort y accordingly
+    std::vector<double> y_sorted(n);
+    for (size_t i = 0; i < n; i++)
+        y_sorted[i] = y[perm_x[i]];
+
+    // permutation that brings y in descending order; the merge sort below
+    // puts tied elements in reverse order, which we mimic by breaking ties
+    // by descending position.
+    std::vector<size_t> perm_y(n);
+    for (size_t i = 0; i < n; i++)
+        perm_y[i] = i;
+    std::sort(perm_y.begin(), perm_y.end(), [&] (size_t i, size_t j) {
+        if (y_sorted[i] != y_sorted[j])
+            return y_sorted[i] > y_sorted[j];
+        return i > j;
+    });
     perm_x = utils::invert_permutation(perm_x);
-
-    // sort x, y, and weights according to x, breaking ties with y
-    utils::sort_all(x, y, weights);
-
-    // get inverse of permutation that brings y in descending order
-    std::vector<size_t> perm_y = utils::get_order(y, false);
     perm_y = utils::invert_permutation(perm_y);
 
-    // sort y in descending order counting inversions
-    std::vector<double> counts(y.size(), 0.0);
-    utils::merge_sort_count_per_element(y, weights, counts);
+    std::vector<std::vector<double>> ranks(weights.size());
+    for (size_t k = 0; k < weights.size(); k++) {
+        // sort y in descending order counting inversions
+        std::vector<double> yy = y_sorted, ww(weights[k].size());
+        for (size_t i = 0; i < ww.size(); i++)
+            ww[perm_x[i]] = weights[k][i];
+        std::vector<double> counts(n, 0.0);
+        utils::merge_sort_count_per_element(yy, ww, counts);
+
+        // bring counts back in original order
+        ranks[k].resize(n);
+        for (size_t i = 0; i < n; i++)
+            ranks[k][i] = counts[perm_y[perm_x[i]]];
+    }
 
-    // bring counts back in original order
-    std::vector<double> counts_tmp = counts;
-    for (size_t i = 0; i < counts.size(); i++)
-        counts[i] = counts_tmp[perm_y[perm_x[i]]];
+    return ranks;
+}
 
-    return counts;
+//! computes the bivariate rank of a pair of vectors (starting at 0).
+//! @param x first input vector.
+//! @param y second input vecotr.
+//! @param weights (optional), weights for each observation.
+inline std::vector<double>
+bivariate_rank(const std::vector<double>& x,
+               const std::vector<double>& y,
+               const std::vector<double>& weights = std::vector<double>())
+{
+    utils::check_sizes(x, y, weights);
+    return bivariate_rank(x, y, std::vector<std::vector<double>>{weights})[0];
 }
 
-//! computes the (weighted) median of a vector.
-//! @param x the input vector.
-inline double
-median(const std::vector<double>& x,
-       std::vector<double> weights = std::vector<double>())
+//! computes average ranks (see `rank0()`) of data sorted in ascending
+//! order in linear time.
+//! @param x sorted input vector.
+//! @param weights (optional), weights for each observation (in the same
+//!   order).
+inline std::vector<double> rank0_sorted(const std::vector<double>& x,
+                                        const std::vector<double>& weights)
 {
-    utils::check_sizes(x, x, weights);
     size_t n = x.size();
+    auto w = [&] (size_t i) {
+        return (weights.size() > 0) ? weights[i] : 1.0;
+    };
+    std::vector<double> ranks(n);
+    double w_acc = 0.0;
+    for (size_t i = 0, reps; i < n; i += reps) {
+        reps = 0;
+        double w_batch = 0.0;
+        while ((i + reps < n) && (x[i] == x[i + reps]))
+            w_batch += w(i + reps++);
+        double w_shift = 0.0;
+        if ((reps > 1) && (w_batch > 0)) {
+            std::vector<double> ww(reps);
+            for (size_t k = 0; k < reps; ++k)
+                ww[k] = w(i + k);
+            w_shift = utils::perm_sum(ww, 2) / w_batch;
+        }
+        for (size_t k = 0; k < reps; ++k)
+            ranks[i + k] = w_acc + w_shift;
+        w_acc += w_batch;
+    }
+    return ranks;
+}
 
-    // sort x and weights in x order
-    auto perm = utils::get_order(x);
-    auto xx = x;
-    auto w = weights;
-    for (size_t i = 0; i < n; i++) {
-        xx[i] = x[perm[i]];
-        if (w.size() > 0)
-            w[i] = weights[perm[i]];
+//! computes the (weighted) median of data sorted in ascending order in
+//! linear time.
+//! @param x sorted input vector.
+//! @param weights (optional), weights for each observation (in the same
+//!   order).
+inline double median_sorted(const std::vector<double>& x,
+                            const std::vector<double>& weights)
+{
+    // observations with zero weight do not affect the median
+    std::vector<double> xx, w;
+    for (size_t i = 0; i < x.size(); i++) {
+        if ((weights.size() == 0) || (weights[i] > 0)) {
+            xx.push_back(x[i]);
+            if (weights.size() > 0)
+                w.push_back(weights[i]);
+        }
     }
+    size_t n = xx.size();
+    if (n == 0)
+        return std::numeric_limits<double>::quiet_NaN();
 
     // compute weighted ranks and the "average rank" (corresponds to the
     // median)
-    auto ranks = rank0(xx, w, "average");
-    if (weights.size() == 0)
-        weights = std::vector<double>(n, 1.0);
-    double rank_avrg = utils::perm_sum(weights, 2) / utils::sum(weights);
+    auto ranks = rank0_sorted(xx, w);
+    if (w.size() == 0)
+        w = std::vector<double>(n, 1.0);
+    double rank_avrg = utils::perm_sum(w, 2) / utils::sum(w);
 
     // weighted median splits data below and above rank_avrg
     size_t i = 0;
@@ -241,5 +320,38 @@ median(const std::vector<double>& x,
     else
         return 0.5 * (xx[i - 1] + xx[i]);
 }
+
+//! computes the (weighted) median of a vector.
+//! @param x the input vector.
+inline double
+median(const std::vector<double>& x,
+       std::vector<double> weights = std::vector<double>())
+{
+    utils::check_sizes(x, x, weights);
+
+    // observations with zero weight do not affect the median
+    std::vector<double> x_pos, w_pos;
+    for (size_t i = 0; i < x.size(); i++) {
+        if ((weights.size() == 0) || (weights[i] > 0)) {
+            x_pos.push_back(x[i]);
+            if (weights.size() > 0)
+                w_pos.push_back(weights[i]);
+        }
+    }
+    size_t n = x_pos.size();
+    if (n == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    // sort x and weights in x order
+    auto perm = utils::get_order(x_pos);
+    auto xx = x_pos;
+    auto w = w_pos;
+    for (size_t i = 0; i < n; i++) {
+        xx[i] = x_pos[perm[i]];
+        if (w.size() > 0)
+            w[i] = w_pos[perm[i]];
+    }
+    return median_sorted(xx, w);
+}
 }
 }
@@ -0,0 +1,116 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace wdm {
+
+namespace utils {
+
+//! number of terms in a chunk of a reduction; chunks are the unit of work
+//! for parallel reductions (see `parallel_reduce_sums()`).
+const size_t reduce_chunk_size = 1024;
+
+//! number of independent accumulators within a chunk; they are updated in
+//! lock step, which lets the compiler vectorize the compensated summation.
+const size_t reduce_lanes = 4;
+static_assert(reduce_lanes == 4, "chunk_sums() adds exactly four lanes.");
+
+//! compensated (Kahan) sums of `f(i)` for `i` in `[begin, end)`.
+//! @param f a function taking an index and returning `K` terms as a
+//!   `std::array<double, K>`.
+//! @details Term `i` goes to accumulator `(i - begin) % reduce_lanes`; the
+//!   accumulators are added pairwise. Each of the `K` sums only depends on
+//!   `begin`, `end`, and its own terms.
+template<size_t K, class F>
+inline std::array<double, K> chunk_sums(size_t begin, size_t end, F f)
+{
+    double s[K][reduce_lanes] = {}, c[K][reduce_lanes] = {};
+    auto add = [&] (size_t i, size_t l) {
+        std::array<double, K> terms = f(i);
+        for (size_t k = 0; k < K; k++) {
+            double y = terms[k] - c[k][l];
+            double t = s[k][l] + y;
+            c[k][l] = (t - s[k][l]) - y;
+            s[k][l] = t;
+        }
+    };
+    size_t i = begin;
+    for (; i + reduce_lanes <= end; i += reduce_lanes) {
+        for (size_t l = 0; l < reduce_lanes; l++)
+            add(i + l, l);
+    }
+    for (size_t l = 0; i < end; i++, l++)
+        add(i, l);
+
+    std::array<double, K> sums;
+    for (size_t k = 0; k < K; k++) {
+        for (size_t l = 0; l < reduce_lanes; l++)
+            s[k][l] -= c[k][l];
+        sums[k] = (s[k][0] + s[k][1]) + (s[k][2] + s[k][3]);
+    }
+    return sums;
+}
+
+//! adds partial sums along a fixed binary tree.
+//! @param sums the partial sums (overwritten).
+template<size_t K>
+inline std::array<double, K> combine_sums(std::vector<std::array<double, K>>& sums)
+{
+    std::array<double, K> total = {};
+    if (sums.size() == 0)
+        return total;
+    for (size_t stride = 1; stride < sums.size(); stride *= 2) {
+        for (size_t i = 0; i + stride < sums.size(); i += 2 * stride) {
+            for (size_t k = 0; k < K; k++)
+                sums[i][k] += sums[i + stride][k];
+        }
+    }
+    return sums[0];
+}
+
+//! deterministic sums of `f(i)` for `i` in `[0, n)`.
+//! @param n the number of terms.
+//! @param f a function taking an index and returning `K` terms as a
+//!   `std::array<double, K>`.
+//! @details The terms are split into chunks of `reduce_chunk_size`, each
+//!   summed by `chunk_sums()`, and the chunk sums are combined by
+//!   `combine_sums()`. The shape of the computation only depends on `n`, so
+//!   the result is bitwise identical to `parallel_reduce_sums()` for any
+//!   number of threads (and to computing the sums separately). The error is
+//!   of order \f$ \epsilon \log_2(n / 1024) \f$ times the sum of absolute
+//!   terms.
+template<size_t K, class F>
+inline std::array<double, K> reduce_sums(size_t n, F f)
+{
+    if (n <= reduce_chunk_size)
+        return chunk_sums<K>(0, n, f);
+    std::vector<std::array<double, K>> sums(
+        (n + reduce_chunk_size - 1) / reduce_chunk_size);
+    for (size_t j = 0; j < sums.size(); j++) {
+        size_t begin = j * reduce_chunk_size;
+        sums[j] = chunk_sums<K>(begin, std::min(begin + reduce_chunk_size, n), f);
+    }
+    return combine_sums(sums);
+}
+
+//! deterministic sum of `f(i)` for `i` in `[0, n)`; see `reduce_sums()`.
+template<class F>
+inline double reduce_sum(size_t n, F f)
+{
+    return reduce_sums<1>(n, [&] (size_t i) {
+        return std::array<double, 1>{{f(i)}};
+    })[0];
+}
+
+}
+
+}
@@ -0,0 +1,277 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "../wdm.hpp"
+#include "ktau.hpp"
+#include "nan_handling.hpp"
+#include "prho.hpp"
+#include "ranks.hpp"
+#include "utils.hpp"
+
+namespace wdm {
+
+//! a variable with many zeros, stored as its non-zero entries.
+struct Sparse_column {
+    size_t n = 0;                //!< the number of observations.
+    std::vector<size_t> indices; //!< indices of non-zero entries (ascending).
+    std::vector<double> values;  //!< the non-zero entries.
+};
+
+//! converts a vector to a sparse column.
+//! @param x input data; `nan`s are stored as non-zero entries.
+inline Sparse_column make_sparse(const std::vector<double>& x)
+{
+    Sparse_column sx;
+    sx.n = x.size();
+    for (size_t i = 0; i < x.size(); i++) {
+        if (x[i] != 0.0) {
+            sx.indices.push_back(i);
+            sx.values.push_back(x[i]);
+        }
+    }
+    return sx;
+}
+
+//! converts a sparse column to a vector.
+inline std::vector<double> make_dense(const Sparse_column& x)
+{
+    std::vector<double> dense(x.n, 0.0);
+    for (size_t k = 0; k < x.indices.size(); k++)
+        dense[x.indices[k]] = x.values[k];
+    return dense;
+}
+
+namespace impl {
+
+//! a sample in which all observations that are zero in both variables are
+//! collapsed into a single observation carrying their total weight.
+//!
+//! Every point also carries its sum of squared weights, which rank-based
+//! measures need to average over tied observations.
+struct Collapsed_sample {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> weights;
+    std::vector<double> squares;
+};
+
+inline void check_sparse(const Sparse_column& x)
+{
+    if (x.indices.size() != x.values.size())
+        throw std::runtime_error("indices and values must have the same size.");
+    for (size_t k = 0; k < x.indices.size(); k++) {
+        if ((x.indices[k] >= x.n) || ((k > 0) && (x.indices[k] <= x.indices[k - 1])))
+            throw std::runtime_error("indices must be increasing and less than n.");
+    }
+}
+
+inline bool any_nan(const Sparse_column& x)
+{
+    return utils::any_nan(x.values);
+}
+
+//! collapses the zeros of two sparse columns.
+//! @param x, y sparse columns (of the same size).
+//! @param weights an optional vector of weights for the data.
+//! @param margin_x if `true`, only the zeros of `x` are collapsed (and `y`
+//!   is ignored).
+inline Collapsed_sample collapse(const Sparse_column& x,
+                                 const Sparse_column& y,
+                                 const std::vector<double>& weights,
+                                 bool margin_x = false)
+{
+    Collapsed_sample s;
+    std::vector<size_t> indices;
+    auto w = [&] (size_t i) {
+        return (weights.size() > 0) ? weights[i] : 1.0;
+    };
+    auto add = [&] (size_t i, double xi, double yi) {
+        indices.push_back(i);
+        s.x.push_back(xi);
+        s.y.push_back(yi);
+        s.weights.push_back(w(i));
+        s.squares.push_back(w(i) * w(i));
+    };
+
+    // merge the non-zero indices of both variables
+    size_t kx = 0, ky = 0, ny = margin_x ? 0 : y.indices.size();
+    while ((kx < x.indices.size()) || (ky < ny)) {
+        if ((ky == ny) ||
+            ((kx < x.indices.size()) && (x.indices[kx] < y.indices[ky]))) {
+            add(x.indices[kx], x.values[kx], 0.0);
+            kx++;
+        } else if ((kx == x.indices.size()) || (y.indices[ky] < x.indices[kx])) {
+            add(y.indices[ky], 0.0, y.values[ky]);
+            ky++;
+        } else {
+            add(x.indices[kx], x.values[kx], y.values[ky]);
+            kx++;
+            ky++;
+        }
+    }
+
+    // the remaining observations are zero in both variables
+    size_t zeros = x.n - s.x.size();
+    if (zeros > 0) {
+        double w_zeros = 0.0, w2_zeros = 0.0;
+        if (weights.size() == 0) {
+            w_zeros = w2_zeros = static_cast<double>(zeros);
+        } else {
+            for (size_t i = 0, k = 0; i < x.n; i++) {
+                if ((k < indices.size()) && (indices[k] == i)) {
+                    k++;
+                    continue;
+                }
+                w_zeros += weights[i];
+                w2_zeros += weights[i] * weights[i];
+            }
+        }
+        s.x.push_back(0.0);
+        s.y.push_back(0.0);
+        s.weights.push_back(w_zeros);
+        s.squares.push_back(w2_zeros);
+    }
+
+    return s;
+}
+
+//! average ranks (see `rank0()`) of the original observations behind a
+//! collapsed sample.
+//! @param x values of the collapsed sample.
+//! @param weights, squares total and squared weights of each point.
+inline std::vector<double> collapsed_rank(const std::vector<double>& x,
+                                          const std::vector<double>& weights,
+                                          const std::vector<double>& squares)
+{
+    size_t n = x.size();
+    std::vector<size_t> perm = utils::get_order(x);
+    std::vector<double> ranks(n);
+    double w_acc = 0.0;
+    for (size_t i = 0, reps; i < n; i += reps) {
+        double w_batch = 0.0, w2_batch = 0.0;
+        reps = 0;
+        while ((i + reps < n) && (x[perm[i]] == x[perm[i + reps]])) {
+            w_batch += weights[perm[i + reps]];
+            w2_batch += squares[perm[i + reps++]];
+        }
+        // the average over tied observations, as in rank0()
+        double rank = w_acc;
+        if (w_batch > 0)
+            rank += (w_batch * w_batch - w2_batch) / 2 / w_batch;
+        for (size_t k = 0; k < reps; k++)
+            ranks[perm[i + k]] = rank;
+        w_acc += w_batch;
+    }
+    return ranks;
+}
+
+//! weighted median (see `median()`) of the original observations behind a
+//! collapsed sample.
+inline double collapsed_median(const std::vector<double>& x,
+                               const std::vector<double>& weights,
+                               const std::vector<double>& squares)
+{
+    // observations with zero weight do not affect the median
+    std::vector<double> xx, ww, qq;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (weights[i] > 0) {
+            xx.push_back(x[i]);
+            ww.push_back(weights[i]);
+            qq.push_back(squares[i]);
+        }
+    }
+    if (xx.size() == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    std::vector<double> ranks = collapsed_rank(xx, ww, qq);
+    std::vector<size_t> perm = utils::get_order(xx);
+    double w_sum = utils::sum(ww);
+    double rank_avrg = (w_sum * w_sum - utils::sum(qq)) / 2 / w_sum;
+
+    // weighted median splits data below and above rank_avrg
+    size_t i = 0;
+    while (ranks[perm[i]] < rank_avrg)
+        i++;
+    if (ranks[perm[i]] == rank_avrg)
+        return xx[perm[i]];
+    else
+        return 0.5 * (xx[perm[i - 1]] + xx[perm[i]]);
+}
+
+}
+
+//! calculates (weighted) dependence measures of sparse variables.
+//! @param x, y input data.
+//! @param method the dependence measure; see `wdm()` for possible values.
+//! @param weights an optional vector of weights for the data (of size
+//!   `x.n`).
+//! @param remove_missing if `true`, all observations containing a `nan` are
+//!    removed; otherwise throws an error if `nan`s are present.
+//! @return the dependence measure.
+//! @details Observations that are zero in both variables form a single
+//!   block of ties. For Pearson's and Spearman's \f$ \rho \f$, Kendall's
+//!   \f$ \tau \f$, and Blomqvist's \f$ \beta \f$, the block is collapsed into
+//!   one observation carrying its total weight, so the costs are
+//!   \f$ O(m \log m) \f$, where \f$ m \f$ is the number of non-zeros (plus
+//!   \f$ O(n) \f$ for the totals of the weights). (Kendall's \f$ \tau \f$ is
+//!   unaffected since pairs within the block are tied in both variables;
+//!   ranks and medians account for the block's squared weights.) Other
+//!   methods and data with missing values use the dense computation.
+inline double wdm(const Sparse_column& x,
+                  const Sparse_column& y,
+                  std::string method,
+                  std::vector<double> weights = std::vector<double>(),
+                  bool remove_missing = true)
+{
+    impl::check_sparse(x);
+    impl::check_sparse(y);
+    if (y.n != x.n)
+        throw std::runtime_error("x and y must have the same size.");
+    if ((weights.size() > 0) && (weights.size() != x.n))
+        throw std::runtime_error("x, y, and weights must have the same size.");
+
+    bool sparse_method =
+        methods::is_pearson(method) || methods::is_spearman(method) ||
+        methods::is_kendall(method) || methods::is_blomqvist(method);
+    if (!sparse_method || impl::any_nan(x) || impl::any_nan(y) ||
+        utils::any_nan(weights)) {
+        return wdm(make_dense(x), make_dense(y), method, weights, remove_missing);
+    }
+    if (x.n < methods::get_min_nobs(method)) {
+        if (remove_missing)
+            return std::numeric_limits<double>::quiet_NaN();
+        utils::throw_preproc_error(Status::too_few_observations, method);
+    }
+
+    impl::Collapsed_sample s = impl::collapse(x, y, weights);
+    if (methods::is_pearson(method))
+        return impl::prho(s.x, s.y, s.weights);
+    if (methods::is_kendall(method))
+        return impl::ktau(s.x, s.y, s.weights);
+    if (methods::is_spearman(method)) {
+        return impl::prho(impl::collapsed_rank(s.x, s.weights, s.squares),
+                          impl::collapsed_rank(s.y, s.weights, s.squares),
+                          s.weights);
+    }
+
+    // Blomqvist's beta: the medians are computed from each margin.
+    impl::Collapsed_sample sx = impl::collapse(x, x, weights, true);
+    impl::Collapsed_sample sy = impl::collapse(y, y, weights, true);
+    double med_x = impl::collapsed_median(sx.x, sx.weights, sx.squares);
+    double med_y = impl::collapsed_median(sy.x, sy.weights, sy.squares);
+    double w_acc = 0.0;
+    for (size_t i = 0; i < s.x.size(); i++) {
+        if ((s.x[i] <= med_x) && (s.y[i] <= med_y))
+            w_acc += s.weights[i];
+        else if ((s.x[i] > med_x) && (s.y[i] > med_y))
+            w_acc += s.weights[i];
+    }
+    return 2 * w_acc / utils::sum(s.weights) - 1;
+}
+
+}
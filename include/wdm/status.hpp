@@ -0,0 +1,67 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+namespace wdm {
+
+//! status codes reported by the non-throwing interface (`try_wdm()`,
+//! `try_indep_test()`).
+enum class Status {
+    ok,                   //!< success.
+    too_few_observations, //!< fewer (complete) observations than required.
+    all_missing,          //!< all observations contain a `nan`.
+    zero_variance,        //!< `x` or `y` is constant.
+    missing_values,       //!< `nan`s present and `remove_missing = false`.
+    size_mismatch,        //!< `x`, `y`, and `weights` differ in size.
+    invalid_method,       //!< unknown dependence measure.
+    invalid_alternative,  //!< unknown or unsupported alternative hypothesis.
+    invalid_weights,      //!< weights not supported by the method.
+    out_of_memory,        //!< memory allocation failed.
+    internal_error        //!< unexpected error in one of the kernels.
+};
+
+//! whether a status indicates degenerate (but valid) input data; in this
+//! case, results are `nan`.
+inline bool is_degenerate(Status status) noexcept
+{
+    return (status == Status::too_few_observations) ||
+           (status == Status::all_missing) ||
+           (status == Status::zero_variance);
+}
+
+//! a human-readable description of a status code.
+inline const char* status_message(Status status) noexcept
+{
+    switch (status) {
+        case Status::ok:
+            return "success.";
+        case Status::too_few_observations:
+            return "not enough observations.";
+        case Status::all_missing:
+            return "all observations contain missing values.";
+        case Status::zero_variance:
+            return "x or y is constant.";
+        case Status::missing_values:
+            return "there are missing values in the data; "
+                   "try remove_missing = TRUE";
+        case Status::size_mismatch:
+            return "x, y, and weights must have the same size.";
+        case Status::invalid_method:
+            return "method not implemented.";
+        case Status::invalid_alternative:
+            return "alternative not implemented.";
+        case Status::invalid_weights:
+            return "Chatterjee's xi is only defined for equal weights.";
+        case Status::out_of_memory:
+            return "memory allocation failed.";
+        case Status::internal_error:
+            return "internal error.";
+    }
+    return "unknown status.";
+}
+
+}
@@ -0,0 +1,264 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef WDM_TRACE
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#endif
+
+// Timelines of parallel computations.
+//
+// If the library is compiled with `WDM_TRACE` defined (e.g., by configuring
+// with `-DENABLE_TRACE=ON`), parallel loops record when each thread worked
+// on which chunk of tasks (see `WDM_TRACE_SCOPE`). Recording runs between
+// `trace_start()` and `trace_stop()`, and `trace_json()` exports the events
+// in the Chrome trace-event format (viewable in `chrome://tracing` or
+// Perfetto). Without `WDM_TRACE`, the trace points compile to nothing, the
+// recorder is not compiled, and the functions below are stubs that give an
+// empty trace; `parallel.hpp` then does not include this header.
+
+#ifdef WDM_TRACE
+#define WDM_TRACE_CONCAT_IMPL(a, b) a##b
+#define WDM_TRACE_CONCAT(a, b) WDM_TRACE_CONCAT_IMPL(a, b)
+//! records the lifetime of the enclosing scope; arguments are a name (a
+//! string literal) and optionally the range `[begin, end)` of tasks it
+//! covers.
+#define WDM_TRACE_SCOPE(...) \
+    ::wdm::impl::Trace_scope WDM_TRACE_CONCAT(wdm_trace_scope_, __LINE__)(__VA_ARGS__)
+#elif !defined(WDM_TRACE_SCOPE)
+#define WDM_TRACE_SCOPE(...)
+#endif
+
+namespace wdm {
+
+#ifdef WDM_TRACE
+
+namespace impl {
+
+//! a completed scope.
+struct Trace_event {
+    const char* name;
+    size_t begin;
+    size_t end;
+    double time;     //!< start in microseconds since `trace_start()`.
+    double duration; //!< in microseconds.
+};
+
+//! the events of a single thread; keeps the most recent `capacity` events.
+class Trace_buffer {
+public:
+    Trace_buffer(size_t thread, size_t capacity) :
+        thread_(thread),
+        events_(capacity),
+        count_(0)
+    {}
+
+    void record(const Trace_event& event)
+    {
+        events_[count_ % events_.size()] = event;
+        count_++;
+    }
+
+    size_t thread() const { return thread_; }
+
+    //! the kept events, oldest first.
+    std::vector<Trace_event> events() const
+    {
+        size_t kept = std::min(count_, events_.size());
+        std::vector<Trace_event> events;
+        events.reserve(kept);
+        for (size_t k = count_ - kept; k < count_; k++)
+            events.push_back(events_[k % events_.size()]);
+        return events;
+    }
+
+    //! the number of events that were overwritten.
+    size_t dropped() const { return count_ - std::min(count_, events_.size()); }
+
+private:
+    size_t thread_;
+    std::vector<Trace_event> events_;
+    size_t count_;
+};
+
+struct Trace_state {
+    std::mutex mutex;
+    std::atomic<bool> enabled{false};
+    std::atomic<size_t> session{0};
+    size_t capacity = 0;
+    std::chrono::steady_clock::time_point start;
+    std::vector<std::shared_ptr<Trace_buffer>> buffers;
+};
+
+inline Trace_state& trace_state()
+{
+    static Trace_state state;
+    return state;
+}
+
+//! the buffer of the calling thread in the current session; created on
+//! first use, so that only the thread itself writes to it.
+inline Trace_buffer& trace_buffer()
+{
+    struct Local {
+        std::shared_ptr<Trace_buffer> buffer;
+        size_t session = 0;
+    };
+    static thread_local Local local;
+    Trace_state& state = trace_state();
+    size_t session = state.session.load(std::memory_order_acquire);
+    if (local.session != session) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        local.buffer = std::make_shared<Trace_buffer>(state.buffers.size(),
+                                                      state.capacity);
+        local.session = session;
+        state.buffers.push_back(local.buffer);
+    }
+    return *local.buffer;
+}
+
+inline double trace_time()
+{
+    std::chrono::duration<double, std::micro> time =
+        std::chrono::steady_clock::now() - trace_state().start;
+    return time.count();
+}
+
+//! records its lifetime as an event if tracing is running; use through
+//! `WDM_TRACE_SCOPE`.
+class Trace_scope {
+public:
+    explicit Trace_scope(const char* name, size_t begin = 0, size_t end = 0) :
+        active_(trace_state().enabled.load(std::memory_order_acquire))
+    {
+        if (active_) {
+            event_.name = name;
+            event_.begin = begin;
+            event_.end = end;
+            event_.time = trace_time();
+        }
+    }
+
+    ~Trace_scope()
+    {
+        if (active_) {
+            event_.duration = trace_time() - event_.time;
+            trace_buffer().record(event_);
+        }
+    }
+
+    Trace_scope(const Trace_scope&) = delete;
+    Trace_scope& operator=(const Trace_scope&) = delete;
+
+private:
+    bool active_;
+    Trace_event event_;
+};
+
+}
+
+//! starts recording a new trace; previous events are discarded.
+//! @param capacity the number of events kept per thread; older events are
+//!   overwritten (and counted as dropped).
+//! @details Must not be called while traced computations are running.
+inline void trace_start(size_t capacity = 65536)
+{
+    if (capacity == 0)
+        throw std::runtime_error("capacity must be positive.");
+    impl::Trace_state& state = impl::trace_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.enabled = false;
+    state.buffers.clear();
+    state.capacity = capacity;
+    state.start = std::chrono::steady_clock::now();
+    state.session++;
+    state.enabled = true;
+}
+
+//! stops recording; the events are kept until the next `trace_start()`.
+inline void trace_stop()
+{
+    impl::trace_state().enabled = false;
+}
+
+//! the recorded events in the Chrome trace-event format.
+//! @details Every scope is a complete (`"X"`) event with the range of tasks
+//!   in `args`; threads are numbered in the order they recorded their first
+//!   event. The number of overwritten events is reported as
+//!   `otherData.dropped_events`. Must not be called while traced
+//!   computations are running.
+inline std::string trace_json()
+{
+    impl::Trace_state& state = impl::trace_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    std::ostringstream json;
+    json.setf(std::ios::fixed);
+    json.precision(3);
+    json << "{\"traceEvents\":[";
+    size_t dropped = 0;
+    bool first = true;
+    for (const auto& buffer : state.buffers) {
+        json << (first ? "" : ",") << std::endl
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+             << buffer->thread() << ",\"args\":{\"name\":\"thread "
+             << buffer->thread() << "\"}}";
+        first = false;
+        for (const auto& event : buffer->events()) {
+            json << "," << std::endl
+                 << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1"
+                 << ",\"tid\":" << buffer->thread() << ",\"ts\":" << event.time
+                 << ",\"dur\":" << event.duration << ",\"args\":{\"begin\":"
+                 << event.begin << ",\"end\":" << event.end << "}}";
+        }
+        dropped += buffer->dropped();
+    }
+    json << std::endl << "],\"displayTimeUnit\":\"ms\","
+         << "\"otherData\":{\"dropped_events\":" << dropped << "}}" << std::endl;
+    return json.str();
+}
+
+#else
+
+inline void trace_start(size_t capacity = 65536)
+{
+    if (capacity == 0)
+        throw std::runtime_error("capacity must be positive.");
+}
+
+inline void trace_stop() {}
+
+inline std::string trace_json()
+{
+    return "{\"traceEvents\":[\n],\"displayTimeUnit\":\"ms\","
+           "\"otherData\":{\"dropped_events\":0}}\n";
+}
+
+#endif
+
+//! writes the recorded events to a file; see `trace_json()`.
+inline void write_trace(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+        throw std::runtime_error("cannot open trace file '" + path + "'.");
+    file << trace_json();
+    if (!file)
+        throw std::runtime_error("cannot write trace file '" + path + "'.");
+}
+
+}
@@ -0,0 +1,115 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "eigen.hpp"
+#include "executor.hpp"
+#include <memory>
+
+namespace wdm {
+
+//! an edge of a spanning tree; see `wdm_spanning_tree()`.
+struct Tree_edge {
+    size_t from;     //!< the vertex (column) already in the tree.
+    size_t to;       //!< the vertex (column) added by the edge.
+    double estimate; //!< the dependence measure between both columns.
+};
+
+//! computes a maximum spanning tree (or forest) of a dependence matrix
+//! without storing the matrix.
+//! @param x input data.
+//! @param method the dependence measure; must be symmetric (see `wdm()` for
+//!   possible values).
+//! @param weights an optional vector of weights for the data.
+//! @param remove_missing if `true`, all observations containing a `nan` are
+//!    removed (pairwise); otherwise throws an error if `nan`s are present.
+//! @param threshold pairs with an absolute dependence below `threshold` are
+//!   not connected; a positive threshold therefore gives a spanning forest.
+//! @param num_threads the number of threads to use; `0` uses all cores.
+//! @return the edges in the order they were added. Edges maximize the sum of
+//!   absolute dependence measures; each tree of the forest is rooted at its
+//!   smallest column index.
+//! @details Uses Prim's algorithm on the complete graph: when a column joins
+//!   the tree, its dependence with all columns outside the tree is computed
+//!   (in parallel) and only the strongest connection of every outside column
+//!   is kept. The threads are started once and reused in every step. Every
+//!   pair is computed exactly once, as for the matrix, but
+//!   memory is linear in the number of columns. Pairs with a `nan` measure
+//!   are not connected.
+inline std::vector<Tree_edge> wdm_spanning_tree(
+    const Eigen::MatrixXd& x,
+    std::string method,
+    Eigen::VectorXd weights = Eigen::VectorXd(),
+    bool remove_missing = true,
+    double threshold = 0.0,
+    size_t num_threads = 1)
+{
+    if (!methods::is_implemented(method))
+        throw std::runtime_error("method not implemented.");
+    if (!methods::is_symmetric(method))
+        throw std::runtime_error("spanning trees require a symmetric method.");
+    if (!(threshold >= 0.0))
+        throw std::runtime_error("threshold must be non-negative.");
+
+    size_t d = x.cols();
+    std::vector<double> w = utils::convert_vec(weights);
+    impl::Prepared_columns cols(x, std::vector<bool>(d, true), method, w,
+                                num_threads);
+
+    // for each column outside the tree: its strongest connection to the tree.
+    std::vector<size_t> outside(d), parent(d, d);
+    for (size_t j = 0; j < d; j++)
+        outside[j] = j;
+    std::vector<double> best(d, std::numeric_limits<double>::quiet_NaN());
+    auto stronger = [] (double a, double b) {
+        return !std::isnan(a) && (std::isnan(b) || (std::abs(a) > std::abs(b)));
+    };
+
+    // one pool for all steps (instead of starting threads in each step).
+    std::unique_ptr<Thread_pool> pool;
+    size_t pool_size = std::min(utils::resolve_num_threads(num_threads), d);
+    if (pool_size > 1)
+        pool.reset(new Thread_pool(pool_size - 1));
+
+    std::vector<Tree_edge> edges;
+    while (!outside.empty()) {
+        // add the strongest connection; start a new tree if there is none.
+        size_t k_best = 0;
+        for (size_t k = 1; k < outside.size(); k++) {
+            if (stronger(best[outside[k]], best[outside[k_best]]))
+                k_best = k;
+        }
+        size_t v = outside[k_best];
+        if ((parent[v] < d) && (std::abs(best[v]) >= threshold)) {
+            edges.push_back({parent[v], v, best[v]});
+        } else {
+            v = outside[0];
+            k_best = 0;
+        }
+        outside.erase(outside.begin() + k_best);
+
+        auto connect = [&] (size_t k) {
+            size_t j = outside[k];
+            double est = impl::wdm_prepared(cols[v], cols[j], method, w,
+                                            remove_missing);
+            if (stronger(est, best[j])) {
+                best[j] = est;
+                parent[j] = v;
+            }
+        };
+        if (pool) {
+            utils::parallel_for(0, outside.size(), connect, *pool,
+                                get_tuning().grain_size);
+        } else {
+            utils::parallel_for(0, outside.size(), connect);
+        }
+    }
+
+    return edges;
+}
+
+}
@@ -0,0 +1,183 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace wdm {
+
+//! machine-dependent parameters of the algorithms.
+//!
+//! The parameters only affect speed, never results (up to rounding). They
+//! can be measured on the host by the `wdm_calibrate` program, which writes
+//! a tuning file (see `read_tuning()`). On first use, the library reads the
+//! file named by the environment variable `WDM_TUNING_FILE`; the defaults
+//! below are used if the variable is not set. If the file cannot be read or
+//! is invalid, the defaults are used as well; nothing is printed, but the
+//! reason is available from `tuning_load_error()`.
+struct Tuning {
+    //! sequences up to this length are sorted by insertion instead of merge
+    //! sort when counting inversions (Kendall's \f$ \tau \f$).
+    size_t merge_sort_cutoff = 32;
+
+    //! lagged Pearson correlations are computed with the FFT if the number
+    //! of lags is at least `fft_lag_factor * log2(size)`, where `size` is
+    //! the length of the transforms.
+    double fft_lag_factor = 1.5;
+
+    //! the number of consecutive tasks (pairs of variables, groups) a
+    //! thread claims at once.
+    size_t grain_size = 16;
+};
+
+namespace impl {
+
+inline void check_tuning(const Tuning& tuning)
+{
+    if (tuning.merge_sort_cutoff < 1)
+        throw std::runtime_error("merge_sort_cutoff must be positive.");
+    if (!(tuning.fft_lag_factor > 0))
+        throw std::runtime_error("fft_lag_factor must be positive.");
+    if (tuning.grain_size < 1)
+        throw std::runtime_error("grain_size must be positive.");
+}
+
+//! reads a non-negative integer (streams silently wrap negative values
+//! around when reading unsigned types).
+inline bool read_count(std::istream& in, size_t& value)
+{
+    std::string token;
+    if (!(in >> token) || (token.find_first_not_of("0123456789") != std::string::npos))
+        return false;
+    std::istringstream digits(token);
+    return static_cast<bool>(digits >> value);
+}
+
+}
+
+//! reads tuning parameters from a file.
+//! @param path the file name.
+//! @return the parameters; parameters that are missing in the file have
+//!   their default values.
+//! @details The file contains lines `key = value` with the names of the
+//!   fields of `Tuning` as keys. Empty lines and lines starting with `#` are
+//!   ignored, as are unknown keys (so that files stay valid across
+//!   versions).
+inline Tuning read_tuning(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("cannot open tuning file '" + path + "'.");
+
+    Tuning tuning;
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); line_number++) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if ((first == std::string::npos) || (line[first] == '#'))
+            continue;
+        std::istringstream fields(line);
+        std::string key, equals;
+        fields >> key >> equals;
+        bool ok = (equals == "="), known = true;
+        if (key == "merge_sort_cutoff")
+            ok = ok && impl::read_count(fields, tuning.merge_sort_cutoff);
+        else if (key == "fft_lag_factor")
+            ok = ok && (fields >> tuning.fft_lag_factor);
+        else if (key == "grain_size")
+            ok = ok && impl::read_count(fields, tuning.grain_size);
+        else
+            known = false;
+        std::string rest;
+        if (!ok || (known && (fields >> rest))) {
+            throw std::runtime_error("invalid line " + std::to_string(line_number) +
+                                     " in tuning file '" + path + "'.");
+        }
+    }
+    impl::check_tuning(tuning);
+    return tuning;
+}
+
+//! writes tuning parameters to a file (see `read_tuning()`).
+//! @param path the file name.
+//! @param tuning the parameters.
+inline void write_tuning(const std::string& path, const Tuning& tuning)
+{
+    std::ofstream file(path);
+    if (!file)
+        throw std::runtime_error("cannot open tuning file '" + path + "'.");
+    file.precision(17);
+    file << "# wdm tuning parameters" << std::endl
+         << "merge_sort_cutoff = " << tuning.merge_sort_cutoff << std::endl
+         << "fft_lag_factor = " << tuning.fft_lag_factor << std::endl
+         << "grain_size = " << tuning.grain_size << std::endl;
+    if (!file)
+        throw std::runtime_error("cannot write tuning file '" + path + "'.");
+}
+
+namespace impl {
+
+//! the reason why the last call to `load_tuning()` fell back to the
+//! defaults (empty if it did not).
+inline std::string& tuning_error_instance()
+{
+    static std::string error;
+    return error;
+}
+
+//! reads the file named by `WDM_TUNING_FILE`. Since this happens lazily
+//! inside the algorithms, a broken file must not make all of them throw (or
+//! write to the streams of the host program); the error is stored instead.
+inline Tuning load_tuning()
+{
+    tuning_error_instance().clear();
+    const char* path = std::getenv("WDM_TUNING_FILE");
+    if ((path == nullptr) || (*path == '\0'))
+        return Tuning();
+    try {
+        return read_tuning(path);
+    } catch (const std::runtime_error& e) {
+        tuning_error_instance() = e.what();
+        return Tuning();
+    }
+}
+
+inline Tuning& tuning_instance()
+{
+    static Tuning tuning = load_tuning();
+    return tuning;
+}
+
+}
+
+//! the tuning parameters in use.
+inline const Tuning& get_tuning()
+{
+    return impl::tuning_instance();
+}
+
+//! why the tuning file named by `WDM_TUNING_FILE` was not used.
+//! @return the error message of the last attempt to read it; empty if the
+//!   file was read or no file was named.
+inline std::string tuning_load_error()
+{
+    impl::tuning_instance();
+    return impl::tuning_error_instance();
+}
+
+//! sets the tuning parameters; must not be called while computations are
+//! running.
+inline void set_tuning(const Tuning& tuning)
+{
+    impl::check_tuning(tuning);
+    impl::tuning_instance() = tuning;
+}
+
+}
@@ -0,0 +1,29 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include <limits>
+
+namespace wdm {
+
+//! tie statistics of a variable, needed for the test based on Kendall's
+//! \f$ \tau \f$ (see `Indep_test`).
+struct Margin_ties {
+    double pairs = 0.0;    //!< (weighted) number of tied pairs.
+    double triplets = 0.0; //!< (weighted) number of tied triplets.
+    double v = 0.0;        //!< variance contribution of the ties.
+};
+
+//! results of an independence test computed by `try_indep_test()`.
+struct Test_result {
+    double n_eff = std::numeric_limits<double>::quiet_NaN();
+    double estimate = std::numeric_limits<double>::quiet_NaN();
+    double statistic = std::numeric_limits<double>::quiet_NaN();
+    double p_value = std::numeric_limits<double>::quiet_NaN();
+};
+
+}
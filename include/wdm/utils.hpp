@@ -6,11 +6,14 @@
 
 #pragma once
 
+#include "reduce.hpp"
+#include "tuning.hpp"
 #include <algorithm>
 #include <string>
 #include <vector>
 #include <numeric>
 #include <cmath>
+#include <cstddef>
 #include <stdexcept>
 
 namespace wdm {
@@ -45,6 +48,50 @@ inline void check_sizes(const std::vector<double>& x,
         throw std::runtime_error("x, y, and weights must have the same size.");
 }
 
+//! a read-only view of `n` numbers stored `inc` elements apart (e.g., a row
+//! of a column-major matrix); the numbers are owned by the caller.
+class Strided_view {
+public:
+    //! @param data pointer to the first element; `NULL` gives an empty view.
+    //! @param n number of elements.
+    //! @param inc distance between consecutive elements.
+    Strided_view(const double* data, size_t n, ptrdiff_t inc = 1) :
+        data_(data),
+        n_(data ? n : 0),
+        inc_(inc)
+    {}
+
+    //! views a vector (without copying it).
+    Strided_view(const std::vector<double>& x) :
+        data_(x.data()),
+        n_(x.size()),
+        inc_(1)
+    {}
+
+    size_t size() const { return n_; }
+
+    double operator[](size_t i) const
+    {
+        return data_[static_cast<ptrdiff_t>(i) * inc_];
+    }
+
+    //! copies the elements into a vector.
+    std::vector<double> to_vector() const
+    {
+        if (inc_ == 1)
+            return std::vector<double>(data_, data_ + n_);
+        std::vector<double> x(n_);
+        for (size_t i = 0; i < n_; i++)
+            x[i] = (*this)[i];
+        return x;
+    }
+
+private:
+    const double* data_;
+    size_t n_;
+    ptrdiff_t inc_;
+};
+
 
 //! computes the nth power for all elements in a vector.
 //! @param x the inpute vector.
@@ -68,10 +115,7 @@ inline std::vector<double> pow(const std::vector<double>& x, size_t n)
 //! @param x the input vector.
 inline double sum(const std::vector<double>& x)
 {
-    double res = 0.0;
-    for (size_t i = 0; i < x.size(); i++)
-        res += x[i];
-    return res;
+    return reduce_sum(x.size(), [&] (size_t i) { return x[i]; });
 }
 
 
@@ -117,20 +161,20 @@ inline std::vector<size_t> invert_permutation(const std::vector<size_t>& perm)
 }
 
 //! computes the permutation that brings a vector into order.
-//! @param x inpute vector.
+//! @param x inpute vector (or a `Strided_view`).
 //! @param ascending whether order ascendingly or descendingly.
-inline std::vector<size_t> get_order(const std::vector<double>& x,
-                                     bool ascending = true)
+//! @details Tied elements are kept in order of their position.
+template<class X>
+inline std::vector<size_t> get_order(const X& x, bool ascending = true)
 {
     size_t n = x.size();
     std::vector<size_t> perm(n);
     for (size_t i = 0; i < n; i++)
         perm[i] = i;
     auto sorter = [&] (size_t i, size_t j) {
-        if (ascending)
-            return (x[i] < x[j]);
-        else
-            return (x[i] > x[j]);
+        if (x[i] != x[j])
+            return ascending ? (x[i] < x[j]) : (x[i] > x[j]);
+        return i < j;
     };
     std::sort(perm.begin(), perm.end(), sorter);
 
@@ -260,16 +304,15 @@ inline double count_tied_pairs(const std::vector<double>& x,
 //! count tied triplets.
 //! @param x a sorted input vector.
 //! @param weights optionally, a vector of weights for the elements in `x`.
-//! @param break_by second vector that was used to break ties (optional).
 //! @return the number of (weighted) tied triplets in `x`
 inline double count_tied_triplets(const std::vector<double>& x,
                                   const std::vector<double>& weights)
 {
     bool weighted = (weights.size() > 0);
     double count = 0.0, w1 = 0.0, w2 = 0.0, w3 = 0.0;
-    size_t reps = 2;
-    for (size_t i = 2; i < x.size(); i++) {
-        if ((x[i] == x[i - 1]) && (x[i] == x[i - 2])) {
+    size_t reps = 1;
+    for (size_t i = 1; i < x.size(); i++) {
+        if (x[i] == x[i - 1]) {
             if (weighted) {
                 if (reps == 1) {
                     w1 = weights[i - 1];
@@ -281,11 +324,13 @@ inline double count_tied_triplets(const std::vector<double>& x,
                 w3 += std::pow(weights[i], 3);
             }
             reps++;
-        } else if (reps > 2) {
-            if (weighted) {
-                count += (std::pow(w1, 3) - 3 * w2 * w1 + 2 * w3) / 6.0;
-            } else {
-                count += reps * (reps - 1) *  (reps - 2) / 6.0;
+        } else if (reps > 1) {
+            if (reps > 2) {
+                if (weighted) {
+                    count += (std::pow(w1, 3) - 3 * w2 * w1 + 2 * w3) / 6.0;
+                } else {
+                    count += reps * (reps - 1) * (reps - 2) / 6.0;
+                }
             }
             reps = 1;
         }
@@ -346,6 +391,39 @@ inline double count_joint_ties(const std::vector<double>& x,
     return count;
 }
 
+//! counts tied pairs with additive pair weights.
+//! @param x, y input vectors that are sorted wrt `x` as first and `y` as
+//!   secondary key.
+//! @param weights, scores vectors of weights w and scores s for the elements;
+//!   a pair (a, b) has weight s_a * w_b + w_a * s_b.
+//! @param joint if `true`, only pairs tied in both `x` and `y` are counted;
+//!   otherwise, all pairs tied in `x`.
+//! @return the sum of pair weights over all tied pairs.
+inline double count_tied_pairs_additive(const std::vector<double>& x,
+                                        const std::vector<double>& y,
+                                        const std::vector<double>& weights,
+                                        const std::vector<double>& scores,
+                                        bool joint = false)
+{
+    // within a tie group, the sum over pairs is S * W - sum_a s_a * w_a.
+    double count = 0.0;
+    for (size_t i = 0, reps; i < x.size(); i += reps) {
+        double w_sum = 0.0, s_sum = 0.0, sw_sum = 0.0;
+        reps = 0;
+        while ((i + reps < x.size()) && (x[i + reps] == x[i]) &&
+               (!joint || (y[i + reps] == y[i]))) {
+            w_sum += weights[i + reps];
+            s_sum += scores[i + reps];
+            sw_sum += scores[i + reps] * weights[i + reps];
+            reps++;
+        }
+        if (reps > 1)
+            count += s_sum * w_sum - sw_sum;
+    }
+
+    return count;
+}
+
 //! merge sort for a pair of vectors, counting inversions.
 //! @param vec container for the sorted elements.
 //! @param vec1, vec2 sorted input vectors to be merged.
@@ -406,16 +484,50 @@ inline void merge(std::vector<double>& vec,
     }
 }
 
+//! insertion sort for short vectors, counting inversions; stable and counts
+//! the same (weighted) inversions as `merge_sort()`.
+//! @param vec the vector to be sorted.
+//! @param weights vector of weights corresponding to `vec`; can be empty for
+//!   unweighted counts.
+//! @param count counter to which the (weighted) number of inversions are added.
+inline void insertion_sort(std::vector<double>& vec,
+                           std::vector<double>& weights,
+                           double& count)
+{
+    bool weighted = (weights.size() > 0);
+    for (size_t i = 1; i < vec.size(); i++) {
+        double v = vec[i], w = weighted ? weights[i] : 1.0, w_acc = 0.0;
+        size_t j = i;
+        for (; (j > 0) && (vec[j - 1] > v); j--) {
+            vec[j] = vec[j - 1];
+            if (weighted) {
+                weights[j] = weights[j - 1];
+                w_acc += weights[j - 1];
+            } else {
+                w_acc += 1.0;
+            }
+        }
+        vec[j] = v;
+        if (weighted)
+            weights[j] = w;
+        count += w * w_acc;
+    }
+}
+
 //! sorting elements in a vector while counting inversions.
 //! @param vec the vector to be sorted.
 //! @param weights vector of weights corresponding to `vec`; can be empty for
 //!   unweighted counts.
 //! @param count counter to which the (weighted) number of inversions are added.
+//! @param cutoff vectors up to this length are sorted by `insertion_sort()`.
 inline void merge_sort(std::vector<double>& vec,
                        std::vector<double>& weights,
-                       double& count)
+                       double& count,
+                       size_t cutoff)
 {
-    if (vec.size() > 1) {
+    if (vec.size() <= cutoff) {
+        insertion_sort(vec, weights, count);
+    } else {
         size_t n = vec.size();
         std::vector<double> vec1(vec.begin(), vec.begin() + n / 2);
         std::vector<double> vec2(vec.begin() + n / 2, vec.end());
@@ -424,12 +536,112 @@ inline void merge_sort(std::vector<double>& vec,
         std::vector<double> weights1(weights.begin(), weights.begin() + n / 2);
         std::vector<double> weights2(weights.begin() + n / 2, weights.end());
 
-        merge_sort(vec1, weights1, count);
-        merge_sort(vec2, weights2, count);
+        merge_sort(vec1, weights1, count, cutoff);
+        merge_sort(vec2, weights2, count, cutoff);
         merge(vec, vec1, vec2, weights, weights1, weights2, count);
     }
 }
 
+//! sorting elements in a vector while counting inversions; short
+//! subsequences are sorted by insertion (see `Tuning::merge_sort_cutoff`).
+//! @param vec the vector to be sorted.
+//! @param weights vector of weights corresponding to `vec`; can be empty for
+//!   unweighted counts.
+//! @param count counter to which the (weighted) number of inversions are added.
+inline void merge_sort(std::vector<double>& vec,
+                       std::vector<double>& weights,
+                       double& count)
+{
+    merge_sort(vec, weights, count, get_tuning().merge_sort_cutoff);
+}
+
+//! merge operation for a pair of vectors, accumulating additive weights of
+//! inversions.
+//! @param vec container for the sorted elements.
+//! @param vec1, vec2 sorted input vectors to be merged.
+//! @param weights, scores containers for the weights and scores
+//!   corresponding to sorted elements in `vec`.
+//! @param weights1, weights2, scores1, scores2 weights and scores
+//!   corresponding to input vectors `vec1`, `vec2`.
+//! @param count counter to which the sum of pair weights s_a * w_b + w_a * s_b
+//!   over all inversions (a, b) is added.
+inline void merge_additive(std::vector<double>& vec,
+                           const std::vector<double>& vec1,
+                           const std::vector<double>& vec2,
+                           std::vector<double>& weights,
+                           const std::vector<double>& weights1,
+                           const std::vector<double>& weights2,
+                           std::vector<double>& scores,
+                           const std::vector<double>& scores1,
+                           const std::vector<double>& scores2,
+                           double& count)
+{
+    // sums of weights and scores of the elements remaining in vec1
+    double w_rem = 0.0, s_rem = 0.0;
+    for (size_t i = 0; i < vec1.size(); i++) {
+        w_rem += weights1[i];
+        s_rem += scores1[i];
+    }
+    size_t i, j, k;
+    for (i = 0, j = 0, k = 0; i < vec1.size() && j < vec2.size(); k++) {
+        if (vec1[i] <= vec2[j]) {
+            vec[k] = vec1[i];
+            weights[k] = weights1[i];
+            scores[k] = scores1[i];
+            w_rem -= weights1[i];
+            s_rem -= scores1[i];
+            i++;
+        } else {
+            vec[k] = vec2[j];
+            weights[k] = weights2[j];
+            scores[k] = scores2[j];
+            count += s_rem * weights2[j] + w_rem * scores2[j];
+            j++;
+        }
+    }
+
+    for (; i < vec1.size(); i++, k++) {
+        vec[k] = vec1[i];
+        weights[k] = weights1[i];
+        scores[k] = scores1[i];
+    }
+    for (; j < vec2.size(); j++, k++) {
+        vec[k] = vec2[j];
+        weights[k] = weights2[j];
+        scores[k] = scores2[j];
+    }
+}
+
+//! sorting elements in a vector while accumulating additive weights of
+//! inversions.
+//! @param vec the vector to be sorted.
+//! @param weights, scores vectors of weights w and scores s corresponding to
+//!   `vec`.
+//! @param count counter to which the sum of pair weights s_a * w_b + w_a * s_b
+//!   over all inversions (a, b) is added.
+inline void merge_sort_additive(std::vector<double>& vec,
+                                std::vector<double>& weights,
+                                std::vector<double>& scores,
+                                double& count)
+{
+    if (vec.size() > 1) {
+        size_t n = vec.size();
+        std::vector<double> vec1(vec.begin(), vec.begin() + n / 2);
+        std::vector<double> vec2(vec.begin() + n / 2, vec.end());
+        std::vector<double> weights1(weights.begin(), weights.begin() + n / 2);
+        std::vector<double> weights2(weights.begin() + n / 2, weights.end());
+        std::vector<double> scores1(scores.begin(), scores.begin() + n / 2);
+        std::vector<double> scores2(scores.begin() + n / 2, scores.end());
+
+        merge_sort_additive(vec1, weights1, scores1, count);
+        merge_sort_additive(vec2, weights2, scores2, count);
+        merge_additive(vec, vec1, vec2,
+                       weights, weights1, weights2,
+                       scores, scores1, scores2,
+                       count);
+    }
+}
+
 //! merge operation for a pair of vectors, counting inversions per element.
 //! @param vec container for the sorted elements.
 //! @param vec1, vec2 sorted input vectors to be merged.
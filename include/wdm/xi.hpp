@@ -0,0 +1,127 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+#include "utils.hpp"
+
+namespace wdm {
+
+namespace impl {
+
+//! removes observations with zero weight and checks that all other weights
+//! are equal (Chatterjee's xi is not defined for unequal weights).
+inline void xi_check_weights(std::vector<double>& x,
+                             std::vector<double>& y,
+                             std::vector<double>& weights)
+{
+    if (weights.size() == 0)
+        return;
+    size_t n_keep = 0;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (weights[i] == 0.0)
+            continue;
+        if (weights[i] != weights[n_keep > 0 ? n_keep - 1 : i])
+            throw std::runtime_error(
+                "Chatterjee's xi is only defined for equal weights.");
+        x[n_keep] = x[i];
+        y[n_keep] = y[i];
+        weights[n_keep++] = weights[i];
+    }
+    x.resize(n_keep);
+    y.resize(n_keep);
+    weights.clear();
+}
+
+//! computes r_i = #{j : y_j <= y_i} and l_i = #{j : y_j >= y_i} from a
+//! single sort of `y`.
+inline void xi_counts(const std::vector<double>& y,
+                      std::vector<double>& r,
+                      std::vector<double>& l)
+{
+    size_t n = y.size();
+    std::vector<size_t> perm = utils::get_order(y);
+    r.resize(n);
+    l.resize(n);
+    for (size_t i = 0, reps; i < n; i += reps) {
+        reps = 1;
+        while ((i + reps < n) && (y[perm[i]] == y[perm[i + reps]]))
+            reps++;
+        for (size_t k = i; k < i + reps; k++) {
+            r[perm[k]] = static_cast<double>(i + reps);
+            l[perm[k]] = static_cast<double>(n - i);
+        }
+    }
+}
+
+//! calculates Chatterjee's xi, measuring how much `y` is a function of `x`.
+//! @param x, y input data.
+//! @param weights an optional vector of weights for the data; observations
+//!   with zero weight are ignored, all other weights must be equal.
+//! @details Ties in `x` are broken by position (instead of at random as in
+//!   Chatterjee, 2021), so the result is deterministic.
+inline double xi(std::vector<double> x,
+                 std::vector<double> y,
+                 std::vector<double> weights = std::vector<double>())
+{
+    utils::check_sizes(x, y, weights);
+    xi_check_weights(x, y, weights);
+    size_t n = x.size();
+
+    std::vector<double> r, l;
+    xi_counts(y, r, l);
+    std::vector<size_t> perm = utils::get_order(x);
+
+    double s = 0.0, cu = 0.0;
+    for (size_t k = 1; k < n; k++)
+        s += std::abs(r[perm[k]] - r[perm[k - 1]]);
+    for (size_t i = 0; i < n; i++)
+        cu += l[i] * (n - l[i]);
+
+    return 1.0 - n * s / (2.0 * cu);
+}
+
+//! factor turning xi into an asymptotically standard normal test statistic
+//! under independence; accounts for ties in `y` (Chatterjee, 2021, Thm. 2.2).
+inline double xi_stat_adjust(std::vector<double> x,
+                             std::vector<double> y,
+                             std::vector<double> weights)
+{
+    utils::check_sizes(x, y, weights);
+    xi_check_weights(x, y, weights);
+    double n = static_cast<double>(x.size());
+
+    // the empirical cdfs F(y_i) and G(y_i) = 1 - F(y_i-)
+    std::vector<double> f, g;
+    xi_counts(y, f, g);
+    double cu = 0.0;
+    for (size_t i = 0; i < f.size(); i++) {
+        f[i] /= n;
+        g[i] /= n;
+        cu += g[i] * (1 - g[i]) / n;
+    }
+
+    std::sort(f.begin(), f.end());
+    double a = 0.0, b = 0.0, c = 0.0, f_acc = 0.0;
+    for (size_t i = 0; i < f.size(); i++) {
+        double k = 2 * n - 2 * (i + 1) + 1;
+        a += k * f[i] * f[i];
+        c += k * f[i];
+        f_acc += f[i];
+        double m = (f_acc + (n - (i + 1)) * f[i]) / n;
+        b += m * m;
+    }
+    a /= n * n;
+    c /= n * n;
+    b /= n;
+    double v = (a - 2 * b + c * c) / (cu * cu);
+
+    return std::sqrt(n / v);
+}
+
+}
+
+}
@@ -0,0 +1,145 @@
+/* Copyright © 2020 Thomas Nagler
+ *
+ * This file is part of the wdm library and licensed under the terms of
+ * the MIT license. For a copy, see the LICENSE file in the root directory
+ * or https://github.com/tnagler/wdm/blob/master/LICENSE.
+ */
+
+/** @file wdm_c.h
+ * @brief C interface to the wdm library.
+ *
+ * The C interface is part of the precompiled libraries (`wdm_static`,
+ * `wdm_shared`). All inputs are passed as a pointer plus a stride (in
+ * elements), so that arrays owned by other runtimes can be passed as they
+ * are: element `i` of `x` is `x[i * incx]`. Pearson's correlation of
+ * complete data and the columns passed to `wdm_compute_matrix()` are read
+ * where they are; otherwise the kernels remove missing values and sort in
+ * place, so each input is copied once into a working buffer. The caller's
+ * arrays are never modified. All outputs are written to buffers owned by the caller. No
+ * function throws; errors are reported through the returned `wdm_status`.
+ */
+
+#ifndef WDM_C_H
+#define WDM_C_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** status codes returned by all functions of the C interface. */
+typedef enum wdm_status {
+    WDM_OK = 0,                     /**< success */
+    WDM_ERROR_NULL_POINTER = 1,     /**< a required pointer was `NULL` */
+    WDM_ERROR_INVALID_ARGUMENT = 2, /**< invalid method, alternative, size,
+                                         or data (e.g., unequal weights for
+                                         `WDM_CHATTERJEE`) */
+    WDM_ERROR_MISSING_VALUES = 3,   /**< `nan`s present and not removed */
+    WDM_ERROR_OUT_OF_MEMORY = 4,    /**< memory allocation failed (or the
+                                         input is too large) */
+    WDM_ERROR_INTERNAL = 5          /**< unexpected internal error */
+} wdm_status;
+
+/** dependence measures. */
+typedef enum wdm_method {
+    WDM_PEARSON = 0,
+    WDM_SPEARMAN = 1,
+    WDM_KENDALL = 2,
+    WDM_BLOMQVIST = 3,
+    WDM_HOEFFDING = 4,
+    WDM_CHATTERJEE = 5, /**< not symmetric; weights must be equal */
+    WDM_DCOR = 6,       /**< distance correlation */
+    WDM_HTAU = 7        /**< hyperbolic weighted Kendall's tau; no test */
+} wdm_method;
+
+/** alternative hypotheses for independence tests. */
+typedef enum wdm_alternative {
+    WDM_TWO_SIDED = 0,
+    WDM_GREATER = 1,
+    WDM_LESS = 2
+} wdm_alternative;
+
+/** results of an independence test. */
+typedef struct wdm_test_result {
+    double n_eff;     /**< effective sample size */
+    double estimate;  /**< estimated dependence measure */
+    double statistic; /**< test statistic */
+    double p_value;   /**< p-value */
+} wdm_test_result;
+
+/** returns a static, human-readable description of a status code. */
+const char* wdm_status_message(wdm_status status);
+
+/** calculates a (weighted) dependence measure.
+ *
+ * @param n number of observations.
+ * @param x, incx first variable and its stride.
+ * @param y, incy second variable and its stride.
+ * @param weights, incw optional weights (may be `NULL`) and their stride.
+ * @param method the dependence measure.
+ * @param remove_missing if non-zero, observations containing a `nan` are
+ *   removed; otherwise `WDM_ERROR_MISSING_VALUES` is returned if `nan`s are
+ *   present.
+ * @param result pointer to which the dependence measure is written.
+ */
+wdm_status wdm_compute(size_t n,
+                       const double* x, ptrdiff_t incx,
+                       const double* y, ptrdiff_t incy,
+                       const double* weights, ptrdiff_t incw,
+                       wdm_method method,
+                       int remove_missing,
+                       double* result);
+
+/** calculates a matrix of (weighted) dependence measures.
+ *
+ * @param n, d number of observations (rows) and variables (columns).
+ * @param data, row_stride, col_stride the data; element `(i, j)` is
+ *   `data[i * row_stride + j * col_stride]`, so both row- and column-major
+ *   layouts can be passed directly.
+ * @param weights, incw optional weights (may be `NULL`) and their stride.
+ * @param method the dependence measure.
+ * @param remove_missing see `wdm_compute()`.
+ * @param result, ld_result row-major output buffer with leading dimension
+ *   `ld_result >= d`; entry `(i, j)` is written to
+ *   `result[i * ld_result + j]`. For asymmetric measures, it is the measure
+ *   between variables `i` (as `x`) and `j` (as `y`). The diagonal is one,
+ *   except for Hoeffding's D and Chatterjee's xi, where it is the measure of
+ *   each variable with itself.
+ * @param num_threads the number of threads; `0` uses all cores.
+ *
+ * Each column is prepared once (ranks, sorting orders, medians), and the
+ * pairs are computed in parallel.
+ */
+wdm_status wdm_compute_matrix(size_t n, size_t d,
+                              const double* data,
+                              ptrdiff_t row_stride, ptrdiff_t col_stride,
+                              const double* weights, ptrdiff_t incw,
+                              wdm_method method,
+                              int remove_missing,
+                              double* result, size_t ld_result,
+                              size_t num_threads);
+
+/** performs an independence test based on a (weighted) dependence measure.
+ *
+ * @param n, x, incx, y, incy, weights, incw, method, remove_missing see
+ *   `wdm_compute()`.
+ * @param alternative the alternative hypothesis; for `WDM_HOEFFDING` and
+ *   `WDM_DCOR`, only `WDM_TWO_SIDED` is allowed. There is no test for
+ *   `WDM_HTAU`.
+ * @param result pointer to which the test results are written.
+ */
+wdm_status wdm_indep_test(size_t n,
+                          const double* x, ptrdiff_t incx,
+                          const double* y, ptrdiff_t incy,
+                          const double* weights, ptrdiff_t incw,
+                          wdm_method method,
+                          int remove_missing,
+                          wdm_alternative alternative,
+                          wdm_test_result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WDM_C_H */
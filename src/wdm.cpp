@@ -0,0 +1,14 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Translation unit for the precompiled libraries `wdm_static` and
+// `wdm_shared`. With `WDM_COMPILING_LIB` set, `wdm.hpp` includes the kernels
+// and the entry points declared `WDM_INLINE` are emitted here as regular
+// (non-inline) definitions. Consumers of the libraries only parse the
+// declarations (`wdm.hpp` without the kernels).
+
+#define WDM_COMPILING_LIB
+#include "wdm.hpp"
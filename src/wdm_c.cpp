@@ -0,0 +1,266 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#include "wdm_c.h"
+#include "wdm.hpp"
+#include "wdm/parallel.hpp"
+#include "wdm/prepare.hpp"
+#include "wdm/prho.hpp"
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+namespace {
+
+const char* method_name(wdm_method method)
+{
+    switch (method) {
+        case WDM_PEARSON:
+            return "pearson";
+        case WDM_SPEARMAN:
+            return "spearman";
+        case WDM_KENDALL:
+            return "kendall";
+        case WDM_BLOMQVIST:
+            return "blomqvist";
+        case WDM_HOEFFDING:
+            return "hoeffding";
+        case WDM_CHATTERJEE:
+            return "chatterjee";
+        case WDM_DCOR:
+            return "dcor";
+        case WDM_HTAU:
+            return "htau";
+    }
+    return nullptr;
+}
+
+const char* alternative_name(wdm_alternative alternative)
+{
+    switch (alternative) {
+        case WDM_TWO_SIDED:
+            return "two-sided";
+        case WDM_GREATER:
+            return "greater";
+        case WDM_LESS:
+            return "less";
+    }
+    return nullptr;
+}
+
+using wdm::utils::Strided_view;
+
+wdm_status check_data(const Strided_view& x,
+                      const Strided_view& y,
+                      const Strided_view& weights,
+                      const char* method,
+                      int remove_missing)
+{
+    if (remove_missing)
+        return WDM_OK;
+    if (wdm::utils::any_nan(x) || wdm::utils::any_nan(y) ||
+        wdm::utils::any_nan(weights))
+        return WDM_ERROR_MISSING_VALUES;
+    if (x.size() < wdm::methods::get_min_nobs(method))
+        return WDM_ERROR_INVALID_ARGUMENT;
+    return WDM_OK;
+}
+
+// Pearson's rho does not modify its input, so complete data are read where
+// they are; all other kernels remove missing values and sort in place and
+// work on a copy (`Strided_view::to_vector()`).
+bool read_in_place(const Strided_view& x,
+                   const Strided_view& y,
+                   const Strided_view& weights,
+                   const char* method)
+{
+    return wdm::methods::is_pearson(method) &&
+        (x.size() >= wdm::methods::get_min_nobs(method)) &&
+        !wdm::utils::any_nan(x) && !wdm::utils::any_nan(y) &&
+        !wdm::utils::any_nan(weights);
+}
+
+} // end anonymous namespace
+
+extern "C" {
+
+const char* wdm_status_message(wdm_status status)
+{
+    switch (status) {
+        case WDM_OK:
+            return "success";
+        case WDM_ERROR_NULL_POINTER:
+            return "a required pointer is NULL";
+        case WDM_ERROR_INVALID_ARGUMENT:
+            return "invalid method, alternative, size, or data";
+        case WDM_ERROR_MISSING_VALUES:
+            return "there are missing values in the data; "
+                   "try remove_missing != 0";
+        case WDM_ERROR_OUT_OF_MEMORY:
+            return "memory allocation failed";
+        case WDM_ERROR_INTERNAL:
+            return "internal error";
+    }
+    return "unknown status";
+}
+
+wdm_status wdm_compute(size_t n,
+                       const double* x, ptrdiff_t incx,
+                       const double* y, ptrdiff_t incy,
+                       const double* weights, ptrdiff_t incw,
+                       wdm_method method,
+                       int remove_missing,
+                       double* result)
+{
+    if (!x || !y || !result)
+        return WDM_ERROR_NULL_POINTER;
+    const char* m = method_name(method);
+    if (!m)
+        return WDM_ERROR_INVALID_ARGUMENT;
+
+    try {
+        Strided_view xx(x, n, incx), yy(y, n, incy), ww(weights, n, incw);
+        wdm_status status = check_data(xx, yy, ww, m, remove_missing);
+        if (status != WDM_OK)
+            return status;
+        if (read_in_place(xx, yy, ww, m)) {
+            *result = wdm::impl::prho(xx, yy, ww);
+        } else {
+            *result = wdm::wdm(xx.to_vector(), yy.to_vector(), m,
+                               ww.to_vector(), remove_missing != 0);
+        }
+    } catch (const std::bad_alloc&) {
+        return WDM_ERROR_OUT_OF_MEMORY;
+    } catch (const std::length_error&) {
+        return WDM_ERROR_OUT_OF_MEMORY;
+    } catch (const std::runtime_error&) {
+        // the kernels reject invalid inputs (e.g., unequal weights for
+        // Chatterjee's xi) with runtime errors.
+        return WDM_ERROR_INVALID_ARGUMENT;
+    } catch (...) {
+        return WDM_ERROR_INTERNAL;
+    }
+
+    return WDM_OK;
+}
+
+wdm_status wdm_compute_matrix(size_t n, size_t d,
+                              const double* data,
+                              ptrdiff_t row_stride, ptrdiff_t col_stride,
+                              const double* weights, ptrdiff_t incw,
+                              wdm_method method,
+                              int remove_missing,
+                              double* result, size_t ld_result,
+                              size_t num_threads)
+{
+    if (!data || !result)
+        return WDM_ERROR_NULL_POINTER;
+    const char* m = method_name(method);
+    if (!m || (ld_result < d))
+        return WDM_ERROR_INVALID_ARGUMENT;
+
+    try {
+        // the columns are read where they are; the prepared columns hold
+        // their own sort orders and centered copies.
+        std::vector<Strided_view> cols;
+        cols.reserve(d);
+        for (size_t j = 0; j < d; j++) {
+            cols.emplace_back(data + static_cast<ptrdiff_t>(j) * col_stride,
+                              n, row_stride);
+        }
+        std::vector<double> ww = Strided_view(weights, n, incw).to_vector();
+        for (size_t j = 0; j < d; j++) {
+            wdm_status status = check_data(cols[j], cols[j], ww, m,
+                                           remove_missing);
+            if (status != WDM_OK)
+                return status;
+        }
+
+        // the work depending on a single variable is done once per column.
+        std::vector<std::unique_ptr<wdm::impl::Prepared_column>> prepared(d);
+        wdm::utils::parallel_for(0, d, [&] (size_t j) {
+            prepared[j].reset(new wdm::impl::Prepared_column(cols[j], m, ww));
+        }, num_threads);
+
+        bool symmetric = wdm::methods::is_symmetric(m);
+        bool unit_diagonal = wdm::methods::has_unit_diagonal(m);
+        wdm::utils::parallel_for(0, d, [&] (size_t i) {
+            result[i * ld_result + i] = unit_diagonal ? 1.0 :
+                wdm::impl::wdm_prepared(*prepared[i], *prepared[i], m, ww,
+                                        remove_missing != 0);
+            for (size_t j = i + 1; j < d; j++) {
+                double est = wdm::impl::wdm_prepared(
+                    *prepared[i], *prepared[j], m, ww, remove_missing != 0);
+                result[i * ld_result + j] = est;
+                if (!symmetric) {
+                    est = wdm::impl::wdm_prepared(
+                        *prepared[j], *prepared[i], m, ww, remove_missing != 0);
+                }
+                result[j * ld_result + i] = est;
+            }
+        }, num_threads);
+    } catch (const std::bad_alloc&) {
+        return WDM_ERROR_OUT_OF_MEMORY;
+    } catch (const std::length_error&) {
+        return WDM_ERROR_OUT_OF_MEMORY;
+    } catch (const std::runtime_error&) {
+        return WDM_ERROR_INVALID_ARGUMENT;
+    } catch (...) {
+        return WDM_ERROR_INTERNAL;
+    }
+
+    return WDM_OK;
+}
+
+wdm_status wdm_indep_test(size_t n,
+                          const double* x, ptrdiff_t incx,
+                          const double* y, ptrdiff_t incy,
+                          const double* weights, ptrdiff_t incw,
+                          wdm_method method,
+                          int remove_missing,
+                          wdm_alternative alternative,
+                          wdm_test_result* result)
+{
+    if (!x || !y || !result)
+        return WDM_ERROR_NULL_POINTER;
+    const char* m = method_name(method);
+    const char* alt = alternative_name(alternative);
+    if (!m || !alt)
+        return WDM_ERROR_INVALID_ARGUMENT;
+    if (!wdm::methods::has_indep_test(m))
+        return WDM_ERROR_INVALID_ARGUMENT;
+    if (wdm::methods::is_two_sided_only(m) && (alternative != WDM_TWO_SIDED))
+        return WDM_ERROR_INVALID_ARGUMENT;
+
+    try {
+        Strided_view xx(x, n, incx), yy(y, n, incy), ww(weights, n, incw);
+        wdm_status status = check_data(xx, yy, ww, m, remove_missing);
+        if (status != WDM_OK)
+            return status;
+        // the test for Pearson's rho only needs the estimate.
+        wdm::Indep_test test = read_in_place(xx, yy, ww, m) ?
+            wdm::Indep_test(wdm::impl::prho(xx, yy, ww), m, n,
+                            ww.to_vector(), alt) :
+            wdm::Indep_test(xx.to_vector(), yy.to_vector(), m, ww.to_vector(),
+                            remove_missing != 0, alt);
+        result->n_eff = test.n_eff();
+        result->estimate = test.estimate();
+        result->statistic = test.statistic();
+        result->p_value = test.p_value();
+    } catch (const std::bad_alloc&) {
+        return WDM_ERROR_OUT_OF_MEMORY;
+    } catch (const std::length_error&) {
+        return WDM_ERROR_OUT_OF_MEMORY;
+    } catch (const std::runtime_error&) {
+        return WDM_ERROR_INVALID_ARGUMENT;
+    } catch (...) {
+        return WDM_ERROR_INTERNAL;
+    }
+
+    return WDM_OK;
+}
+
+} // extern "C"
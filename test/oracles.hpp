@@ -0,0 +1,631 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+#pragma once
+
+// Brute-force reference implementations ("oracles") of all weighted
+// dependence measures and test statistics. They follow the definitions
+// literally, looping over all pairs (or tie groups) of observations, and
+// accumulate in long double. They are meant to be obviously correct, not
+// fast; the differential test compares the library against them.
+
+#include <wdm.hpp>
+#include <wdm/hoeffd.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace oracle {
+
+typedef long double real;
+
+const double nan = std::numeric_limits<double>::quiet_NaN();
+
+inline std::vector<double> default_weights(const std::vector<double>& w,
+                                           size_t n)
+{
+    return w.size() > 0 ? w : std::vector<double>(n, 1.0);
+}
+
+//! removes all observations with a `nan` in x, y, or weights.
+inline void remove_incomplete(std::vector<double>& x,
+                              std::vector<double>& y,
+                              std::vector<double>& w)
+{
+    std::vector<double> xx, yy, ww;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (std::isnan(x[i]) || std::isnan(y[i]))
+            continue;
+        if ((w.size() > 0) && std::isnan(w[i]))
+            continue;
+        xx.push_back(x[i]);
+        yy.push_back(y[i]);
+        if (w.size() > 0)
+            ww.push_back(w[i]);
+    }
+    x = xx;
+    y = yy;
+    w = ww;
+}
+
+//! sum over all pairs i < j of w_i * w_j.
+inline real pair_sum(const std::vector<double>& w)
+{
+    real s = 0;
+    for (size_t i = 0; i < w.size(); i++)
+        for (size_t j = i + 1; j < w.size(); j++)
+            s += static_cast<real>(w[i]) * w[j];
+    return s;
+}
+
+//! sum over all triplets i < j < k of w_i * w_j * w_k.
+inline real triplet_sum(const std::vector<double>& w)
+{
+    real s = 0;
+    for (size_t i = 0; i < w.size(); i++)
+        for (size_t j = i + 1; j < w.size(); j++)
+            for (size_t k = j + 1; k < w.size(); k++)
+                s += static_cast<real>(w[i]) * w[j] * w[k];
+    return s;
+}
+
+//! weights of all observations tied with x[i] (including i itself).
+inline std::vector<double> tie_group(const std::vector<double>& x,
+                                     const std::vector<double>& w,
+                                     size_t i)
+{
+    std::vector<double> g;
+    for (size_t j = 0; j < x.size(); j++) {
+        if (x[j] == x[i])
+            g.push_back(w[j]);
+    }
+    return g;
+}
+
+//! weighted ranks: the (weighted) number of observations strictly smaller,
+//! plus (for `average = true`) the average weighted rank within a tie group.
+inline std::vector<double> rank0(const std::vector<double>& x,
+                                 std::vector<double> w,
+                                 bool average)
+{
+    w = default_weights(w, x.size());
+    std::vector<double> r(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        real below = 0;
+        for (size_t j = 0; j < x.size(); j++) {
+            if (x[j] < x[i])
+                below += w[j];
+        }
+        if (average) {
+            std::vector<double> g = tie_group(x, w, i);
+            real w_g = 0;
+            for (double wg : g)
+                w_g += wg;
+            if ((g.size() > 1) && (w_g > 0))
+                below += pair_sum(g) / w_g;
+        }
+        r[i] = static_cast<double>(below);
+    }
+    return r;
+}
+
+//! whether observation j precedes observation i in the order by (x, y,
+//! index).
+inline bool lex_before(const std::vector<double>& x,
+                       const std::vector<double>& y,
+                       size_t j, size_t i)
+{
+    if (x[j] != x[i])
+        return x[j] < x[i];
+    if (y[j] != y[i])
+        return y[j] < y[i];
+    return j < i;
+}
+
+//! bivariate ranks: the weighted number of observations preceding i in the
+//! order by (x, y, index) that have y_j <= y_i. Without ties, this is the
+//! number of observations with both x_j < x_i and y_j < y_i.
+inline std::vector<double> bivariate_rank(const std::vector<double>& x,
+                                          const std::vector<double>& y,
+                                          std::vector<double> w)
+{
+    w = default_weights(w, x.size());
+    std::vector<double> r(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        real s = 0;
+        for (size_t j = 0; j < x.size(); j++) {
+            if (lex_before(x, y, j, i) && (y[j] <= y[i]))
+                s += w[j];
+        }
+        r[i] = static_cast<double>(s);
+    }
+    return r;
+}
+
+inline double prho(const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   std::vector<double> w)
+{
+    w = default_weights(w, x.size());
+    real sw = 0, mx = 0, my = 0;
+    for (size_t i = 0; i < x.size(); i++) {
+        sw += w[i];
+        mx += static_cast<real>(w[i]) * x[i];
+        my += static_cast<real>(w[i]) * y[i];
+    }
+    mx /= sw;
+    my /= sw;
+    real vx = 0, vy = 0, cov = 0;
+    for (size_t i = 0; i < x.size(); i++) {
+        vx += w[i] * (x[i] - mx) * (x[i] - mx);
+        vy += w[i] * (y[i] - my) * (y[i] - my);
+        cov += w[i] * (x[i] - mx) * (y[i] - my);
+    }
+    return static_cast<double>(cov / std::sqrt(vx * vy));
+}
+
+inline double srho(const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   const std::vector<double>& w)
+{
+    return prho(rank0(x, w, true), rank0(y, w, true), w);
+}
+
+inline int sign(double d)
+{
+    return (d > 0) - (d < 0);
+}
+
+inline double ktau(const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   std::vector<double> w)
+{
+    w = default_weights(w, x.size());
+    real num = 0, pairs = 0, ties_x = 0, ties_y = 0;
+    for (size_t i = 0; i < x.size(); i++) {
+        for (size_t j = i + 1; j < x.size(); j++) {
+            real ww = static_cast<real>(w[i]) * w[j];
+            num += ww * sign(x[i] - x[j]) * sign(y[i] - y[j]);
+            pairs += ww;
+            ties_x += (x[i] == x[j]) ? ww : 0;
+            ties_y += (y[i] == y[j]) ? ww : 0;
+        }
+    }
+    return static_cast<double>(num / std::sqrt((pairs - ties_x) * (pairs - ties_y)));
+}
+
+//! weighted median: the value with average rank equal to the average rank of
+//! all observations, or the midpoint of the two values enclosing it.
+//! Observations with zero weight are ignored.
+inline double median(std::vector<double> x, std::vector<double> w)
+{
+    w = default_weights(w, x.size());
+    // observations with zero weight are ignored
+    std::vector<double> xx, ww;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (w[i] > 0) {
+            xx.push_back(x[i]);
+            ww.push_back(w[i]);
+        }
+    }
+    x = xx;
+    w = ww;
+    real sw = 0;
+    for (double wi : w)
+        sw += wi;
+    if (sw == 0)
+        return nan;
+    std::vector<double> r = rank0(x, w, true);
+    double target = static_cast<double>(pair_sum(w) / sw);
+
+    double below = -std::numeric_limits<double>::infinity();
+    double above = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < x.size(); i++) {
+        if (r[i] == target)
+            return x[i];
+        if (r[i] < target)
+            below = std::max(below, x[i]);
+        else
+            above = std::min(above, x[i]);
+    }
+    return 0.5 * (below + above);
+}
+
+inline double bbeta(const std::vector<double>& x,
+                    const std::vector<double>& y,
+                    std::vector<double> w)
+{
+    w = default_weights(w, x.size());
+    double mx = median(x, w), my = median(y, w);
+    real conc = 0, sw = 0;
+    for (size_t i = 0; i < x.size(); i++) {
+        sw += w[i];
+        if (((x[i] <= mx) && (y[i] <= my)) || ((x[i] > mx) && (y[i] > my)))
+            conc += w[i];
+    }
+    return static_cast<double>(2 * conc / sw - 1);
+}
+
+inline std::vector<double> pow(const std::vector<double>& w, int k)
+{
+    std::vector<double> p(w.size());
+    for (size_t i = 0; i < w.size(); i++)
+        p[i] = std::pow(w[i], k);
+    return p;
+}
+
+//! elementary symmetric polynomial of order k, i.e., the sum over all
+//! k-subsets of the product of their weights (by the subset recursion
+//! e_k(w_1, ..., w_m) = e_k(w_1, ..., w_{m-1}) + w_m e_{k-1}(w_1, ..., w_{m-1})).
+inline real esp(const std::vector<double>& w, size_t k)
+{
+    std::vector<real> e(k + 1, 0);
+    e[0] = 1;
+    for (size_t m = 0; m < w.size(); m++) {
+        for (size_t j = k; j > 0; j--)
+            e[j] += w[m] * e[j - 1];
+    }
+    return e[k];
+}
+
+inline double hoeffd(const std::vector<double>& x,
+                     const std::vector<double>& y,
+                     std::vector<double> w)
+{
+    w = default_weights(w, x.size());
+    std::vector<double> w2 = pow(w, 2), w3 = pow(w, 3), w4 = pow(w, 4);
+    std::vector<double> R_X = rank0(x, w, false), R_Y = rank0(y, w, false);
+    std::vector<double> S_X = rank0(x, w2, false), S_Y = rank0(y, w2, false);
+    std::vector<double> R_XY = bivariate_rank(x, y, w);
+    std::vector<double> S_XY = bivariate_rank(x, y, w2);
+    std::vector<double> T_XY = bivariate_rank(x, y, w3);
+    std::vector<double> U_XY = bivariate_rank(x, y, w4);
+
+    real A_1 = 0, A_2 = 0, A_3 = 0;
+    for (size_t i = 0; i < x.size(); i++) {
+        real rx = R_X[i], ry = R_Y[i], sx = S_X[i], sy = S_Y[i];
+        real rxy = R_XY[i], sxy = S_XY[i], txy = T_XY[i], uxy = U_XY[i];
+        A_1 += (rxy * rxy - sxy) * w[i];
+        A_2 += ((rx * ry - sxy) * rxy - sxy * (rx + ry) + 2 * txy) * w[i];
+        A_3 += ((rx * rx - sx) * (ry * ry - sy) -
+                4 * ((rx * ry - sxy) * sxy - txy * (rx + ry) + 2 * uxy) -
+                2 * (sxy * sxy - uxy)) * w[i];
+    }
+    real D = A_1 / (esp(w, 3) * 6) - 2 * A_2 / (esp(w, 4) * 24) +
+        A_3 / (esp(w, 5) * 120);
+    return static_cast<double>(30 * D);
+}
+
+//! tie statistics of one margin for the variance of Kendall's tau: tied
+//! pairs, tied triplets, and sum over tie groups of t(t - 1)(2t + 5) (in the
+//! weighted analogue).
+struct Margin_ties {
+    real pairs = 0, triplets = 0, v = 0;
+};
+
+inline Margin_ties margin_ties(const std::vector<double>& x,
+                               const std::vector<double>& w)
+{
+    Margin_ties t;
+    std::vector<bool> done(x.size(), false);
+    for (size_t i = 0; i < x.size(); i++) {
+        if (done[i])
+            continue;
+        std::vector<double> g;
+        for (size_t j = i; j < x.size(); j++) {
+            if (x[j] == x[i]) {
+                g.push_back(w[j]);
+                done[j] = true;
+            }
+        }
+        if (g.size() < 2)
+            continue;
+        real s1 = 0;
+        for (double wg : g)
+            s1 += wg;
+        t.pairs += pair_sum(g);
+        t.triplets += triplet_sum(g);
+        t.v += 2 * pair_sum(g) * (2 * s1 + 5);
+    }
+    return t;
+}
+
+//! the factor relating Kendall's tau to its (asymptotically standard normal)
+//! test statistic, accounting for ties.
+inline double ktau_stat_adjust(const std::vector<double>& x,
+                               const std::vector<double>& y,
+                               std::vector<double> w)
+{
+    w = default_weights(w, x.size());
+    Margin_ties tx = margin_ties(x, w), ty = margin_ties(y, w);
+    real s = 0, sq = 0;
+    for (double wi : w) {
+        s += wi;
+        sq += static_cast<real>(wi) * wi;
+    }
+    real s2 = pair_sum(w), s3 = triplet_sum(w);
+    real r = s / sq;
+    real v_0 = 4 * s2 * s * r * r * r;
+    real v_1 = tx.pairs * ty.pairs / s2 * r * r;
+    real v_2 = 2 * tx.triplets * ty.triplets / (3 * s3) * r * r * r;
+    real v = (v_0 - r * r * r * (tx.v + ty.v)) / 18 + (v_1 + v_2);
+    return static_cast<double>(r * r * std::sqrt((s2 - tx.pairs) * (s2 - ty.pairs) / v));
+}
+
+//! whether the method supports the weights (Chatterjee's xi requires all
+//! non-zero weights to be equal).
+inline bool supported(const std::vector<double>& w, const std::string& method)
+{
+    if (!wdm::methods::is_chatterjee(method))
+        return true;
+    double w_0 = 0;
+    for (double wi : w) {
+        if (wi == 0)
+            continue;
+        if (w_0 == 0)
+            w_0 = wi;
+        else if (wi != w_0)
+            return false;
+    }
+    return true;
+}
+
+//! Chatterjee's xi and the statistic factor of its test; observations with
+//! zero weight are dropped, the remaining (equal) weights are irrelevant.
+//! Ties in x are broken by position.
+struct Xi_parts {
+    std::vector<double> x, y;
+    std::vector<real> r, l; // #{j : y_j <= y_i} and #{j : y_j >= y_i}
+};
+
+inline Xi_parts xi_parts(const std::vector<double>& x,
+                         const std::vector<double>& y,
+                         const std::vector<double>& w)
+{
+    Xi_parts p;
+    for (size_t i = 0; i < x.size(); i++) {
+        if ((w.size() == 0) || (w[i] != 0)) {
+            p.x.push_back(x[i]);
+            p.y.push_back(y[i]);
+        }
+    }
+    size_t n = p.x.size();
+    p.r.assign(n, 0);
+    p.l.assign(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            p.r[i] += (p.y[j] <= p.y[i]);
+            p.l[i] += (p.y[j] >= p.y[i]);
+        }
+    }
+    return p;
+}
+
+inline double xi(const std::vector<double>& x,
+                 const std::vector<double>& y,
+                 const std::vector<double>& w)
+{
+    Xi_parts p = xi_parts(x, y, w);
+    size_t n = p.x.size();
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&] (size_t i, size_t j) {
+        return p.x[i] < p.x[j];
+    });
+    real s = 0, cu = 0;
+    for (size_t k = 1; k < n; k++)
+        s += std::abs(p.r[order[k]] - p.r[order[k - 1]]);
+    for (size_t i = 0; i < n; i++)
+        cu += p.l[i] * (n - p.l[i]);
+    return static_cast<double>(1 - n * s / (2 * cu));
+}
+
+// asymptotic variance of sqrt(n) * xi under independence (Chatterjee, 2021,
+// Theorem 2.2), written with the sorted values F_(1) <= ... <= F_(n) of the
+// empirical cdf of y.
+inline double xi_stat_adjust(const std::vector<double>& x,
+                             const std::vector<double>& y,
+                             const std::vector<double>& w)
+{
+    Xi_parts p = xi_parts(x, y, w);
+    real n = p.x.size();
+    std::vector<real> f(p.r);
+    std::sort(f.begin(), f.end());
+    real cu = 0;
+    for (size_t i = 0; i < f.size(); i++) {
+        f[i] /= n;
+        real g = p.l[i] / n;
+        cu += g * (1 - g) / n;
+    }
+    real a = 0, b = 0, c = 0;
+    for (size_t i = 1; i <= f.size(); i++) {
+        a += (2 * n - 2 * i + 1) * f[i - 1] * f[i - 1] / (n * n);
+        c += (2 * n - 2 * i + 1) * f[i - 1] / (n * n);
+        real m = (n - i) * f[i - 1];
+        for (size_t k = 1; k <= i; k++)
+            m += f[k - 1];
+        b += (m / n) * (m / n) / n;
+    }
+    real v = (a - 2 * b + c * c) / (cu * cu);
+    return static_cast<double>(std::sqrt(n / v));
+}
+
+//! distance covariance by explicit double centering of the distance
+//! matrices, and its building blocks.
+struct Dcor_parts {
+    real dcov2 = 0, dvar_x = 0, dvar_y = 0, a_mean = 0, b_mean = 0;
+};
+
+inline Dcor_parts dcor_parts(const std::vector<double>& x,
+                             const std::vector<double>& y,
+                             std::vector<double> w)
+{
+    size_t n = x.size();
+    w = default_weights(w, n);
+    real w_sum = 0;
+    for (double wi : w)
+        w_sum += wi;
+    std::vector<real> p(n), a_row(n, 0), b_row(n, 0);
+    for (size_t i = 0; i < n; i++)
+        p[i] = w[i] / w_sum;
+    auto a = [&] (size_t i, size_t j) { return std::abs(static_cast<real>(x[i]) - x[j]); };
+    auto b = [&] (size_t i, size_t j) { return std::abs(static_cast<real>(y[i]) - y[j]); };
+
+    Dcor_parts d;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            a_row[i] += p[j] * a(i, j);
+            b_row[i] += p[j] * b(i, j);
+        }
+        d.a_mean += p[i] * a_row[i];
+        d.b_mean += p[i] * b_row[i];
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            real aa = a(i, j) - a_row[i] - a_row[j] + d.a_mean;
+            real bb = b(i, j) - b_row[i] - b_row[j] + d.b_mean;
+            d.dcov2 += p[i] * p[j] * aa * bb;
+            d.dvar_x += p[i] * p[j] * aa * aa;
+            d.dvar_y += p[i] * p[j] * bb * bb;
+        }
+    }
+    return d;
+}
+
+inline double dcor(const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   const std::vector<double>& w)
+{
+    Dcor_parts d = dcor_parts(x, y, w);
+    if ((d.dvar_x == 0) || (d.dvar_y == 0))
+        return nan;
+    return static_cast<double>(std::sqrt(d.dcov2 / std::sqrt(d.dvar_x * d.dvar_y)));
+}
+
+inline double dcor_stat_adjust(const std::vector<double>& x,
+                               const std::vector<double>& y,
+                               const std::vector<double>& w,
+                               double n_eff)
+{
+    Dcor_parts d = dcor_parts(x, y, w);
+    return static_cast<double>(
+        std::sqrt(n_eff * std::sqrt(d.dvar_x * d.dvar_y) / (d.a_mean * d.b_mean)));
+}
+
+//! hyperbolic weighted tau: pairs (a, b) have weight w_a w_b (h_a + h_b),
+//! with h = 1 / (r + 1) for the decreasing lexicographic rank r by (u, v);
+//! the result averages the ranks by (x, y) and by (y, x).
+inline real htau_ranked(const std::vector<double>& x,
+                        const std::vector<double>& y,
+                        const std::vector<double>& w,
+                        const std::vector<double>& u,
+                        const std::vector<double>& v)
+{
+    size_t n = x.size();
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&] (size_t i, size_t j) {
+        return (u[i] > u[j]) || ((u[i] == u[j]) && (v[i] > v[j]));
+    });
+    std::vector<real> h(n);
+    for (size_t r = 0; r < n; r++)
+        h[order[r]] = 1 / (r + static_cast<real>(1));
+
+    real num = 0, den_x = 0, den_y = 0;
+    for (size_t a = 0; a < n; a++) {
+        for (size_t b = a + 1; b < n; b++) {
+            real pw = static_cast<real>(w[a]) * w[b] * (h[a] + h[b]);
+            num += sign(x[a] - x[b]) * sign(y[a] - y[b]) * pw;
+            den_x += (x[a] != x[b]) * pw;
+            den_y += (y[a] != y[b]) * pw;
+        }
+    }
+    return num / std::sqrt(den_x * den_y);
+}
+
+inline double htau(const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   std::vector<double> w)
+{
+    w = default_weights(w, x.size());
+    return static_cast<double>(
+        (htau_ranked(x, y, w, x, y) + htau_ranked(x, y, w, y, x)) / 2);
+}
+
+inline double estimate(const std::vector<double>& x,
+                       const std::vector<double>& y,
+                       const std::vector<double>& w,
+                       const std::string& method)
+{
+    if (wdm::methods::is_pearson(method))
+        return prho(x, y, w);
+    if (wdm::methods::is_spearman(method))
+        return srho(x, y, w);
+    if (wdm::methods::is_kendall(method))
+        return ktau(x, y, w);
+    if (wdm::methods::is_blomqvist(method))
+        return bbeta(x, y, w);
+    if (wdm::methods::is_hoeffding(method))
+        return hoeffd(x, y, w);
+    if (wdm::methods::is_chatterjee(method))
+        return xi(x, y, w);
+    if (wdm::methods::is_dcor(method))
+        return dcor(x, y, w);
+    if (wdm::methods::is_htau(method))
+        return htau(x, y, w);
+    return nan;
+}
+
+inline double n_eff(const std::vector<double>& w, size_t n)
+{
+    if (w.size() == 0)
+        return static_cast<double>(n);
+    real s = 0, sq = 0;
+    for (double wi : w) {
+        s += wi;
+        sq += static_cast<real>(wi) * wi;
+    }
+    return static_cast<double>(s * s / sq);
+}
+
+inline double statistic(double est,
+                        const std::vector<double>& x,
+                        const std::vector<double>& y,
+                        const std::vector<double>& w,
+                        const std::string& method)
+{
+    double n = n_eff(w, x.size());
+    // the test statistics for transformed measures are truncated to avoid
+    // infinite values for perfect dependence.
+    double est_t = std::max(-1 + 1e-12, std::min(1 - 1e-12, est));
+    if (wdm::methods::is_pearson(method))
+        return std::atanh(est_t) * std::sqrt(n - 3);
+    if (wdm::methods::is_spearman(method))
+        return std::atanh(est_t) * std::sqrt((n - 3) / 1.06);
+    if (wdm::methods::is_kendall(method))
+        return est * ktau_stat_adjust(x, y, w);
+    if (wdm::methods::is_blomqvist(method))
+        return std::atanh(est_t) * std::sqrt(n);
+    if (wdm::methods::is_hoeffding(method))
+        return est / 30.0 + 1.0 / (36.0 * n);
+    if (wdm::methods::is_chatterjee(method))
+        return est * xi_stat_adjust(x, y, w);
+    if (wdm::methods::is_dcor(method))
+        return est * dcor_stat_adjust(x, y, w, n);
+    return nan;
+}
+
+inline double p_value(double stat, double n, const std::string& method)
+{
+    if (wdm::methods::is_hoeffding(method))
+        return wdm::impl::phoeffb(stat, n);
+    return std::erfc(std::abs(stat) / std::sqrt(2.0));
+}
+
+}
@@ -0,0 +1,184 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Tests of the asynchronous interface: results of futures and callbacks are
+// compared to the synchronous functions, errors must be forwarded, and
+// tasks must run on the installed executor. Tests shared between threads
+// must compute their statistics once. Loops on a thread pool must visit
+// every index once.
+
+#include <wdm/async.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace {
+
+size_t failures = 0;
+
+void expect(bool ok, const std::string& what)
+{
+    if (!ok) {
+        std::cout << "FAILED " << what << std::endl;
+        failures++;
+    }
+}
+
+std::vector<double> simulate(size_t n, std::mt19937& gen)
+{
+    std::normal_distribution<double> normal;
+    std::vector<double> x(n);
+    for (auto& xi : x)
+        xi = normal(gen);
+    return x;
+}
+
+// counts the tasks it forwards to a thread pool.
+class Counting_executor : public wdm::Executor {
+public:
+    Counting_executor() : pool_(2), count(0) {}
+
+    void submit(std::function<void()> task) override
+    {
+        count++;
+        pool_.submit(std::move(task));
+    }
+
+private:
+    wdm::Thread_pool pool_;
+
+public:
+    std::atomic<size_t> count;
+};
+
+void test_futures()
+{
+    std::mt19937 gen(1);
+    std::vector<std::vector<double>> xs, ys;
+    std::vector<std::future<double>> estimates;
+    std::vector<std::future<wdm::Test_result>> tests;
+    for (size_t k = 0; k < 50; k++) {
+        xs.push_back(simulate(500, gen));
+        ys.push_back(simulate(500, gen));
+        estimates.push_back(wdm::wdm_async(xs[k], ys[k], "kendall"));
+        tests.push_back(wdm::indep_test_async(xs[k], ys[k], "spearman"));
+    }
+    for (size_t k = 0; k < 50; k++) {
+        expect(estimates[k].get() == wdm::wdm(xs[k], ys[k], "kendall"),
+               "future: estimate differs from wdm()");
+        wdm::Indep_test test(xs[k], ys[k], "spearman");
+        expect(tests[k].get().p_value == test.p_value(),
+               "future: test differs from Indep_test");
+    }
+
+    auto failed = wdm::wdm_async(xs[0], ys[0], "unknown");
+    bool thrown = false;
+    try {
+        failed.get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    expect(thrown, "future: error not forwarded");
+}
+
+void test_callbacks()
+{
+    auto executor = std::make_shared<Counting_executor>();
+    wdm::set_executor(executor);
+
+    std::mt19937 gen(2);
+    std::vector<double> x = simulate(300, gen), y = simulate(300, gen);
+    std::promise<double> estimate;
+    std::promise<bool> error;
+    std::promise<double> p_value;
+    wdm::wdm_async(x, y, "pearson", {}, true,
+                   [&] (double est, std::exception_ptr) {
+                       estimate.set_value(est);
+                   });
+    wdm::wdm_async(x, {}, "pearson", {}, true,
+                   [&] (double est, std::exception_ptr e) {
+                       error.set_value(std::isnan(est) && e);
+                   });
+    wdm::indep_test_async(x, y, "kendall", {}, true, "less",
+                          [&] (wdm::Test_result res, std::exception_ptr) {
+                              p_value.set_value(res.p_value);
+                          });
+
+    expect(estimate.get_future().get() == wdm::wdm(x, y, "pearson"),
+           "callback: estimate differs from wdm()");
+    expect(error.get_future().get(), "callback: error not forwarded");
+    expect(p_value.get_future().get() ==
+               wdm::Indep_test(x, y, "kendall", {}, true, "less").p_value(),
+           "callback: test differs from Indep_test");
+    expect(executor->count == 3, "callback: tasks not run on the executor");
+
+    wdm::set_executor(nullptr);
+    expect(wdm::get_executor() != executor, "executor not reset");
+}
+
+void test_shared_test()
+{
+    std::mt19937 gen(3);
+    std::vector<double> x = simulate(500, gen), y = simulate(500, gen);
+    for (std::string method : {"kendall", "chatterjee", "dcor"}) {
+        const wdm::Indep_test test(x, y, method);
+        const wdm::Indep_test copy = test;
+        std::vector<double> p_values(4);
+        std::vector<std::thread> threads;
+        for (size_t k = 0; k < p_values.size(); k++)
+            threads.emplace_back([&, k] { p_values[k] = test.p_value(); });
+        for (auto& thread : threads)
+            thread.join();
+        double expected = wdm::Indep_test(x, y, method).p_value();
+        for (double p : p_values)
+            expect(p == expected, "shared test: " + method);
+        expect(copy.statistic() == test.statistic(), "copied test: " + method);
+    }
+}
+
+void test_pool_loops()
+{
+    // the same pool runs many loops; every index is visited exactly once.
+    wdm::Thread_pool pool(3);
+    for (size_t n : {0, 1, 5, 100, 1000}) {
+        std::vector<std::atomic<size_t>> visits(n);
+        for (auto& v : visits)
+            v = 0;
+        for (size_t loop = 0; loop < 20; loop++) {
+            wdm::utils::parallel_for(0, n, [&] (size_t i) { visits[i]++; },
+                                     pool, 4);
+        }
+        bool ok = true;
+        for (auto& v : visits)
+            ok = ok && (v == 20);
+        expect(ok, "pool loop visits with n = " + std::to_string(n));
+    }
+
+    bool thrown = false;
+    try {
+        wdm::utils::parallel_for(0, 100, [] (size_t i) {
+            if (i == 57)
+                throw std::runtime_error("index 57");
+        }, pool);
+    } catch (const std::runtime_error& e) {
+        thrown = (std::string(e.what()) == "index 57");
+    }
+    expect(thrown, "pool loop errors are rethrown");
+}
+
+}
+
+int main()
+{
+    test_futures();
+    test_callbacks();
+    test_shared_test();
+    test_pool_loops();
+    if (failures == 0)
+        std::cout << "all async tests passed." << std::endl;
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+/* Copyright © 2020 Thomas Nagler
+ *
+ * This file is part of the wdm library and licensed under the terms of
+ * the MIT license. For a copy, see the LICENSE file in the root directory
+ * or https://github.com/tnagler/wdm/blob/master/LICENSE.
+ */
+
+/* Tests of the C interface (compiled as C): strided inputs must give the
+ * same results as contiguous ones, the matrix and test functions must agree
+ * with wdm_compute(), and every error must be reported by its status code.
+ */
+
+#include <wdm_c.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N 30
+#define D 3
+
+static size_t failures = 0;
+
+static void expect(int ok, const char* what)
+{
+    if (!ok) {
+        printf("FAILED %s\n", what);
+        failures++;
+    }
+}
+
+static int close_to(double a, double b)
+{
+    return fabs(a - b) <= 1e-12 * (1.0 + fabs(b));
+}
+
+static const wdm_method methods[] = {
+    WDM_PEARSON, WDM_SPEARMAN, WDM_KENDALL, WDM_BLOMQVIST, WDM_HOEFFDING,
+    WDM_CHATTERJEE, WDM_DCOR, WDM_HTAU
+};
+static const size_t num_methods = sizeof(methods) / sizeof(methods[0]);
+
+/* column-major data with ties and dependence between the columns. */
+static double data[N * D];
+static double weights[N];
+
+static void simulate(void)
+{
+    unsigned long state = 12345;
+    size_t i, j;
+    for (i = 0; i < N; i++) {
+        double z;
+        state = (1103515245 * state + 12345) % 2147483648UL;
+        z = (double) state / 2147483648.0;
+        for (j = 0; j < D; j++) {
+            state = (1103515245 * state + 12345) % 2147483648UL;
+            data[i + j * N] = z + (double) state / 2147483648.0;
+        }
+        data[i + 2 * N] = floor(4 * data[i + 2 * N]);
+        weights[i] = 0.5 + (double) (i % 4) / 4;
+    }
+}
+
+static void test_strides(void)
+{
+    double x[3 * N], y[N], w[2 * N], r1, r2, r3, r4;
+    size_t i, k;
+    for (i = 0; i < N; i++) {
+        x[3 * i] = data[i];
+        x[3 * i + 1] = x[3 * i + 2] = NAN;
+        y[N - 1 - i] = data[i + N];
+        w[2 * i] = weights[i];
+        w[2 * i + 1] = NAN;
+    }
+    for (k = 0; k < num_methods; k++) {
+        wdm_status s1 = wdm_compute(N, data, 1, data + N, 1, NULL, 1,
+                                    methods[k], 1, &r1);
+        wdm_status s2 = wdm_compute(N, x, 3, y + N - 1, -1, NULL, 1,
+                                    methods[k], 1, &r2);
+        wdm_status s3 = wdm_compute(N, data, 1, data + N, 1, weights, 1,
+                                    methods[k], 1, &r3);
+        wdm_status s4 = wdm_compute(N, x, 3, y + N - 1, -1, w, 2,
+                                    methods[k], 0, &r4);
+        expect((s1 == WDM_OK) && (s2 == WDM_OK), "strided status");
+        expect(r1 == r2, "strided estimate");
+        if (methods[k] == WDM_CHATTERJEE) {
+            expect(s3 == WDM_ERROR_INVALID_ARGUMENT, "xi with weights");
+        } else {
+            expect((s3 == WDM_OK) && !isnan(r3), "weighted estimate");
+            expect((s4 == WDM_OK) && (r3 == r4), "strided weights");
+        }
+    }
+}
+
+static void test_matrix(void)
+{
+    double row_major[N * D], result[D * 4], result_rm[D * 4], r;
+    size_t i, j, k;
+    for (i = 0; i < N; i++) {
+        for (j = 0; j < D; j++)
+            row_major[i * D + j] = data[i + j * N];
+    }
+    for (k = 0; k < num_methods; k++) {
+        const double* w = (methods[k] == WDM_CHATTERJEE) ? NULL : weights;
+        expect(wdm_compute_matrix(N, D, data, 1, N, w, 1, methods[k], 1,
+                                  result, 4, 1) == WDM_OK,
+               "matrix status");
+        expect(wdm_compute_matrix(N, D, row_major, D, 1, w, 1, methods[k], 1,
+                                  result_rm, 4, 2) == WDM_OK,
+               "matrix status (row-major, 2 threads)");
+        for (i = 0; i < D; i++) {
+            for (j = 0; j < D; j++) {
+                wdm_compute(N, data + i * N, 1, data + j * N, 1, w, 1,
+                            methods[k], 1, &r);
+                expect(close_to(result[i * 4 + j], r), "matrix entry");
+                expect(result_rm[i * 4 + j] == result[i * 4 + j],
+                       "matrix layout and threads");
+            }
+        }
+    }
+    wdm_compute_matrix(N, D, data, 1, N, NULL, 1, WDM_KENDALL, 1, result, 4, 0);
+    expect((result[0] == 1.0) && (result[5] == 1.0) && (result[10] == 1.0),
+           "matrix diagonal");
+}
+
+static void test_indep_test(void)
+{
+    wdm_test_result res;
+    double r;
+    size_t k;
+    for (k = 0; k < num_methods; k++) {
+        wdm_status s = wdm_indep_test(N, data, 1, data + N, 1, NULL, 1,
+                                      methods[k], 1, WDM_TWO_SIDED, &res);
+        if (methods[k] == WDM_HTAU) {
+            expect(s == WDM_ERROR_INVALID_ARGUMENT, "no test for htau");
+            continue;
+        }
+        wdm_compute(N, data, 1, data + N, 1, NULL, 1, methods[k], 1, &r);
+        expect(s == WDM_OK, "test status");
+        expect(res.estimate == r, "test estimate");
+        expect(res.n_eff == N, "test n_eff");
+        expect(!isnan(res.statistic), "test statistic");
+        expect((res.p_value >= 0) && (res.p_value <= 1), "test p-value");
+    }
+    expect(wdm_indep_test(N, data, 1, data + N, 1, weights, 1, WDM_KENDALL, 1,
+                          WDM_GREATER, &res) == WDM_OK,
+           "one-sided weighted test");
+}
+
+static void test_errors(void)
+{
+    double x[N], r, result[D * D];
+    wdm_test_result res;
+    size_t i;
+    int distinct = 1;
+    memcpy(x, data, sizeof(x));
+    x[3] = NAN;
+
+    /* NULL pointers (weights are optional) */
+    expect(wdm_compute(N, NULL, 1, data, 1, NULL, 1, WDM_KENDALL, 1, &r) ==
+           WDM_ERROR_NULL_POINTER, "NULL x");
+    expect(wdm_compute(N, data, 1, NULL, 1, NULL, 1, WDM_KENDALL, 1, &r) ==
+           WDM_ERROR_NULL_POINTER, "NULL y");
+    expect(wdm_compute(N, data, 1, data, 1, NULL, 1, WDM_KENDALL, 1, NULL) ==
+           WDM_ERROR_NULL_POINTER, "NULL result");
+    expect(wdm_compute_matrix(N, D, NULL, 1, N, NULL, 1, WDM_KENDALL, 1,
+                              result, D, 1) == WDM_ERROR_NULL_POINTER,
+           "NULL data");
+    expect(wdm_compute_matrix(N, D, data, 1, N, NULL, 1, WDM_KENDALL, 1,
+                              NULL, D, 1) == WDM_ERROR_NULL_POINTER,
+           "NULL matrix result");
+    expect(wdm_indep_test(N, NULL, 1, data, 1, NULL, 1, WDM_KENDALL, 1,
+                          WDM_TWO_SIDED, &res) == WDM_ERROR_NULL_POINTER,
+           "NULL x in test");
+    expect(wdm_indep_test(N, data, 1, data, 1, NULL, 1, WDM_KENDALL, 1,
+                          WDM_TWO_SIDED, NULL) == WDM_ERROR_NULL_POINTER,
+           "NULL test result");
+
+    /* invalid arguments */
+    expect(wdm_compute(N, data, 1, data, 1, NULL, 1, (wdm_method) 99, 1, &r) ==
+           WDM_ERROR_INVALID_ARGUMENT, "invalid method");
+    expect(wdm_compute(1, data, 1, data, 1, NULL, 1, WDM_KENDALL, 0, &r) ==
+           WDM_ERROR_INVALID_ARGUMENT, "too few observations");
+    expect(wdm_compute_matrix(N, D, data, 1, N, NULL, 1, WDM_KENDALL, 1,
+                              result, D - 1, 1) == WDM_ERROR_INVALID_ARGUMENT,
+           "leading dimension");
+    expect(wdm_indep_test(N, data, 1, data, 1, NULL, 1, WDM_KENDALL, 1,
+                          (wdm_alternative) 99, &res) ==
+           WDM_ERROR_INVALID_ARGUMENT, "invalid alternative");
+    expect(wdm_indep_test(N, data, 1, data, 1, NULL, 1, WDM_HOEFFDING, 1,
+                          WDM_GREATER, &res) == WDM_ERROR_INVALID_ARGUMENT,
+           "one-sided Hoeffding");
+
+    /* missing values */
+    expect(wdm_compute(N, x, 1, data, 1, NULL, 1, WDM_KENDALL, 0, &r) ==
+           WDM_ERROR_MISSING_VALUES, "missing values");
+    expect(wdm_compute_matrix(N, 1, x, 1, N, NULL, 1, WDM_KENDALL, 0,
+                              result, 1, 1) == WDM_ERROR_MISSING_VALUES,
+           "missing values in matrix");
+    expect(wdm_indep_test(N, data, 1, x, 1, NULL, 1, WDM_KENDALL, 0,
+                          WDM_TWO_SIDED, &res) == WDM_ERROR_MISSING_VALUES,
+           "missing values in test");
+    expect((wdm_compute(N, x, 1, data, 1, NULL, 1, WDM_KENDALL, 1, &r) ==
+            WDM_OK) && !isnan(r), "removed missing values");
+
+    /* inputs too large to copy */
+    expect(wdm_compute((size_t) 1 << 50, data, 2, data, 2, NULL, 1,
+                       WDM_KENDALL, 1, &r) == WDM_ERROR_OUT_OF_MEMORY,
+           "out of memory");
+
+    /* messages; WDM_ERROR_INTERNAL is not reachable with valid calls */
+    for (i = WDM_OK; i <= WDM_ERROR_INTERNAL; i++) {
+        const char* msg = wdm_status_message((wdm_status) i);
+        expect((msg != NULL) && (strlen(msg) > 0), "status message");
+        if (i > 0)
+            distinct &= strcmp(msg, wdm_status_message((wdm_status) (i - 1))) != 0;
+    }
+    expect(distinct, "distinct status messages");
+    expect(strcmp(wdm_status_message((wdm_status) 99), "unknown status") == 0,
+           "unknown status");
+}
+
+int main(void)
+{
+    simulate();
+    test_strides();
+    test_matrix();
+    test_indep_test();
+    test_errors();
+    if (failures == 0)
+        printf("all C interface tests passed.\n");
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
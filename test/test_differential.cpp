@@ -0,0 +1,676 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Randomized differential test: compares all measures, test statistics,
+// and ranking utilities against the brute-force oracles in `oracles.hpp`
+// on inputs with ties, missing values, zero weights, duplicate rows,
+// extreme values, and constant variables. Failing cases are minimized
+// before they are reported.
+//
+// Usage: test_differential [iterations] [seed]
+
+#include "oracles.hpp"
+#include <wdm.hpp>
+#include <wdm/acf.hpp>
+#include <wdm/codes.hpp>
+#include <wdm/grouped.hpp>
+#include <wdm/parallel.hpp>
+#include <wdm/sparse.hpp>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+struct Case {
+    std::vector<double> x, y, w;
+};
+
+const std::vector<std::string> methods = {
+    "pearson", "spearman", "kendall", "blomqvist", "hoeffding", "chatterjee",
+    "dcor", "htau"
+};
+
+const std::vector<std::string> scenarios = {
+    "continuous", "ties", "missing", "zero_weights", "duplicates", "extremes",
+    "constant"
+};
+
+class Generator {
+public:
+    explicit Generator(unsigned seed) : gen_(seed) {}
+
+    Case draw(const std::string& scenario)
+    {
+        size_t n = uniform_int(0, 40);
+        if (uniform() < 0.1)
+            n = uniform_int(40, 80);
+
+        Case c;
+        double rho = 2 * uniform() - 1;
+        for (size_t i = 0; i < n; i++) {
+            double z1 = normal(), z2 = normal();
+            c.x.push_back(z1);
+            c.y.push_back(rho * z1 + std::sqrt(1 - rho * rho) * z2);
+        }
+        if (uniform() < 0.7) {
+            // dyadic weights keep weighted ranks exact, which is required to
+            // reproduce the median of Blomqvist's beta.
+            for (size_t i = 0; i < n; i++)
+                c.w.push_back(uniform_int(1, 16) / 8.0);
+        }
+
+        if (scenario == "ties") {
+            double levels_x = uniform_int(1, 6), levels_y = uniform_int(1, 6);
+            for (size_t i = 0; i < n; i++) {
+                c.x[i] = std::round(c.x[i] * levels_x);
+                c.y[i] = std::round(c.y[i] * levels_y);
+            }
+        } else if (scenario == "missing") {
+            double p = uniform() * 0.5;
+            for (size_t i = 0; i < n; i++) {
+                if (uniform() < p)
+                    c.x[i] = oracle::nan;
+                if (uniform() < p)
+                    c.y[i] = oracle::nan;
+                if ((c.w.size() > 0) && (uniform() < p / 4))
+                    c.w[i] = oracle::nan;
+            }
+        } else if (scenario == "zero_weights") {
+            if (c.w.size() == 0)
+                c.w.assign(n, 1.0);
+            double p = uniform();
+            for (size_t i = 0; i < n; i++) {
+                if (uniform() < p)
+                    c.w[i] = 0.0;
+                if (uniform() < 0.3)
+                    c.x[i] = std::round(c.x[i]);
+            }
+        } else if (scenario == "duplicates") {
+            for (size_t i = 0, m = n; i < m; i++) {
+                if (uniform() < 0.4) {
+                    c.x.push_back(c.x[i]);
+                    c.y.push_back(c.y[i]);
+                    if (c.w.size() > 0)
+                        c.w.push_back(c.w[i]);
+                }
+            }
+        } else if (scenario == "constant") {
+            // weighted means of a constant are not exact in floating point.
+            double value = normal() * std::pow(10.0, uniform_int(0, 20) - 10.0);
+            c.y.assign(n, value);
+            if (uniform() < 0.5)
+                std::swap(c.x, c.y);
+        } else if (scenario == "extremes") {
+            double scale_x = std::pow(10.0, uniform_int(0, 200) - 100.0);
+            double scale_y = std::pow(10.0, uniform_int(0, 200) - 100.0);
+            for (size_t i = 0; i < n; i++) {
+                c.x[i] *= scale_x;
+                c.y[i] *= scale_y;
+                if (uniform() < 0.05)
+                    c.x[i] *= 1e6;
+                if (uniform() < 0.05)
+                    c.y[i] = -1e6 * scale_y;
+            }
+        }
+
+        return c;
+    }
+
+private:
+    double uniform()
+    {
+        return std::uniform_real_distribution<double>(0, 1)(gen_);
+    }
+
+    size_t uniform_int(size_t a, size_t b)
+    {
+        return std::uniform_int_distribution<size_t>(a, b)(gen_);
+    }
+
+    double normal()
+    {
+        return std::normal_distribution<double>(0, 1)(gen_);
+    }
+
+    std::mt19937 gen_;
+};
+
+bool close(double actual, double expected, double tol)
+{
+    if (std::isnan(expected) || std::isnan(actual))
+        return std::isnan(expected) && std::isnan(actual);
+    if (std::isinf(expected) || std::isinf(actual))
+        return actual == expected;
+    return std::abs(actual - expected) <= tol * std::max(1.0, std::abs(expected));
+}
+
+bool close(const std::vector<double>& actual,
+           const std::vector<double>& expected,
+           double tol)
+{
+    if (actual.size() != expected.size())
+        return false;
+    for (size_t i = 0; i < actual.size(); i++) {
+        if (!close(actual[i], expected[i], tol))
+            return false;
+    }
+    return true;
+}
+
+// A check returns an empty string on success and a description of the
+// mismatch otherwise.
+typedef std::function<std::string(const Case&)> Check;
+
+std::string describe(double actual, double expected)
+{
+    std::stringstream msg;
+    msg.precision(17);
+    msg << "expected " << expected << ", got " << actual;
+    return msg.str();
+}
+
+std::string describe(const std::vector<double>& actual,
+                     const std::vector<double>& expected)
+{
+    std::stringstream msg;
+    msg.precision(17);
+    msg << "expected {";
+    for (double e : expected)
+        msg << e << ", ";
+    msg << "}, got {";
+    for (double a : actual)
+        msg << a << ", ";
+    msg << "}";
+    return msg.str();
+}
+
+std::string check_estimate(const Case& c, const std::string& method)
+{
+    Case cc = c;
+    oracle::remove_incomplete(cc.x, cc.y, cc.w);
+    if (!oracle::supported(cc.w, method)) {
+        try {
+            wdm::wdm(c.x, c.y, method, c.w);
+        } catch (const std::runtime_error&) {
+            return "";
+        }
+        return "expected an error for unsupported weights";
+    }
+    double expected = oracle::nan;
+    if (cc.x.size() >= wdm::methods::get_min_nobs(method))
+        expected = oracle::estimate(cc.x, cc.y, cc.w, method);
+    double actual = wdm::wdm(c.x, c.y, method, c.w);
+    return close(actual, expected, 1e-9) ? "" : describe(actual, expected);
+}
+
+std::string check_test(const Case& c, const std::string& method)
+{
+    Case cc = c;
+    oracle::remove_incomplete(cc.x, cc.y, cc.w);
+    if (!oracle::supported(cc.w, method))
+        return "";
+    if (!wdm::methods::has_indep_test(method)) {
+        try {
+            wdm::Indep_test test(c.x, c.y, method, c.w);
+        } catch (const std::runtime_error&) {
+            return "";
+        }
+        if (cc.x.size() < wdm::methods::get_min_nobs(method))
+            return "";
+        return "expected an error for a method without test";
+    }
+    wdm::Indep_test test(c.x, c.y, method, c.w);
+    if (cc.x.size() < wdm::methods::get_min_nobs(method) ||
+        std::isnan(test.estimate()))
+        return "";
+
+    // the statistic is a function of the estimate, which is checked
+    // separately; use the library's estimate to avoid amplifying rounding
+    // errors through atanh().
+    double stat = oracle::statistic(test.estimate(), cc.x, cc.y, cc.w, method);
+    if (!close(test.statistic(), stat, 1e-7))
+        return "statistic: " + describe(test.statistic(), stat);
+    double n_eff = oracle::n_eff(cc.w, cc.x.size());
+    double p = oracle::p_value(test.statistic(), n_eff, method);
+    if (!close(test.p_value(), p, 1e-9))
+        return "p-value: " + describe(test.p_value(), p);
+
+    // tests from the estimate (and tie statistics) must agree.
+    if (!wdm::methods::is_chatterjee(method) && !wdm::methods::is_dcor(method)) {
+        wdm::Indep_test from_est(test.estimate(), method, cc.x.size(), cc.w,
+                                 "two-sided", wdm::margin_ties(cc.x, cc.w),
+                                 wdm::margin_ties(cc.y, cc.w));
+        if (!close(from_est.statistic(), test.statistic(), 1e-12))
+            return "from estimate: " + describe(from_est.statistic(),
+                                                test.statistic());
+    }
+    return "";
+}
+
+// the lag functions must agree with `wdm()` on shifted copies of the series.
+std::string check_ccf(const Case& c, const std::string& method)
+{
+    size_t n = c.x.size();
+    if (n == 0)
+        return "";
+    size_t max_lag = std::min(n - 1, static_cast<size_t>(4));
+    // a pair has the product of its observations' weights; Chatterjee's xi
+    // would reject most of them.
+    std::vector<double> w;
+    if (!wdm::methods::is_chatterjee(method))
+        w = c.w;
+    auto pair_weights = [&] (size_t x_first, size_t y_first, size_t len) {
+        std::vector<double> pw;
+        for (size_t t = 0; t < w.size() && t < len; t++)
+            pw.push_back(w[x_first + t] * w[y_first + t]);
+        return pw;
+    };
+    std::vector<double> ccf = wdm::wdm_ccf(c.x, c.y, max_lag, method, w);
+    std::vector<double> expected;
+    for (size_t i = 0; i <= 2 * max_lag; i++) {
+        size_t x_first = (i < max_lag) ? max_lag - i : 0;
+        size_t y_first = (i < max_lag) ? 0 : i - max_lag;
+        size_t len = n - x_first - y_first;
+        expected.push_back(wdm::wdm(
+            std::vector<double>(c.x.begin() + x_first, c.x.begin() + x_first + len),
+            std::vector<double>(c.y.begin() + y_first, c.y.begin() + y_first + len),
+            method,
+            pair_weights(x_first, y_first, len)));
+    }
+    if (!close(ccf, expected, 1e-9))
+        return "ccf: " + describe(ccf, expected);
+    // few lags are computed directly; check the FFT path separately.
+    if (wdm::methods::is_pearson(method) &&
+        wdm::impl::prho_ccf_applicable(c.x, c.y, w, max_lag)) {
+        ccf = wdm::impl::prho_ccf(c.x, c.y, max_lag, w);
+        if (!close(ccf, expected, 1e-9))
+            return "prho_ccf: " + describe(ccf, expected);
+    }
+
+    std::vector<double> acf = wdm::wdm_acf(c.x, max_lag, method, w);
+    expected.clear();
+    for (size_t k = 0; k <= max_lag; k++) {
+        expected.push_back(wdm::wdm(
+            std::vector<double>(c.x.begin(), c.x.end() - k),
+            std::vector<double>(c.x.begin() + k, c.x.end()),
+            method,
+            pair_weights(0, k, n - k)));
+    }
+    return close(acf, expected, 1e-9) ? "" : "acf: " + describe(acf, expected);
+}
+
+// the grouped computations must agree with `wdm()` and `Indep_test` on each
+// group.
+std::string check_grouped(const Case& c, const std::string& method)
+{
+    size_t n = c.x.size();
+    std::vector<int> groups(n);
+    for (size_t i = 0; i < n; i++)
+        groups[i] = static_cast<int>((i * 7) % 3);
+
+    bool with_test = wdm::methods::has_indep_test(method);
+    std::vector<Case> cases;
+    std::vector<double> expected;
+    try {
+        for (int g = 0; g < 3; g++) {
+            Case cg;
+            for (size_t i = 0; i < n; i++) {
+                if (groups[i] != g)
+                    continue;
+                cg.x.push_back(c.x[i]);
+                cg.y.push_back(c.y[i]);
+                if (c.w.size() > 0)
+                    cg.w.push_back(c.w[i]);
+            }
+            if (cg.x.size() == 0)
+                continue;
+            expected.push_back(wdm::wdm(cg.x, cg.y, method, cg.w));
+            if (with_test)
+                wdm::Indep_test(cg.x, cg.y, method, cg.w).p_value();
+            cases.push_back(cg);
+        }
+    } catch (const std::runtime_error&) {
+        try {
+            wdm::wdm_grouped(c.x, c.y, groups, method, c.w);
+            if (with_test)
+                wdm::indep_test_grouped(c.x, c.y, groups, method, c.w);
+        } catch (const std::runtime_error&) {
+            return "";
+        }
+        return "expected an error";
+    }
+    std::vector<double> actual =
+        wdm::wdm_grouped(c.x, c.y, groups, method, c.w).estimates;
+    if (!close(actual, expected, 1e-9))
+        return describe(actual, expected);
+    if (!with_test)
+        return "";
+
+    // as in check_test(), statistics are computed from the grouped
+    // estimates to avoid amplifying rounding errors through atanh().
+    auto tests = wdm::indep_test_grouped(c.x, c.y, groups, method, c.w).tests;
+    for (size_t k = 0; k < cases.size(); k++) {
+        Case& cg = cases[k];
+        wdm::Test_result expected_test;
+        if (wdm::methods::is_chatterjee(method) ||
+            wdm::methods::is_dcor(method)) {
+            wdm::Indep_test test(cg.x, cg.y, method, cg.w);
+            expected_test.statistic = test.statistic();
+            expected_test.p_value = test.p_value();
+        } else {
+            oracle::remove_incomplete(cg.x, cg.y, cg.w);
+            wdm::Indep_test test(actual[k], method, cg.x.size(), cg.w,
+                                 "two-sided", wdm::margin_ties(cg.x, cg.w),
+                                 wdm::margin_ties(cg.y, cg.w));
+            expected_test.statistic = test.statistic();
+            expected_test.p_value = test.p_value();
+        }
+        if (!close(tests[k].estimate, actual[k], 0.0))
+            return "test estimate: " + describe(tests[k].estimate, actual[k]);
+        if (!close(tests[k].statistic, expected_test.statistic, 1e-9))
+            return "statistic: " + describe(tests[k].statistic,
+                                            expected_test.statistic);
+        if (!close(tests[k].p_value, expected_test.p_value, 1e-9))
+            return "p-value: " + describe(tests[k].p_value,
+                                          expected_test.p_value);
+    }
+    return "";
+}
+
+// sparse columns must agree with the dense computation; zeros are
+// inserted so that most observations are zero in both variables.
+std::string check_sparse(const Case& c, const std::string& method)
+{
+    std::vector<double> x = c.x, y = c.y;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (i % 3 != 0)
+            x[i] = 0.0;
+        if (i % 4 != 1)
+            y[i] = 0.0;
+    }
+    double expected;
+    try {
+        expected = wdm::wdm(x, y, method, c.w);
+    } catch (const std::runtime_error&) {
+        try {
+            wdm::wdm(wdm::make_sparse(x), wdm::make_sparse(y), method, c.w);
+        } catch (const std::runtime_error&) {
+            return "";
+        }
+        return "expected an error";
+    }
+    double actual =
+        wdm::wdm(wdm::make_sparse(x), wdm::make_sparse(y), method, c.w);
+    return close(actual, expected, 1e-9) ? "" : describe(actual, expected);
+}
+
+// integer codes of a variable: steps of size `step` around `max / 2`,
+// clamped to [0, max]; missing values get code 0.
+template<class T>
+std::vector<T> to_codes(const std::vector<double>& x, double step, double max)
+{
+    std::vector<T> codes(x.size(), 0);
+    for (size_t i = 0; i < x.size(); i++) {
+        if (!std::isnan(x[i])) {
+            double c = std::floor(x[i] / step) + max / 2;
+            codes[i] = static_cast<T>(std::min(std::max(c, 0.0), max));
+        }
+    }
+    return codes;
+}
+
+// integer-coded variables must agree with the computations on their
+// values as doubles (estimates, tests, and matrices).
+std::string check_codes(const Case& c, const std::string& method)
+{
+    auto x = to_codes<uint8_t>(c.x, 0.5, 12);
+    auto y = to_codes<uint16_t>(c.y, 0.01, 1000);
+    auto y8 = to_codes<uint8_t>(c.y, 0.5, 12);
+    std::vector<double> xd(x.begin(), x.end()), yd(y.begin(), y.end());
+    std::vector<double> y8d(y8.begin(), y8.end());
+
+    double expected;
+    try {
+        expected = wdm::wdm(xd, yd, method, c.w);
+    } catch (const std::runtime_error&) {
+        try {
+            wdm::wdm(x, y, method, c.w);
+        } catch (const std::runtime_error&) {
+            return "";
+        }
+        return "expected an error";
+    }
+    double actual = wdm::wdm(x, y, method, c.w);
+    if (!close(actual, expected, 1e-9))
+        return "estimate: " + describe(actual, expected);
+
+    auto ms = wdm::wdm(std::vector<std::vector<uint8_t>>{x, y8, x}, method,
+                       c.w, true, 2);
+    std::vector<double> ms_expected = {
+        wdm::wdm(xd, y8d, method, c.w), wdm::wdm(y8d, xd, method, c.w),
+        wdm::wdm(y8d, xd, method, c.w), wdm::wdm(xd, y8d, method, c.w),
+        wdm::methods::has_unit_diagonal(method) ?
+            1.0 : wdm::wdm(y8d, y8d, method, c.w)
+    };
+    std::vector<double> ms_actual = {ms[0][1], ms[1][0], ms[1][2], ms[2][1],
+                                     ms[1][1]};
+    if (!close(ms_actual, ms_expected, 1e-9))
+        return "matrix: " + describe(ms_actual, ms_expected);
+
+    try {
+        wdm::Indep_test test(xd, yd, method, c.w);
+        test.p_value();
+    } catch (const std::runtime_error&) {
+        try {
+            wdm::indep_test(x, y, method, c.w).p_value();
+        } catch (const std::runtime_error&) {
+            return "";
+        }
+        return "expected an error in the test";
+    }
+    wdm::Indep_test test(xd, yd, method, c.w);
+    wdm::Indep_test test_codes = wdm::indep_test(x, y, method, c.w);
+    if (!close(test_codes.statistic(), test.statistic(), 1e-7))
+        return "statistic: " + describe(test_codes.statistic(), test.statistic());
+    if (!close(test_codes.p_value(), test.p_value(), 1e-7))
+        return "p-value: " + describe(test_codes.p_value(), test.p_value());
+    return "";
+}
+
+// reductions must not depend on the number of threads and must be accurate
+// relative to the sum of absolute terms.
+std::string check_reduce(const Case& c)
+{
+    Case cc = c;
+    oracle::remove_incomplete(cc.x, cc.y, cc.w);
+    if (cc.x.empty())
+        return "";
+    std::vector<double> terms(5 * wdm::utils::reduce_chunk_size + 3 * c.x.size());
+    long double exact = 0.0, abs_sum = 0.0;
+    for (size_t i = 0; i < terms.size(); i++) {
+        terms[i] = cc.x[i % cc.x.size()] * cc.y[(i / 3) % cc.y.size()];
+        exact += terms[i];
+        abs_sum += std::abs(terms[i]);
+    }
+    auto term = [&] (size_t i) { return terms[i]; };
+
+    double serial = wdm::utils::reduce_sum(terms.size(), term);
+    for (size_t threads : {1, 2, 3}) {
+        double parallel =
+            wdm::utils::parallel_reduce_sum(terms.size(), term, threads);
+        if (parallel != serial) {
+            return std::to_string(threads) + " threads: " +
+                describe(parallel, serial);
+        }
+    }
+    auto both = wdm::utils::reduce_sums<2>(terms.size(), [&] (size_t i) {
+        return std::array<double, 2>{{-terms[i], terms[i]}};
+    });
+    if (both[1] != serial)
+        return "joint sums: " + describe(both[1], serial);
+    if (std::abs(serial - exact) > 1e-14 * abs_sum)
+        return describe(serial, static_cast<double>(exact));
+    return "";
+}
+
+std::string check_rank0(const Case& c, const std::string& ties_method)
+{
+    Case cc = c;
+    oracle::remove_incomplete(cc.x, cc.y, cc.w);
+    std::vector<double> expected =
+        oracle::rank0(cc.x, cc.w, ties_method == "average");
+    std::vector<double> actual = wdm::impl::rank0(cc.x, cc.w, ties_method);
+    return close(actual, expected, 1e-9) ? "" : describe(actual, expected);
+}
+
+std::string check_rank0_codes(const Case& c, const std::string& ties_method)
+{
+    Case cc = c;
+    oracle::remove_incomplete(cc.x, cc.y, cc.w);
+    auto x = to_codes<uint16_t>(cc.x, 0.01, 1000);
+    std::vector<double> expected = oracle::rank0(
+        std::vector<double>(x.begin(), x.end()), cc.w, ties_method == "average");
+    std::vector<double> actual = wdm::impl::rank0(x, cc.w, ties_method);
+    return close(actual, expected, 1e-9) ? "" : describe(actual, expected);
+}
+
+std::string check_bivariate_rank(const Case& c)
+{
+    Case cc = c;
+    oracle::remove_incomplete(cc.x, cc.y, cc.w);
+    std::vector<double> expected = oracle::bivariate_rank(cc.x, cc.y, cc.w);
+    std::vector<double> actual = wdm::impl::bivariate_rank(cc.x, cc.y, cc.w);
+    return close(actual, expected, 1e-9) ? "" : describe(actual, expected);
+}
+
+// greedily removes observations and simplifies weights as long as the check
+// keeps failing.
+Case minimize(Case c, const Check& check)
+{
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        if (c.w.size() > 0) {
+            Case cc = c;
+            cc.w.clear();
+            if (!check(cc).empty()) {
+                c = cc;
+                progress = true;
+            }
+        }
+        for (size_t i = c.x.size(); i-- > 0;) {
+            Case cc = c;
+            cc.x.erase(cc.x.begin() + i);
+            cc.y.erase(cc.y.begin() + i);
+            if (cc.w.size() > 0)
+                cc.w.erase(cc.w.begin() + i);
+            if (!check(cc).empty()) {
+                c = cc;
+                progress = true;
+            }
+        }
+        for (size_t i = 0; i < c.w.size(); i++) {
+            if (c.w[i] == 1.0)
+                continue;
+            Case cc = c;
+            cc.w[i] = 1.0;
+            if (!check(cc).empty()) {
+                c = cc;
+                progress = true;
+            }
+        }
+    }
+    return c;
+}
+
+void print_vector(const std::string& name, const std::vector<double>& v)
+{
+    std::cout << "    " << name << " = {";
+    for (size_t i = 0; i < v.size(); i++)
+        std::cout << (i > 0 ? ", " : "") << v[i];
+    std::cout << "}" << std::endl;
+}
+
+bool run_check(const std::string& name, const Check& check, const Case& c)
+{
+    if (check(c).empty())
+        return true;
+    Case m = minimize(c, check);
+    std::cout << "FAILED " << name << ": " << check(m) << std::endl;
+    std::cout.precision(17);
+    print_vector("x", m.x);
+    print_vector("y", m.y);
+    print_vector("w", m.w);
+    return false;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200;
+    unsigned seed = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1;
+    Generator gen(seed);
+
+    size_t failures = 0, checks = 0;
+    for (size_t it = 0; it < iterations; it++) {
+        for (const auto& scenario : scenarios) {
+            Case c = gen.draw(scenario);
+            for (const auto& method : methods) {
+                checks += 6;
+                failures += !run_check(
+                    scenario + "/" + method + "/estimate",
+                    [&] (const Case& cc) { return check_estimate(cc, method); },
+                    c);
+                failures += !run_check(
+                    scenario + "/" + method + "/test",
+                    [&] (const Case& cc) { return check_test(cc, method); },
+                    c);
+                failures += !run_check(
+                    scenario + "/" + method + "/ccf",
+                    [&] (const Case& cc) { return check_ccf(cc, method); },
+                    c);
+                failures += !run_check(
+                    scenario + "/" + method + "/grouped",
+                    [&] (const Case& cc) { return check_grouped(cc, method); },
+                    c);
+                failures += !run_check(
+                    scenario + "/" + method + "/sparse",
+                    [&] (const Case& cc) { return check_sparse(cc, method); },
+                    c);
+                failures += !run_check(
+                    scenario + "/" + method + "/codes",
+                    [&] (const Case& cc) { return check_codes(cc, method); },
+                    c);
+            }
+            for (const std::string ties : {"min", "average"}) {
+                checks++;
+                failures += !run_check(
+                    scenario + "/rank0/" + ties,
+                    [&] (const Case& cc) { return check_rank0(cc, ties); },
+                    c);
+                checks++;
+                failures += !run_check(
+                    scenario + "/rank0_codes/" + ties,
+                    [&] (const Case& cc) { return check_rank0_codes(cc, ties); },
+                    c);
+            }
+            checks++;
+            failures += !run_check(scenario + "/bivariate_rank",
+                                   check_bivariate_rank,
+                                   c);
+            checks++;
+            failures += !run_check(scenario + "/reduce", check_reduce, c);
+        }
+    }
+
+    std::cout << checks - failures << " of " << checks << " checks passed "
+              << "(seed " << seed << ")." << std::endl;
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
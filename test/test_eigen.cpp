@@ -0,0 +1,287 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Tests of the Eigen interface: the matrix of dependence measures (also
+// with missing values), lists of column pairs, spanning trees (compared to
+// Kruskal's algorithm on the matrix), and partial correlations, which are
+// compared to correlations of regression residuals.
+
+#include <wdm/partial.hpp>
+#include <wdm/tree.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace {
+
+size_t failures = 0;
+
+void expect(bool ok, const std::string& what)
+{
+    if (!ok) {
+        std::cout << "FAILED " << what << std::endl;
+        failures++;
+    }
+}
+
+Eigen::MatrixXd simulate(size_t n, size_t d, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> normal;
+    Eigen::MatrixXd x(n, d);
+    for (size_t i = 0; i < n; i++) {
+        double z = normal(gen);
+        for (size_t j = 0; j < d; j++)
+            x(i, j) = z * (j + 1) / d + normal(gen);
+    }
+    return x;
+}
+
+// correlation of the residuals of columns i and j after regressing them on
+// all other columns.
+double residual_cor(const Eigen::MatrixXd& x, size_t i, size_t j)
+{
+    size_t n = x.rows(), d = x.cols();
+    Eigen::MatrixXd z(n, d - 1);
+    z.col(0).setOnes();
+    for (size_t k = 0, c = 1; k < d; k++) {
+        if ((k != i) && (k != j))
+            z.col(c++) = x.col(k);
+    }
+    auto qr = z.colPivHouseholderQr();
+    Eigen::VectorXd r_i = x.col(i) - z * qr.solve(x.col(i));
+    Eigen::VectorXd r_j = x.col(j) - z * qr.solve(x.col(j));
+    return r_i.dot(r_j) / (r_i.norm() * r_j.norm());
+}
+
+void test_matrix()
+{
+    Eigen::MatrixXd x = simulate(200, 6, 1);
+    for (std::string method : {"pearson", "kendall", "chatterjee"}) {
+        Eigen::MatrixXd serial = wdm::wdm(x, method);
+        Eigen::MatrixXd parallel = wdm::wdm(x, method, Eigen::VectorXd(), true, 3);
+        expect(serial == parallel, method + ": serial and parallel matrices differ");
+        expect(std::abs(serial(1, 4) -
+                        wdm::wdm(x.col(1), x.col(4), method)) < 1e-15,
+               method + ": matrix entry differs from wdm()");
+        double diagonal = wdm::methods::has_unit_diagonal(method) ?
+            1.0 : wdm::wdm(x.col(2), x.col(2), method);
+        expect(serial(2, 2) == diagonal,
+               method + ": diagonal differs from wdm()");
+    }
+}
+
+// pairwise-complete Pearson correlations from masked matrix products.
+void test_missing()
+{
+    Eigen::MatrixXd x = simulate(300, 7, 4);
+    std::mt19937 gen(5);
+    std::bernoulli_distribution missing(0.15);
+    std::exponential_distribution<double> exponential;
+    for (size_t i = 0; i < 300; i++) {
+        for (size_t j = 0; j < 7; j++) {
+            if (missing(gen))
+                x(i, j) = std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+    // constant among the complete pairs with column 0 (computed directly),
+    // and a column with a single observation (too few pairs).
+    for (size_t i = 0; i < 300; i++) {
+        if (!std::isnan(x(i, 0)))
+            x(i, 5) = std::isnan(x(i, 5)) ? x(i, 5) : 2.5;
+        x(i, 6) = (i == 7) ? 1.0 : std::numeric_limits<double>::quiet_NaN();
+    }
+    Eigen::VectorXd w(300);
+    for (size_t i = 0; i < 300; i++)
+        w(i) = exponential(gen);
+    w(3) = std::numeric_limits<double>::quiet_NaN();
+
+    for (auto weights : {Eigen::VectorXd(), w}) {
+        for (size_t threads : {1, 3}) {
+            Eigen::MatrixXd ms = wdm::wdm(x, "pearson", weights, true, threads);
+            bool ok = true;
+            for (size_t i = 0; i < 7; i++) {
+                for (size_t j = 0; j < 7; j++) {
+                    double expected = (i == j) ? 1.0 :
+                        wdm::wdm(x.col(i), x.col(j), "pearson", weights);
+                    ok = ok && ((std::abs(ms(i, j) - expected) < 1e-10) ||
+                                (std::isnan(ms(i, j)) && std::isnan(expected)));
+                }
+            }
+            expect(ok, "pairwise-complete pearson, " +
+                   std::to_string(weights.size()) + " weights, " +
+                   std::to_string(threads) + " threads");
+        }
+    }
+    expect(std::isnan(wdm::wdm(x, "pearson")(0, 6)), "too few complete pairs");
+}
+
+void test_pairs()
+{
+    // ties, a missing value, and weights exercise all preparation paths.
+    Eigen::MatrixXd x = simulate(150, 5, 3);
+    x.col(2) = x.col(2).array().round();
+    x(7, 3) = std::numeric_limits<double>::quiet_NaN();
+    Eigen::VectorXd w = (x.col(0).array().abs() + 0.5).matrix();
+    std::vector<std::pair<size_t, size_t>> pairs = {
+        {4, 2}, {0, 2}, {2, 0}, {0, 3}, {2, 2}, {4, 2}, {1, 0}
+    };
+    for (std::string method : {"pearson", "spearman", "kendall", "blomqvist",
+                               "hoeffding"}) {
+        for (auto weights : {Eigen::VectorXd(), w}) {
+            std::vector<double> ests =
+                wdm::wdm_pairs(x, pairs, method, weights, true, 2);
+            std::vector<wdm::Test_result> tests =
+                wdm::indep_test_pairs(x, pairs, method, weights, true,
+                                      "two-sided", 2);
+            for (size_t k = 0; k < pairs.size(); k++) {
+                Eigen::VectorXd a = x.col(pairs[k].first),
+                    b = x.col(pairs[k].second);
+                double est = wdm::wdm(a, b, method, weights);
+                expect(std::abs(ests[k] - est) < 1e-12,
+                       method + ": pair estimate differs from wdm()");
+                wdm::Indep_test test(wdm::utils::convert_vec(a),
+                                     wdm::utils::convert_vec(b),
+                                     method,
+                                     wdm::utils::convert_vec(weights));
+                expect(std::abs(tests[k].p_value - test.p_value()) < 1e-12,
+                       method + ": pair test differs from Indep_test");
+            }
+        }
+    }
+
+    bool thrown = false;
+    try {
+        wdm::wdm_pairs(x, {{0, 5}}, "kendall");
+    } catch (const std::exception&) {
+        thrown = true;
+    }
+    expect(thrown, "pairs: column index out of range accepted");
+}
+
+// maximum spanning forest of the matrix by Kruskal's algorithm; edges are
+// returned as sorted (smaller, larger) pairs.
+std::vector<std::pair<size_t, size_t>> kruskal(const Eigen::MatrixXd& ms,
+                                               double threshold)
+{
+    size_t d = ms.cols();
+    std::vector<std::pair<size_t, size_t>> candidates, edges;
+    for (size_t i = 0; i < d; i++) {
+        for (size_t j = i + 1; j < d; j++) {
+            if (std::abs(ms(i, j)) >= threshold)
+                candidates.push_back({i, j});
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [&] (
+        const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) {
+        return std::abs(ms(a.first, a.second)) > std::abs(ms(b.first, b.second));
+    });
+    std::vector<size_t> component(d);
+    for (size_t i = 0; i < d; i++)
+        component[i] = i;
+    for (const auto& e : candidates) {
+        size_t a = component[e.first], b = component[e.second];
+        if (a == b)
+            continue;
+        for (auto& c : component) {
+            if (c == b)
+                c = a;
+        }
+        edges.push_back(e);
+    }
+    std::sort(edges.begin(), edges.end());
+    return edges;
+}
+
+void test_spanning_tree()
+{
+    Eigen::MatrixXd x = simulate(100, 12, 4);
+    for (std::string method : {"kendall", "pearson"}) {
+        Eigen::MatrixXd ms = wdm::wdm(x, method);
+        for (double threshold : {0.0, 0.15}) {
+            auto tree = wdm::wdm_spanning_tree(x, method, Eigen::VectorXd(),
+                                               true, threshold, 3);
+            std::vector<std::pair<size_t, size_t>> edges;
+            for (const auto& e : tree) {
+                expect(e.estimate == ms(e.from, e.to),
+                       method + ": tree edge differs from matrix");
+                edges.push_back({std::min(e.from, e.to), std::max(e.from, e.to)});
+            }
+            std::sort(edges.begin(), edges.end());
+            expect(edges == kruskal(ms, threshold),
+                   method + ": tree differs from Kruskal's algorithm");
+        }
+    }
+
+    bool thrown = false;
+    try {
+        wdm::wdm_spanning_tree(x, "chatterjee");
+    } catch (const std::exception&) {
+        thrown = true;
+    }
+    expect(thrown, "tree: asymmetric method accepted");
+}
+
+void test_partial()
+{
+    Eigen::MatrixXd x = simulate(300, 5, 2);
+    Eigen::MatrixXd pcor = wdm::wdm_partial(x, "pearson");
+    Eigen::MatrixXd pcor_par =
+        wdm::wdm_partial(x, "pearson", Eigen::VectorXd(), true, 0.0, 4);
+    expect((pcor - pcor_par).cwiseAbs().maxCoeff() < 1e-14,
+           "partial: serial and parallel results differ");
+    for (size_t i = 0; i < 5; i++) {
+        for (size_t j = i + 1; j < 5; j++) {
+            expect(std::abs(pcor(i, j) - residual_cor(x, i, j)) < 1e-10,
+                   "partial: differs from residual correlation");
+            expect(pcor(i, j) == pcor(j, i), "partial: not symmetric");
+        }
+    }
+
+    // full shrinkage removes all dependence.
+    Eigen::MatrixXd shrunk = wdm::wdm_partial(x, "pearson", Eigen::VectorXd(),
+                                              true, 1.0);
+    expect(shrunk.isIdentity(1e-15), "partial: full shrinkage");
+
+    // singular matrices need shrinkage.
+    Eigen::MatrixXd y(300, 3);
+    y << x.col(0), x.col(1), x.col(0) + x.col(1);
+    bool thrown = false;
+    try {
+        wdm::wdm_partial(y, "pearson");
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    expect(thrown, "partial: singular matrix accepted");
+    Eigen::MatrixXd reg = wdm::wdm_partial(y, "pearson", Eigen::VectorXd(),
+                                           true, 0.1);
+    expect(reg.allFinite(), "partial: shrinkage does not regularize");
+
+    // test statistics.
+    wdm::Partial_tests tests = wdm::indep_test_partial(x, "pearson");
+    double stat = std::atanh(pcor(0, 1)) * std::sqrt(300.0 - 3 - 3);
+    expect(std::abs(tests.statistics(0, 1) - stat) < 1e-12,
+           "partial: test statistic");
+    expect(std::abs(tests.p_values(0, 1) -
+                    2 * wdm::utils::normalCDF(-std::abs(stat))) < 1e-12,
+           "partial: p-value");
+    expect(std::isnan(tests.p_values(2, 2)), "partial: diagonal p-value");
+}
+
+}
+
+int main()
+{
+    test_matrix();
+    test_missing();
+    test_pairs();
+    test_spanning_tree();
+    test_partial();
+    if (failures == 0)
+        std::cout << "all Eigen tests passed." << std::endl;
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
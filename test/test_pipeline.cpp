@@ -0,0 +1,172 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Tests of the out-of-core pipeline: the queues must apply backpressure and
+// close cleanly, the mapped file must agree with the stream reader, and
+// matrices computed from a file must agree with the pairwise computations
+// for all block and queue sizes.
+
+#include <wdm/pipeline.hpp>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+
+namespace {
+
+size_t failures = 0;
+
+void expect(bool ok, const std::string& what)
+{
+    if (!ok) {
+        std::cout << "FAILED " << what << std::endl;
+        failures++;
+    }
+}
+
+void test_queue()
+{
+    wdm::utils::Bounded_queue<size_t> queue(3);
+    std::atomic<size_t> pushed(0), max_ahead(0);
+    std::thread producer([&] {
+        for (size_t i = 0; i < 1000; i++) {
+            pushed++;
+            queue.push(i);
+        }
+        queue.close();
+    });
+    size_t item, popped = 0;
+    bool in_order = true;
+    while (queue.pop(item)) {
+        in_order = in_order && (item == popped);
+        popped++;
+        // counts may lag by one item on each side of the queue.
+        max_ahead = std::max(max_ahead.load(), pushed.load() - popped);
+    }
+    producer.join();
+    expect(in_order && (popped == 1000), "queue delivers all items in order");
+    expect(max_ahead <= 5, "queue applies backpressure");
+    expect(!queue.push(0), "push to a closed queue fails");
+
+    // closing releases a blocked producer.
+    wdm::utils::Bounded_queue<size_t> full(1);
+    full.push(0);
+    std::thread blocked([&] { expect(!full.push(1), "blocked push fails"); });
+    full.close();
+    blocked.join();
+    expect(full.pop(item) && (item == 0) && !full.pop(item),
+           "closed queue returns remaining items");
+}
+
+std::vector<std::vector<double>> simulate(size_t n, size_t d, std::mt19937& gen)
+{
+    std::normal_distribution<double> normal;
+    std::vector<std::vector<double>> x(d, std::vector<double>(n));
+    for (size_t i = 0; i < n; i++) {
+        double z = normal(gen);
+        for (size_t j = 0; j < d; j++) {
+            x[j][i] = z + normal(gen);
+            if (j % 3 == 0)
+                x[j][i] = std::round(x[j][i]);  // ties
+        }
+    }
+    x[2][5] = std::numeric_limits<double>::quiet_NaN();
+    return x;
+}
+
+void test_mapped_file(const std::string& path)
+{
+    wdm::io::Mapped_column_file file(path);
+    auto columns = wdm::io::read_columns(path, 2, 3);
+    auto mapped = file.read_columns(2, 3);
+    bool same = (columns.size() == mapped.size());
+    for (size_t j = 0; same && (j < columns.size()); j++) {
+        for (size_t i = 0; i < columns[j].size(); i++) {
+            same = same && ((columns[j][i] == mapped[j][i]) ||
+                            (std::isnan(columns[j][i]) && std::isnan(mapped[j][i])));
+        }
+    }
+    expect(same, "mapped columns");
+    expect(file.read_weights() == wdm::io::read_weights(path), "mapped weights");
+}
+
+void test_matrix(const std::string& path,
+                 const std::vector<std::vector<double>>& x,
+                 const std::vector<double>& w,
+                 const std::vector<std::string>& methods)
+{
+    size_t d = x.size();
+    for (const auto& method : methods) {
+        for (size_t block_size : {1, 3, 100}) {
+            for (size_t threads : {1, 3}) {
+                auto ms = wdm::wdm_file(path, method, true, block_size, threads, 1);
+                bool ok = (ms.size() == d);
+                for (size_t i = 0; ok && (i < d); i++) {
+                    for (size_t j = 0; j < d; j++) {
+                        double expected =
+                            ((i == j) && wdm::methods::has_unit_diagonal(method)) ?
+                            1.0 : wdm::wdm(x[i], x[j], method, w);
+                        ok = ok && (std::abs(ms[i][j] - expected) < 1e-12);
+                    }
+                }
+                expect(ok, "wdm_file " + method + ", block_size = " +
+                       std::to_string(block_size) + ", threads = " +
+                       std::to_string(threads));
+            }
+        }
+    }
+}
+
+void test_errors(const std::string& path)
+{
+    auto throws = [] (std::function<void()> f) {
+        try {
+            f();
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    expect(throws([&] { wdm::wdm_file(path, "none"); }), "unknown method");
+    expect(throws([&] { wdm::wdm_file(path, "kendall", true, 0); }),
+           "zero block size");
+    expect(throws([] { wdm::wdm_file("does/not/exist.wdm", "kendall"); }),
+           "missing file");
+    // errors raised inside the stages stop the pipeline.
+    expect(throws([&] { wdm::wdm_file(path, "kendall", false, 2, 2, 1); }),
+           "missing values with remove_missing = false");
+}
+
+}
+
+int main()
+{
+    test_queue();
+
+    std::mt19937 gen(1);
+    auto x = simulate(200, 8, gen);
+    std::vector<double> w(200);
+    std::exponential_distribution<double> exponential;
+    for (auto& wi : w)
+        wi = exponential(gen);
+    const std::string path = "wdm_pipeline_test.wdm";
+    wdm::io::write_columns(path, x, w);
+    test_mapped_file(path);
+    test_matrix(path, x, w, {"pearson", "spearman", "kendall", "blomqvist",
+                             "hoeffding"});
+    test_errors(path);
+
+    // Chatterjee's xi is asymmetric and needs equal weights.
+    wdm::io::write_columns(path, x);
+    test_matrix(path, x, std::vector<double>(), {"chatterjee", "kendall"});
+    std::remove(path.c_str());
+
+    if (failures == 0)
+        std::cout << "all pipeline tests passed." << std::endl;
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
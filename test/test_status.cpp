@@ -0,0 +1,122 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Tests of the non-throwing interface: every problem must be reported by its
+// status, and results must be `nan` unless the status is `Status::ok`.
+
+#include <wdm.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+size_t failures = 0;
+
+void expect(bool ok, const std::string& what)
+{
+    if (!ok) {
+        std::cout << "FAILED " << what << std::endl;
+        failures++;
+    }
+}
+
+const double nan = std::numeric_limits<double>::quiet_NaN();
+
+// calls try_wdm() and try_indep_test() and checks the status of both and
+// that all results are `nan` (or not, for `Status::ok`).
+void expect_status(wdm::Status expected,
+                   const std::vector<double>& x,
+                   const std::vector<double>& y,
+                   const std::string& method,
+                   const std::vector<double>& weights,
+                   bool remove_missing,
+                   const std::string& alternative,
+                   const std::string& what)
+{
+    bool ok = (expected == wdm::Status::ok);
+    double estimate = 0.0;
+    wdm::Status status = wdm::try_wdm(estimate, x, y, method, weights,
+                                      remove_missing);
+    if (expected != wdm::Status::invalid_alternative) {
+        expect(status == expected, what + ": try_wdm() status");
+        expect(std::isnan(estimate) != ok, what + ": try_wdm() result");
+    }
+
+    wdm::Test_result result;
+    result.estimate = result.statistic = result.p_value = 0.0;
+    status = wdm::try_indep_test(result, x, y, method, weights,
+                                 remove_missing, alternative);
+    expect(status == expected, what + ": try_indep_test() status");
+    expect((std::isnan(result.estimate) != ok) &&
+           (std::isnan(result.statistic) != ok) &&
+           (std::isnan(result.p_value) != ok),
+           what + ": try_indep_test() result");
+}
+
+void test_status()
+{
+    using wdm::Status;
+    std::vector<double> x{1, 3, 2, 5, 3, 2, 20, 15};
+    std::vector<double> y{2, 12, 4, 7, 8, 14, 17, 6};
+    std::vector<double> w{1, 1, 2, 2, 1, 0, 0.5, 0.3}, none;
+    std::vector<double> x_nan = x, all_nan(x.size(), nan), constant(x.size(), 4.0);
+    x_nan[2] = nan;
+
+    for (std::string method : {"kendall", "pearson", "hoeffding", "chatterjee"}) {
+        const std::vector<double>& ww = wdm::methods::is_chatterjee(method) ? none : w;
+        expect_status(Status::ok, x, y, method, ww, true, "two-sided",
+                      method + ", valid input");
+        expect_status(Status::ok, x_nan, y, method, ww, true, "two-sided",
+                      method + ", removed missing values");
+        expect_status(Status::too_few_observations, {1.0}, {2.0}, method, none,
+                      true, "two-sided", method + ", too few rows");
+        expect_status(Status::all_missing, all_nan, y, method, ww, true,
+                      "two-sided", method + ", all values nan");
+        expect_status(Status::zero_variance, constant, y, method, ww, true,
+                      "two-sided", method + ", constant x");
+        expect_status(Status::missing_values, x_nan, y, method, ww, false,
+                      "two-sided", method + ", missing values");
+        expect_status(Status::size_mismatch, x, {1.0, 2.0}, method, ww, true,
+                      "two-sided", method + ", size mismatch");
+        expect_status(Status::size_mismatch, x, y, method, {1.0, 2.0}, true,
+                      "two-sided", method + ", weights size mismatch");
+        expect_status(Status::invalid_alternative, x, y, method, ww, true,
+                      "sideways", method + ", invalid alternative");
+    }
+    expect_status(Status::invalid_method, x, y, "none", w, true, "two-sided",
+                  "invalid method");
+    expect_status(Status::invalid_alternative, x, y, "hoeffding", w, true,
+                  "greater", "one-sided Hoeffding");
+
+    // Chatterjee's xi needs equal (non-zero) weights.
+    expect_status(Status::invalid_weights, x, y, "chatterjee", w, true,
+                  "greater", "xi with unequal weights");
+    expect_status(Status::invalid_weights, x, y, "chatterjee", w, false,
+                  "greater", "xi with unequal weights (no removal)");
+    std::vector<double> w_equal{2, 2, 0, 2, 2, 2, 2, 0};
+    expect_status(Status::ok, x, y, "chatterjee", w_equal, true, "greater",
+                  "xi with equal weights");
+
+    // htau has an estimate, but no test.
+    double estimate = nan;
+    expect(wdm::try_wdm(estimate, x, y, "htau") == Status::ok, "htau: status");
+    expect(!std::isnan(estimate), "htau: result");
+    wdm::Test_result result;
+    expect(wdm::try_indep_test(result, x, y, "htau") == Status::invalid_method,
+           "htau: no test");
+    expect(std::isnan(result.p_value), "htau: no test result");
+}
+
+}
+
+int main()
+{
+    test_status();
+    if (failures == 0)
+        std::cout << "all status tests passed." << std::endl;
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
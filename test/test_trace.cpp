@@ -0,0 +1,132 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Tests of tracing: every chunk of a parallel loop must be recorded exactly
+// once by the thread that ran it, full buffers must keep the latest events,
+// and nothing must be recorded outside of trace_start() and trace_stop().
+
+// the test needs tracing even if it is not enabled for the build (with
+// ENABLE_TRACE=ON, WDM_TRACE is already defined on the command line).
+#ifndef WDM_TRACE
+#define WDM_TRACE
+#endif
+#include <wdm/parallel.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+namespace {
+
+size_t failures = 0;
+
+void expect(bool ok, const std::string& what)
+{
+    if (!ok) {
+        std::cout << "FAILED " << what << std::endl;
+        failures++;
+    }
+}
+
+size_t count(const std::string& text, const std::string& pattern)
+{
+    size_t k = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1))
+        k++;
+    return k;
+}
+
+// the events of all buffers, by thread.
+std::map<size_t, std::vector<wdm::impl::Trace_event>> events()
+{
+    std::map<size_t, std::vector<wdm::impl::Trace_event>> events;
+    for (const auto& buffer : wdm::impl::trace_state().buffers)
+        events[buffer->thread()] = buffer->events();
+    return events;
+}
+
+void test_chunks()
+{
+    std::vector<double> out(1000);
+    wdm::trace_start();
+    wdm::utils::parallel_for(0, out.size(), [&] (size_t i) {
+        for (size_t k = 0; k < 1000 * (i % 7); k++)
+            out[i] += std::sqrt(static_cast<double>(k));
+    }, 3, 10);
+    wdm::trace_stop();
+
+    std::vector<size_t> covered(out.size(), 0);
+    size_t num_loops = 0, num_threads = 0;
+    for (const auto& thread : events()) {
+        num_threads++;
+        double last_end = 0.0;
+        for (const auto& event : thread.second) {
+            if (std::string(event.name) == "parallel_for") {
+                num_loops++;
+                expect((event.begin == 0) && (event.end == out.size()),
+                       "range of the loop");
+                continue;
+            }
+            expect(std::string(event.name) == "chunk", "name of a chunk");
+            expect(event.end - event.begin == 10, "size of a chunk");
+            expect(event.time >= last_end, "chunks of a thread are disjoint");
+            expect(event.duration >= 0.0, "duration");
+            last_end = event.time + event.duration;
+            for (size_t i = event.begin; i < event.end; i++)
+                covered[i]++;
+        }
+    }
+    expect(num_loops == 1, "the loop is recorded once");
+    expect((num_threads >= 1) && (num_threads <= 3), "number of threads");
+    expect(std::count(covered.begin(), covered.end(), 1) ==
+           static_cast<long>(out.size()), "every index in exactly one chunk");
+
+    std::string json = wdm::trace_json();
+    expect(json.find("{\"traceEvents\":[") == 0, "json header");
+    expect(count(json, "\"ph\":\"X\"") == 101, "json events");
+    expect(count(json, "\"ph\":\"M\"") == num_threads, "json thread names");
+    expect(json.find("\"dropped_events\":0}") != std::string::npos,
+           "json dropped events");
+
+    // nothing is recorded after trace_stop().
+    wdm::utils::parallel_for(0, 100, [] (size_t) {}, 2, 1);
+    expect(count(wdm::trace_json(), "\"ph\":\"X\"") == 101, "stopped");
+}
+
+void test_ring_buffer()
+{
+    wdm::trace_start(4);
+    for (size_t k = 0; k < 10; k++)
+        wdm::utils::parallel_for(k, k + 1, [] (size_t) {});
+    wdm::trace_stop();
+
+    auto all = events();
+    expect((all.size() == 1) && (all[0].size() == 4), "capacity");
+    for (size_t k = 0; k < all[0].size(); k++)
+        expect(all[0][k].begin == 6 + k, "latest events are kept");
+    expect(wdm::trace_json().find("\"dropped_events\":6}") != std::string::npos,
+           "dropped events");
+
+    bool thrown = false;
+    try {
+        wdm::trace_start(0);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    expect(thrown, "zero capacity");
+}
+
+}
+
+int main()
+{
+    test_chunks();
+    test_ring_buffer();
+    if (failures == 0)
+        std::cout << "all trace tests passed." << std::endl;
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+// Copyright © 2020 Thomas Nagler
+//
+// This file is part of the wdm library and licensed under the terms of
+// the MIT license. For a copy, see the LICENSE file in the root directory
+// or https://github.com/tnagler/wdm/blob/master/LICENSE.
+
+// Tests of the tuning parameters: the file must be read on first use and
+// round trip, invalid files must be rejected (but not break the library),
+// and results must not depend on the parameters.
+
+#include <wdm/acf.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace {
+
+size_t failures = 0;
+
+void expect(bool ok, const std::string& what)
+{
+    if (!ok) {
+        std::cout << "FAILED " << what << std::endl;
+        failures++;
+    }
+}
+
+bool throws(const std::string& contents)
+{
+    const char* path = "wdm_tuning_invalid.cfg";
+    std::ofstream(path) << contents;
+    bool thrown = false;
+    try {
+        wdm::read_tuning(path);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    std::remove(path);
+    return thrown;
+}
+
+void set_env(const char* name, const char* value)
+{
+#ifdef _WIN32
+    _putenv_s(name, value);
+#else
+    setenv(name, value, 1);
+#endif
+}
+
+void test_file()
+{
+    // must run before anything else reads the parameters.
+    const char* path = "wdm_tuning_test.cfg";
+    std::ofstream(path) << "# comment\n\nmerge_sort_cutoff = 7\n"
+                        << "unknown_key = 3\ngrain_size = 5\n";
+    set_env("WDM_TUNING_FILE", path);
+    wdm::Tuning defaults;
+    expect(wdm::get_tuning().merge_sort_cutoff == 7, "file is read on first use");
+    expect(wdm::get_tuning().grain_size == 5, "file is read on first use");
+    expect(wdm::tuning_load_error().empty(), "no error for valid files");
+    expect(wdm::get_tuning().fft_lag_factor == defaults.fft_lag_factor,
+           "missing keys have default values");
+
+    wdm::Tuning tuning;
+    tuning.merge_sort_cutoff = 11;
+    tuning.fft_lag_factor = 0.1 + 0.2;
+    tuning.grain_size = 3;
+    wdm::write_tuning(path, tuning);
+    wdm::Tuning read = wdm::read_tuning(path);
+    expect((read.merge_sort_cutoff == 11) && (read.grain_size == 3) &&
+           (read.fft_lag_factor == tuning.fft_lag_factor), "round trip");
+    std::remove(path);
+
+    expect(throws("merge_sort_cutoff 7\n"), "missing '='");
+    expect(throws("grain_size = many\n"), "invalid value");
+    expect(throws("merge_sort_cutoff = 0\n"), "zero cutoff");
+    expect(throws("fft_lag_factor = -1\n"), "negative factor");
+    expect(throws("grain_size = -1\n"), "negative grain size");
+    expect(throws("merge_sort_cutoff = 8 9\n"), "trailing characters");
+
+    bool thrown = false;
+    try {
+        wdm::read_tuning("does/not/exist.cfg");
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    expect(thrown, "missing file");
+}
+
+void test_fallback()
+{
+    // an invalid file named by the environment silently gives the defaults
+    // instead of errors in every computation; the reason is kept.
+    const char* path = "wdm_tuning_broken.cfg";
+    std::ofstream(path) << "grain_size = -1\n";
+    set_env("WDM_TUNING_FILE", path);
+    wdm::Tuning defaults, loaded = wdm::impl::load_tuning();
+    expect((loaded.merge_sort_cutoff == defaults.merge_sort_cutoff) &&
+           (loaded.grain_size == defaults.grain_size),
+           "invalid files fall back to the defaults");
+    expect(wdm::impl::tuning_error_instance().find("invalid line 1") !=
+           std::string::npos, "error of invalid files");
+    std::remove(path);
+    set_env("WDM_TUNING_FILE", "does/not/exist.cfg");
+    loaded = wdm::impl::load_tuning();
+    expect(loaded.grain_size == defaults.grain_size,
+           "missing files fall back to the defaults");
+    expect(wdm::impl::tuning_error_instance().find("cannot open") !=
+           std::string::npos, "error of missing files");
+    set_env("WDM_TUNING_FILE", "");
+    wdm::impl::load_tuning();
+    expect(wdm::impl::tuning_error_instance().empty(),
+           "no error without a file");
+}
+
+void test_merge_sort()
+{
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> values(0, 20);
+    std::exponential_distribution<double> exponential;
+    for (size_t n : {0, 1, 2, 5, 31, 100, 1000}) {
+        std::vector<double> x(n), w(n);
+        for (size_t i = 0; i < n; i++) {
+            x[i] = values(gen);
+            w[i] = exponential(gen);
+        }
+        std::vector<double> x_ref = x, w_ref = w, empty;
+        double count_ref = 0.0, count_ref_w = 0.0;
+        wdm::utils::merge_sort(x_ref, empty, count_ref, 1);
+        x_ref = x;
+        wdm::utils::merge_sort(x_ref, w_ref, count_ref_w, 1);
+        for (size_t cutoff : {2, 7, 32, 5000}) {
+            std::vector<double> xx = x, ww = w;
+            double count = 0.0, count_w = 0.0;
+            wdm::utils::merge_sort(xx, empty, count, cutoff);
+            xx = x;
+            wdm::utils::merge_sort(xx, ww, count_w, cutoff);
+            std::string what = "merge_sort n = " + std::to_string(n) +
+                               ", cutoff = " + std::to_string(cutoff);
+            expect(count == count_ref, what + " (count)");
+            expect(std::abs(count_w - count_ref_w) <= 1e-12 * (1 + count_ref_w),
+                   what + " (weighted count)");
+            expect((xx == x_ref) && (ww == w_ref), what + " (stable order)");
+        }
+    }
+}
+
+void test_results()
+{
+    std::mt19937 gen(2);
+    std::normal_distribution<double> normal;
+    std::vector<double> x(3000), y(3000), w(3000);
+    for (size_t i = 0; i < x.size(); i++) {
+        x[i] = std::round(4 * normal(gen));
+        y[i] = x[i] + normal(gen);
+        w[i] = std::abs(normal(gen));
+    }
+
+    wdm::Tuning tuning;
+    tuning.merge_sort_cutoff = 1;
+    tuning.fft_lag_factor = 1e300;
+    wdm::set_tuning(tuning);
+    double ktau_ref = wdm::wdm(x, y, "kendall", w);
+    std::vector<double> ccf_ref = wdm::wdm_ccf(x, y, 20, "pearson");
+
+    tuning.merge_sort_cutoff = 64;
+    tuning.fft_lag_factor = 1e-300;
+    wdm::set_tuning(tuning);
+    expect(std::abs(wdm::wdm(x, y, "kendall", w) - ktau_ref) < 1e-12,
+           "kendall does not depend on the cutoff");
+    std::vector<double> ccf = wdm::wdm_ccf(x, y, 20, "pearson");
+    for (size_t k = 0; k < ccf.size(); k++) {
+        expect(std::abs(ccf[k] - ccf_ref[k]) < 1e-10,
+               "ccf does not depend on the fft factor (lag " +
+               std::to_string(k) + ")");
+    }
+
+    bool thrown = false;
+    try {
+        tuning.grain_size = 0;
+        wdm::set_tuning(tuning);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    expect(thrown, "set_tuning() checks the parameters");
+    wdm::set_tuning(wdm::Tuning());
+}
+
+}
+
+int main()
+{
+    test_file();
+    test_fallback();
+    test_merge_sort();
+    test_results();
+    if (failures == 0)
+        std::cout << "all tuning tests passed." << std::endl;
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}